@@ -0,0 +1,958 @@
+#include "Benchmark.h"
+#include "FFMpegDecoder.h"
+#include "FrameConverter.h"
+#include "GopCache.h"
+#include "GopDecoder.h"
+#include "KeyframeIndex.h"
+#include "MediaSource.h"
+#include "ProbeCache.h"
+#include <QGuiApplication>
+#include <QPainter>
+#include <QScreen>
+#include <QtDebug>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+qint64 elapsedUs(Clock::time_point begin) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                begin)
+      .count();
+}
+
+struct Stats {
+  std::vector<qint64> samples; // us
+  int failures = 0;
+
+  void print(const char *label) {
+    if (samples.empty()) {
+      qDebug() << label << ": no successful seeks," << failures << "failed";
+      return;
+    }
+    std::sort(samples.begin(), samples.end());
+    qint64 sum = 0;
+    for (qint64 v : samples)
+      sum += v;
+    qDebug().nospace() << label << ": avg " << sum / samples.size() / 1000.0
+                       << " ms, median "
+                       << samples[samples.size() / 2] / 1000.0 << " ms, max "
+                       << samples.back() / 1000.0 << " ms, failed " << failures;
+  }
+};
+
+// 解出下一帧属于 stream 的画面；seek 后调用
+bool decodeOneFrame(AVFormatContext *fmt, AVCodecContext *codec, int stream,
+                    AVPacket *pkt, AVFrame *frame) {
+  while (av_read_frame(fmt, pkt) >= 0) {
+    if (pkt->stream_index != stream) {
+      av_packet_unref(pkt);
+      continue;
+    }
+    int ret = avcodec_send_packet(codec, pkt);
+    av_packet_unref(pkt);
+    if (ret < 0 && ret != AVERROR(EAGAIN))
+      continue;
+    if (avcodec_receive_frame(codec, frame) == 0)
+      return true;
+  }
+  return false;
+}
+// 精确跳转：seek 后一直解码到显示区间覆盖 targetMs 的帧，与播放器相同，
+// 目标之前的非参考帧不解码；discarded 累加解出后丢弃的帧数
+bool decodeToTarget(AVFormatContext *fmt, AVCodecContext *codec, int stream,
+                    AVPacket *pkt, AVFrame *frame, qint64 targetMs,
+                    int *discarded) {
+  AVStream *st = fmt->streams[stream];
+  AVRational rate = av_guess_frame_rate(fmt, st, nullptr);
+  qint64 interval = rate.num > 0 ? av_rescale(1000, rate.den, rate.num) : 40;
+  bool found = false;
+  while (!found && av_read_frame(fmt, pkt) >= 0) {
+    if (pkt->stream_index != stream) {
+      av_packet_unref(pkt);
+      continue;
+    }
+    bool catchUp = pkt->pts != AV_NOPTS_VALUE &&
+                   av_rescale_q(pkt->pts, st->time_base, {1, 1000}) +
+                           interval <=
+                       targetMs;
+    codec->skip_frame = catchUp ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    int ret = avcodec_send_packet(codec, pkt);
+    av_packet_unref(pkt);
+    if (ret < 0 && ret != AVERROR(EAGAIN))
+      continue;
+    while (avcodec_receive_frame(codec, frame) == 0) {
+      int64_t pts = frame->best_effort_timestamp;
+      if (pts != AV_NOPTS_VALUE &&
+          av_rescale_q(pts, st->time_base, {1, 1000}) + interval <= targetMs) {
+        (*discarded)++;
+        av_frame_unref(frame);
+        continue;
+      }
+      found = true;
+      break;
+    }
+  }
+  codec->skip_frame = AVDISCARD_DEFAULT;
+  return found;
+}
+
+// 解出文件中第一帧画面，frame 在返回后仍然有效
+bool decodeFirstFrame(const QString &path, AVFrame *frame) {
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+      0)
+    return false;
+  AVCodec *decoder = nullptr;
+  int stream = -1;
+  if (ProbeCache::findStreamInfo(fmt, path) >= 0)
+    stream = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  bool ok = false;
+  if (stream >= 0 && decoder) {
+    AVCodecContext *codec = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(codec, fmt->streams[stream]->codecpar);
+    AVPacket *pkt = av_packet_alloc();
+    ok = avcodec_open2(codec, decoder, nullptr) >= 0 &&
+         decodeOneFrame(fmt, codec, stream, pkt, frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&codec);
+  }
+  avformat_close_input(&fmt);
+  return ok;
+}
+
+// 把帧转换为 yuv420p，测试转换内核时作为统一的源格式
+AVFrame *toYuv420p(const AVFrame *src) {
+  AVFrame *dst = av_frame_alloc();
+  dst->format = AV_PIX_FMT_YUV420P;
+  dst->width = src->width;
+  dst->height = src->height;
+  if (av_frame_get_buffer(dst, 32) < 0) {
+    av_frame_free(&dst);
+    return nullptr;
+  }
+  SwsContext *sws = sws_getContext(
+      src->width, src->height, (AVPixelFormat)src->format, dst->width,
+      dst->height, AV_PIX_FMT_YUV420P, SWS_POINT, nullptr, nullptr, nullptr);
+  if (!sws) {
+    av_frame_free(&dst);
+    return nullptr;
+  }
+  sws_scale(sws, src->data, src->linesize, 0, src->height, dst->data,
+            dst->linesize);
+  sws_freeContext(sws);
+  return dst;
+}
+
+// 由 yuv420p 帧构造内容相同的 nv12 帧
+AVFrame *toNv12(const AVFrame *src) {
+  AVFrame *dst = av_frame_alloc();
+  dst->format = AV_PIX_FMT_NV12;
+  dst->width = src->width;
+  dst->height = src->height;
+  if (av_frame_get_buffer(dst, 32) < 0) {
+    av_frame_free(&dst);
+    return nullptr;
+  }
+  av_image_copy_plane(dst->data[0], dst->linesize[0], src->data[0],
+                      src->linesize[0], src->width, src->height);
+  int cw = (src->width + 1) / 2, ch = (src->height + 1) / 2;
+  for (int y = 0; y < ch; y++) {
+    const uint8_t *u = src->data[1] + y * src->linesize[1];
+    const uint8_t *v = src->data[2] + y * src->linesize[2];
+    uint8_t *uv = dst->data[1] + y * dst->linesize[1];
+    for (int x = 0; x < cw; x++) {
+      uv[2 * x] = u[x];
+      uv[2 * x + 1] = v[x];
+    }
+  }
+  return dst;
+}
+
+// 两幅图像可见区域逐字节相同
+bool sameImage(const QImage &a, const QImage &b) {
+  int bytes = a.width() * a.depth() / 8;
+  for (int y = 0; y < a.height(); y++) {
+    if (memcmp(a.constScanLine(y), b.constScanLine(y), bytes) != 0)
+      return false;
+  }
+  return true;
+}
+
+// 按 8 位 R/G/B 分量比较两幅图像，返回平均绝对误差
+double imageDiff(const QImage &a, const QImage &b, int *maxDiff) {
+  QImage ca = a.convertToFormat(QImage::Format_RGB32);
+  QImage cb = b.convertToFormat(QImage::Format_RGB32);
+  qint64 sum = 0;
+  *maxDiff = 0;
+  for (int y = 0; y < ca.height(); y++) {
+    const QRgb *pa = reinterpret_cast<const QRgb *>(ca.constScanLine(y));
+    const QRgb *pb = reinterpret_cast<const QRgb *>(cb.constScanLine(y));
+    for (int x = 0; x < ca.width(); x++) {
+      int d[3] = {abs(qRed(pa[x]) - qRed(pb[x])),
+                  abs(qGreen(pa[x]) - qGreen(pb[x])),
+                  abs(qBlue(pa[x]) - qBlue(pb[x]))};
+      for (int c : d) {
+        sum += c;
+        *maxDiff = std::max(*maxDiff, c);
+      }
+    }
+  }
+  qint64 samples = qint64(ca.width()) * ca.height() * 3;
+  return samples > 0 ? double(sum) / samples : 0;
+}
+} // namespace
+
+namespace Benchmark {
+
+int seekLatency(const QString &path, int count) {
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+          0 ||
+      ProbeCache::findStreamInfo(fmt, path) < 0) {
+    qDebug() << "Cannot open" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  AVCodec *decoder = nullptr;
+  int stream =
+      av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  if (stream < 0 || !decoder || fmt->duration <= 0) {
+    qDebug() << "No seekable video stream in" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  AVCodecContext *codec = avcodec_alloc_context3(decoder);
+  avcodec_parameters_to_context(codec, fmt->streams[stream]->codecpar);
+  if (avcodec_open2(codec, decoder, nullptr) < 0) {
+    qDebug() << "Cannot open decoder for" << path;
+    avcodec_free_context(&codec);
+    avformat_close_input(&fmt);
+    return 1;
+  }
+
+  KeyframeIndex index;
+  bool useIndex = KeyframeIndex::supportsByteSeek(fmt);
+  if (useIndex && (!index.load(path) || index.streamIndex() != stream)) {
+    std::atomic<bool> abort{false};
+    Clock::time_point begin = Clock::now();
+    useIndex = index.build(path, stream, abort);
+    if (useIndex) {
+      index.save(path);
+      qDebug() << "Keyframe index built in" << elapsedUs(begin) / 1000
+               << "ms," << index.entries().size() << "keyframes";
+    }
+  }
+  if (!useIndex)
+    qDebug() << "Container" << fmt->iformat->name
+             << "does not use the keyframe index; timestamp seek only";
+
+  // 固定步长的伪随机序列，保证两种方式 seek 到相同位置
+  qint64 durationMs = fmt->duration / (AV_TIME_BASE / 1000);
+  std::vector<qint64> targets;
+  quint32 seed = 12345;
+  for (int i = 0; i < count; i++) {
+    seed = seed * 1103515245u + 12345u;
+    targets.push_back((seed >> 8) % static_cast<quint32>(durationMs));
+  }
+
+  AVPacket *pkt = av_packet_alloc();
+  AVFrame *frame = av_frame_alloc();
+  Stats byTimestamp, byIndex, accurate;
+  int discarded = 0;
+  for (qint64 target : targets) {
+    Clock::time_point begin = Clock::now();
+    avcodec_flush_buffers(codec);
+    if (av_seek_frame(fmt, -1, target * (AV_TIME_BASE / 1000),
+                      AVSEEK_FLAG_BACKWARD) >= 0 &&
+        decodeOneFrame(fmt, codec, stream, pkt, frame))
+      byTimestamp.samples.push_back(elapsedUs(begin));
+    else
+      byTimestamp.failures++;
+    av_frame_unref(frame);
+
+    if (!useIndex)
+      continue;
+    KeyframeIndex::Entry kf;
+    begin = Clock::now();
+    avcodec_flush_buffers(codec);
+    if (index.lookup(target, &kf) &&
+        av_seek_frame(fmt, -1, kf.pos, AVSEEK_FLAG_BYTE) >= 0 &&
+        decodeOneFrame(fmt, codec, stream, pkt, frame))
+      byIndex.samples.push_back(elapsedUs(begin));
+    else
+      byIndex.failures++;
+    av_frame_unref(frame);
+  }
+
+  // 精确跳转：与播放器相同，有索引时按索引定位到关键帧，再解码到目标
+  for (qint64 target : targets) {
+    KeyframeIndex::Entry kf;
+    Clock::time_point begin = Clock::now();
+    avcodec_flush_buffers(codec);
+    bool positioned = useIndex && index.lookup(target, &kf) &&
+                      av_seek_frame(fmt, -1, kf.pos, AVSEEK_FLAG_BYTE) >= 0;
+    if (!positioned)
+      positioned = av_seek_frame(fmt, -1, target * (AV_TIME_BASE / 1000),
+                                 AVSEEK_FLAG_BACKWARD) >= 0;
+    if (positioned &&
+        decodeToTarget(fmt, codec, stream, pkt, frame, target, &discarded))
+      accurate.samples.push_back(elapsedUs(begin));
+    else
+      accurate.failures++;
+    av_frame_unref(frame);
+  }
+
+  qDebug() << "Seek latency over" << count << "seeks in" << path;
+  byTimestamp.print("timestamp seek");
+  if (useIndex)
+    byIndex.print("keyframe index seek");
+  accurate.print("accurate seek");
+  qDebug() << "accurate seek decoded and discarded"
+           << (count > 0 ? discarded / double(count) : 0.0)
+           << "frames per seek on average";
+
+  av_frame_free(&frame);
+  av_packet_free(&pkt);
+  avcodec_free_context(&codec);
+  avformat_close_input(&fmt);
+  return 0;
+}
+
+int inputThroughput(const QString &path) {
+  std::unique_ptr<MediaSource> source =
+      MediaSource::create(path, MediaSource::Options());
+  if (!source || !source->avioContext()) {
+    qDebug() << "No custom input source for" << path;
+    return 1;
+  }
+  qDebug() << "Input source:" << source->describe();
+
+  Clock::time_point begin = Clock::now();
+  AVFormatContext *fmt = avformat_alloc_context();
+  fmt->pb = source->avioContext();
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+      0) {
+    qDebug() << "Cannot open" << path;
+    return 1;
+  }
+  avformat_find_stream_info(fmt, nullptr);
+
+  // 顺序读完，再回到开头和中间各读一段，模拟回看
+  AVPacket *pkt = av_packet_alloc();
+  qint64 packets = 0;
+  while (av_read_frame(fmt, pkt) >= 0) {
+    packets++;
+    av_packet_unref(pkt);
+  }
+  qint64 durationUs = fmt->duration > 0 ? fmt->duration : 0;
+  for (qint64 ts : {qint64(0), durationUs / 2}) {
+    if (av_seek_frame(fmt, -1, ts, AVSEEK_FLAG_BACKWARD) < 0)
+      continue;
+    for (int i = 0; i < 200 && av_read_frame(fmt, pkt) >= 0; i++)
+      av_packet_unref(pkt);
+  }
+  qint64 totalMs = elapsedUs(begin) / 1000;
+  av_packet_free(&pkt);
+  avformat_close_input(&fmt);
+
+  IoStats io = source->stats();
+  qDebug() << "Read" << packets << "packets," << io.bytesRead << "bytes in"
+           << totalMs << "ms";
+  qDebug() << "Reads" << io.readCalls << "max us" << io.maxReadUs << "stalls"
+           << io.stalls << "stall ms" << io.stallUs / 1000;
+  if (io.cacheHits + io.cacheMisses > 0)
+    qDebug() << "Cache hits" << io.cacheHits << "misses" << io.cacheMisses
+             << "hit rate"
+             << 100.0 * io.cacheHits / (io.cacheHits + io.cacheMisses) << "%";
+  return 0;
+}
+
+int decodeFps(const QString &path, int frames) {
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+          0 ||
+      ProbeCache::findStreamInfo(fmt, path) < 0) {
+    qDebug() << "Cannot open" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  AVCodec *decoder = nullptr;
+  int stream =
+      av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  if (stream < 0 || !decoder) {
+    qDebug() << "No video stream in" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  for (unsigned i = 0; i < fmt->nb_streams; i++)
+    fmt->streams[i]->discard =
+        static_cast<int>(i) == stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+  // 先把 packet 读进内存，只测解码本身
+  std::vector<AVPacket *> packets;
+  AVPacket *pkt = av_packet_alloc();
+  while (static_cast<int>(packets.size()) < frames &&
+         av_read_frame(fmt, pkt) >= 0) {
+    if (pkt->stream_index == stream) {
+      packets.push_back(av_packet_clone(pkt));
+    }
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+
+  struct Config {
+    const char *name;
+    DecoderThreading threading;
+  };
+  std::vector<Config> configs;
+  DecoderThreading single;
+  single.threadCount = 1;
+  configs.push_back({"1 thread", single});
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  DecoderThreading slice;
+  slice.threadCount = cores;
+  slice.lowDelay = true;
+  configs.push_back({"slice (low delay)", slice});
+  for (int n = 2; n <= cores; n++) {
+    DecoderThreading frame;
+    frame.threadCount = n;
+    configs.push_back({"frame+slice", frame});
+  }
+  configs.push_back({"auto", DecoderThreading()});
+
+  qDebug() << "Decoding" << packets.size() << "packets of" << decoder->name
+           << "from" << path << "on" << cores << "cores";
+  AVFrame *frame = av_frame_alloc();
+  for (const Config &config : configs) {
+    AVCodecContext *codec = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(codec, fmt->streams[stream]->codecpar);
+    FFMpegDecoder::applyThreading(codec, config.threading);
+    if (avcodec_open2(codec, decoder, nullptr) < 0) {
+      qDebug() << config.name << ": cannot open decoder";
+      avcodec_free_context(&codec);
+      continue;
+    }
+    int decoded = 0;
+    Clock::time_point begin = Clock::now();
+    for (AVPacket *p : packets) {
+      if (avcodec_send_packet(codec, p) < 0)
+        continue;
+      while (avcodec_receive_frame(codec, frame) == 0)
+        decoded++;
+    }
+    avcodec_send_packet(codec, nullptr);
+    while (avcodec_receive_frame(codec, frame) == 0)
+      decoded++;
+    qint64 us = elapsedUs(begin);
+    qDebug().nospace() << config.name << " x" << codec->thread_count << ": "
+                       << decoded << " frames, "
+                       << (us > 0 ? decoded * 1000000.0 / us : 0) << " fps";
+    avcodec_free_context(&codec);
+  }
+  av_frame_free(&frame);
+  for (AVPacket *p : packets)
+    av_packet_free(&p);
+  avformat_close_input(&fmt);
+  return 0;
+}
+
+int paintCost(const QString &path, int rounds) {
+  AVFrame *frame = av_frame_alloc();
+  if (!decodeFirstFrame(path, frame)) {
+    qDebug() << "Cannot decode a video frame from" << path;
+    av_frame_free(&frame);
+    return 1;
+  }
+
+  // 模拟屏幕后备缓冲：16 位屏为 RGB16，其余为 ARGB32_Premultiplied
+  QScreen *screen = QGuiApplication::primaryScreen();
+  int depth = screen ? screen->depth() : 32;
+  QSize screenSize = screen ? screen->size() : QSize(1920, 1080);
+  QImage canvas(screenSize, depth <= 16 ? QImage::Format_RGB16
+                                        : QImage::Format_ARGB32_Premultiplied);
+  QSize fit(frame->width, frame->height);
+  fit.scale(screenSize, Qt::KeepAspectRatio);
+  qDebug() << "Screen" << screenSize << "depth" << depth << ", frame"
+           << frame->width << "x" << frame->height << "->" << fit;
+
+  struct Candidate {
+    const char *name;
+    QImage::Format format;
+    bool dither;
+  };
+  const Candidate candidates[] = {
+      {"RGB888", QImage::Format_RGB888, false},
+      {"RGB32", QImage::Format_RGB32, false},
+      {"ARGB32_Premultiplied", QImage::Format_ARGB32_Premultiplied, false},
+      {"RGB16", QImage::Format_RGB16, false},
+      {"RGB16 + dither", QImage::Format_RGB16, true},
+  };
+  for (const Candidate &c : candidates) {
+    FrameConverter converter;
+    if (!converter.configure(frame->width, frame->height,
+                             (AVPixelFormat)frame->format, fit.width(),
+                             fit.height(), c.format, c.dither)) {
+      qDebug() << c.name << ": no converter";
+      continue;
+    }
+    QImage image(fit, c.format);
+
+    Clock::time_point begin = Clock::now();
+    for (int i = 0; i < rounds; i++)
+      converter.convert(frame, image.bits(), image.bytesPerLine());
+    qint64 convertUs = elapsedUs(begin) / rounds;
+
+    QPainter painter(&canvas);
+    begin = Clock::now();
+    for (int i = 0; i < rounds; i++)
+      painter.drawImage(0, 0, image);
+    painter.end();
+    qint64 paintUs = elapsedUs(begin) / rounds;
+
+    qDebug().nospace() << c.name << " (" << converter.pathName()
+                       << "): convert " << convertUs / 1000.0
+                       << " ms, paint " << paintUs / 1000.0 << " ms, total "
+                       << (convertUs + paintUs) / 1000.0 << " ms per frame";
+  }
+  av_frame_free(&frame);
+  return 0;
+}
+
+int convertThroughput(const QString &path, int rounds) {
+  AVFrame *decoded = av_frame_alloc();
+  if (!decodeFirstFrame(path, decoded)) {
+    qDebug() << "Cannot decode a video frame from" << path;
+    av_frame_free(&decoded);
+    return 1;
+  }
+  AVFrame *sources[2] = {toYuv420p(decoded), nullptr};
+  av_frame_free(&decoded);
+  if (!sources[0]) {
+    qDebug() << "Cannot convert the frame to yuv420p";
+    return 1;
+  }
+  sources[1] = toNv12(sources[0]);
+
+  struct Target {
+    const char *name;
+    QImage::Format format;
+    bool dither;
+  };
+  const Target targets[] = {
+      {"RGB32", QImage::Format_RGB32, false},
+      {"RGB16", QImage::Format_RGB16, false},
+      {"RGB16 + dither", QImage::Format_RGB16, true},
+  };
+  // 原尺寸、缩小到 3/4（适配窗口的典型情况）、缩小一半、缩小 3 倍和 6 倍
+  // （1080p/4K 在小屏上播放，走 box 预缩小）、放大 1.5 倍
+  const int scales[][2] = {{1, 1}, {3, 4}, {1, 2}, {1, 3}, {1, 6}, {3, 2}};
+  // 吞吐只比较原尺寸、3/4 和缩小 3 倍
+  const int timedScales[] = {0, 1, 3};
+  const ConvertKernels::Isa simd[] = {ConvertKernels::Sse2,
+                                      ConvertKernels::Avx2,
+                                      ConvertKernels::Neon};
+  qDebug() << "Best kernel:" << ConvertKernels::get()->name;
+
+  // 正确性：各 SIMD 内核与 C 版本逐字节一致，C 版本与 swscale 的误差在范围内
+  int failures = 0;
+  for (AVFrame *src : sources) {
+    if (!src)
+      continue;
+    const char *srcName = av_get_pix_fmt_name((AVPixelFormat)src->format);
+    for (const Target &t : targets) {
+      for (const auto &scale : scales) {
+        QSize size(std::max(1, src->width * scale[0] / scale[1]),
+                   std::max(1, src->height * scale[0] / scale[1]));
+        FrameConverter converter;
+        if (!converter.configure(src->width, src->height,
+                                 (AVPixelFormat)src->format, size.width(),
+                                 size.height(), t.format, t.dither,
+                                 ConvertKernels::C)) {
+          qDebug() << srcName << t.name << size << ": no converter";
+          failures++;
+          continue;
+        }
+        QImage ref(size, t.format);
+        converter.convert(src, ref.bits(), ref.bytesPerLine());
+
+        QString mismatched;
+        for (ConvertKernels::Isa isa : simd) {
+          if (!ConvertKernels::get(isa))
+            continue;
+          converter.configure(src->width, src->height,
+                              (AVPixelFormat)src->format, size.width(),
+                              size.height(), t.format, t.dither, isa);
+          QImage out(size, t.format);
+          converter.convert(src, out.bits(), out.bytesPerLine());
+          if (!sameImage(ref, out))
+            mismatched += QString(" ") + converter.pathName();
+        }
+
+        QImage expected(size, t.format);
+        SwsContext *sws = FrameConverter::createScaler(
+            src->width, src->height, (AVPixelFormat)src->format,
+            size.width(), size.height(), t.format, t.dither);
+        uint8_t *dst[1] = {expected.bits()};
+        int dstStride[1] = {expected.bytesPerLine()};
+        sws_scale(sws, src->data, src->linesize, 0, src->height, dst,
+                  dstStride);
+        sws_freeContext(sws);
+        int maxDiff = 0;
+        double meanDiff = imageDiff(ref, expected, &maxDiff);
+        // 缩放时采样相位和色度插值与 sws 不完全相同，RGB16 另有量化/抖动误差
+        double tolerance = (scale[0] == scale[1] ? 1.5 : 3.0) +
+                           (t.format == QImage::Format_RGB16 ? 4.0 : 0.0);
+        bool ok = mismatched.isEmpty() && meanDiff <= tolerance;
+        if (!ok)
+          failures++;
+        qDebug().nospace() << (ok ? "PASS " : "FAIL ") << srcName << " -> "
+                           << t.name << " " << size.width() << "x"
+                           << size.height() << ": vs swscale mean "
+                           << meanDiff << " max " << maxDiff
+                           << (mismatched.isEmpty()
+                                   ? QString()
+                                   : ", differs from c:" + mismatched);
+      }
+    }
+  }
+
+  // 吞吐：与 swscale 比较单帧转换耗时
+  AVFrame *src = sources[0];
+  for (const Target &t : targets) {
+    for (int s : timedScales) {
+      QSize size(src->width * scales[s][0] / scales[s][1],
+                 src->height * scales[s][0] / scales[s][1]);
+      QImage out(size, t.format);
+      SwsContext *sws = FrameConverter::createScaler(
+          src->width, src->height, (AVPixelFormat)src->format, size.width(),
+          size.height(), t.format, t.dither);
+      uint8_t *dst[1] = {out.bits()};
+      int dstStride[1] = {out.bytesPerLine()};
+      Clock::time_point begin = Clock::now();
+      for (int i = 0; i < rounds; i++)
+        sws_scale(sws, src->data, src->linesize, 0, src->height, dst,
+                  dstStride);
+      qint64 swsUs = std::max<qint64>(1, elapsedUs(begin) / rounds);
+      sws_freeContext(sws);
+      qDebug().nospace() << t.name << " " << size.width() << "x"
+                         << size.height() << ": swscale " << swsUs / 1000.0
+                         << " ms";
+
+      const ConvertKernels::Isa all[] = {ConvertKernels::C, ConvertKernels::Sse2,
+                                         ConvertKernels::Avx2,
+                                         ConvertKernels::Neon};
+      for (ConvertKernels::Isa isa : all) {
+        FrameConverter converter;
+        if (!ConvertKernels::get(isa) ||
+            !converter.configure(src->width, src->height,
+                                 (AVPixelFormat)src->format, size.width(),
+                                 size.height(), t.format, t.dither, isa))
+          continue;
+        begin = Clock::now();
+        for (int i = 0; i < rounds; i++)
+          converter.convert(src, out.bits(), out.bytesPerLine());
+        qint64 us = std::max<qint64>(1, elapsedUs(begin) / rounds);
+        qDebug().nospace() << "  " << converter.pathName() << ": "
+                           << us / 1000.0 << " ms, " << double(swsUs) / us
+                           << "x";
+      }
+    }
+  }
+
+  for (AVFrame *f : sources)
+    av_frame_free(&f);
+  qDebug() << (failures ? "Conversion check FAILED:" : "Conversion check passed,")
+           << failures << "failures";
+  return failures ? 1 : 0;
+}
+
+int convertSlices(const QString &path, int rounds) {
+  AVFrame *decoded = av_frame_alloc();
+  if (!decodeFirstFrame(path, decoded)) {
+    qDebug() << "Cannot decode a video frame from" << path;
+    av_frame_free(&decoded);
+    return 1;
+  }
+  AVFrame *src = toYuv420p(decoded);
+  av_frame_free(&decoded);
+  if (!src) {
+    qDebug() << "Cannot convert the frame to yuv420p";
+    return 1;
+  }
+
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  int failures = 0;
+  // 原尺寸、3/4、缩小 3 倍（小屏播放 1080p/4K，先做 box 预缩小）
+  const int scales[][2] = {{1, 1}, {3, 4}, {1, 3}};
+  for (const auto &scale : scales) {
+    QSize size(std::max(1, src->width * scale[0] / scale[1]),
+               std::max(1, src->height * scale[0] / scale[1]));
+    QImage ref(size, QImage::Format_RGB32);
+    qint64 singleUs = 0;
+    for (int threads = 1; threads <= cores; threads++) {
+      FrameConverter converter;
+      converter.setThreadCount(threads);
+      if (!converter.configure(src->width, src->height,
+                               (AVPixelFormat)src->format, size.width(),
+                               size.height(), QImage::Format_RGB32, false)) {
+        qDebug() << "No converter for" << size;
+        failures++;
+        break;
+      }
+      QImage out(size, QImage::Format_RGB32);
+      converter.convert(src, out.bits(), out.bytesPerLine());
+      if (threads == 1)
+        ref = out.copy();
+      bool same = sameImage(ref, out);
+      if (!same)
+        failures++;
+
+      Clock::time_point begin = Clock::now();
+      for (int i = 0; i < rounds; i++)
+        converter.convert(src, out.bits(), out.bytesPerLine());
+      qint64 us = std::max<qint64>(1, elapsedUs(begin) / rounds);
+      if (threads == 1)
+        singleUs = us;
+      qDebug().nospace() << src->width << "x" << src->height << " -> "
+                         << size.width() << "x" << size.height() << " ("
+                         << converter.pathName() << ") threads " << threads
+                         << ": " << us / 1000.0 << " ms, "
+                         << double(singleUs) / us << "x"
+                         << (same ? "" : ", output differs from 1 thread");
+    }
+  }
+  av_frame_free(&src);
+  return failures ? 1 : 0;
+}
+
+int lowresCost(const QString &path, int frames) {
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+          0 ||
+      ProbeCache::findStreamInfo(fmt, path) < 0) {
+    qDebug() << "Cannot open" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  AVCodec *decoder = nullptr;
+  int stream =
+      av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  if (stream < 0 || !decoder) {
+    qDebug() << "No video stream in" << path;
+    avformat_close_input(&fmt);
+    return 1;
+  }
+  for (unsigned i = 0; i < fmt->nb_streams; i++)
+    fmt->streams[i]->discard =
+        static_cast<int>(i) == stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+  std::vector<AVPacket *> packets;
+  AVPacket *pkt = av_packet_alloc();
+  while (static_cast<int>(packets.size()) < frames &&
+         av_read_frame(fmt, pkt) >= 0) {
+    if (pkt->stream_index == stream)
+      packets.push_back(av_packet_clone(pkt));
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+
+  QScreen *screen = QGuiApplication::primaryScreen();
+  QSize box = screen ? screen->size() : QSize(1920, 1080);
+  const AVCodecParameters *par = fmt->streams[stream]->codecpar;
+  int maxLowres = av_codec_get_max_lowres(decoder);
+  int chosen = FFMpegDecoder::lowresFor(par->width, par->height, box, 3);
+  qDebug() << "Source" << par->width << "x" << par->height << decoder->name
+           << ", display" << box << ", codec max lowres" << maxLowres
+           << ", player would shrink by" << (1 << chosen);
+
+  // 单线程解码，CPU 时间即解码开销；另外统计一帧解码输出占用的内存
+  struct Config {
+    QString name;
+    int lowres;
+    bool cheap;    // 无 lowres 时的便宜路径：跳过环路滤波 + 快速解码
+    bool decimate; // 转换前按 2^n 预缩小
+  };
+  std::vector<Config> configs;
+  configs.push_back({"full", 0, false, true});
+  for (int n = 1; n <= maxLowres; n++)
+    configs.push_back({QString("lowres %1 (1/%2)").arg(n).arg(1 << n), n,
+                       false, true});
+  configs.push_back({"skip loop filter + fast", 0, true, true});
+  // 对照：不做预缩小时整帧交给转换（超过 2 倍的缩小回退到 swscale）
+  configs.push_back(
+      {"skip loop filter + fast, no pre-decimation", 0, true, false});
+
+  AVFrame *frame = av_frame_alloc();
+  for (const Config &config : configs) {
+    AVCodecContext *codec = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(codec, par);
+    codec->thread_count = 1;
+    codec->lowres = config.lowres;
+    if (config.cheap) {
+      codec->flags2 |= AV_CODEC_FLAG2_FAST;
+      codec->skip_loop_filter = AVDISCARD_ALL;
+    }
+    if (avcodec_open2(codec, decoder, nullptr) < 0) {
+      qDebug() << config.name << ": cannot open decoder";
+      avcodec_free_context(&codec);
+      continue;
+    }
+
+    FrameConverter converter;
+    converter.setPreDecimation(config.decimate);
+    QImage out;
+    int decoded = 0;
+    size_t frameBytes = 0;
+    qint64 convertUs = 0;
+    QSize frameSize;
+    std::clock_t cpuBegin = std::clock();
+    Clock::time_point begin = Clock::now();
+    auto receive = [&] {
+      while (avcodec_receive_frame(codec, frame) == 0) {
+        decoded++;
+        if (frameSize != QSize(frame->width, frame->height)) {
+          frameSize = QSize(frame->width, frame->height);
+          QSize fit = frameSize.scaled(box, Qt::KeepAspectRatio);
+          converter.configure(frame->width, frame->height,
+                              (AVPixelFormat)frame->format, fit.width(),
+                              fit.height(), QImage::Format_RGB32, false);
+          out = QImage(fit, QImage::Format_RGB32);
+          frameBytes = 0;
+          for (AVBufferRef *buf : frame->buf) {
+            if (buf)
+              frameBytes += buf->size;
+          }
+        }
+        Clock::time_point convertBegin = Clock::now();
+        converter.convert(frame, out.bits(), out.bytesPerLine());
+        convertUs += elapsedUs(convertBegin);
+      }
+    };
+    for (AVPacket *p : packets) {
+      if (avcodec_send_packet(codec, p) >= 0)
+        receive();
+    }
+    avcodec_send_packet(codec, nullptr);
+    receive();
+    qint64 wallUs = elapsedUs(begin) - convertUs;
+    double cpuMs = double(std::clock() - cpuBegin) * 1000 / CLOCKS_PER_SEC -
+                   convertUs / 1000.0;
+    int n = std::max(1, decoded);
+    qDebug().nospace() << config.name << " " << frameSize.width() << "x"
+                       << frameSize.height() << ": decode "
+                       << wallUs / 1000.0 / n << " ms/frame (cpu " << cpuMs / n << " ms), convert "
+                       << convertUs / 1000.0 / n << " ms/frame via "
+                       << converter.pathName() << " from "
+                       << converter.decimatedSize().width() << "x"
+                       << converter.decimatedSize().height()
+                       << ", frame buffers "
+                       << frameBytes / 1024 << " KB x "
+                       << codec->refs + 1 << " refs";
+    avcodec_free_context(&codec);
+  }
+  av_frame_free(&frame);
+  for (AVPacket *p : packets)
+    av_packet_free(&p);
+  avformat_close_input(&fmt);
+  return 0;
+}
+
+int frameStep(const QString &path, int steps) {
+  QScreen *screen = QGuiApplication::primaryScreen();
+  QSize box = (screen ? screen->size() : QSize(1920, 1080))
+                  .boundedTo(QSize(960, 540));
+  GopDecoder decoder;
+  if (!decoder.open(path, box)) {
+    qDebug() << "No video stream in" << path;
+    return 1;
+  }
+  qint64 duration = decoder.durationMs();
+  if (duration <= 0) {
+    qDebug() << "Unknown duration:" << path;
+    return 1;
+  }
+
+  // 与 FrameStepper 相同的流程：先查缓存，未命中时解码所需的 GOP 再查一次
+  // （这里没有后台预取，未命中的步进包含完整的 GOP 解码时间）
+  GopCache cache;
+  int gops = 0;
+  qint64 gop_us = 0, gop_span_ms = 0, gop_frames = 0;
+  auto step = [&](qint64 from, int direction, GopCache::Frame *frame,
+                  bool *hit) {
+    qint64 need;
+    *hit = cache.find(from, direction, frame, &need);
+    if (*hit)
+      return true;
+    if (need < 0)
+      return false;
+    std::shared_ptr<GopCache::Gop> gop =
+        decoder.decodeGop(need, cache.budget() / 2);
+    if (!gop)
+      return false;
+    gops++;
+    gop_us += decoder.lastDecodeUs();
+    gop_frames += gop->frames.size();
+    gop_span_ms += gop->frames.back().ms - gop->frames.front().ms;
+    cache.insert(gop);
+    return cache.find(from, direction, frame, &need, false);
+  };
+
+  // 从中间开始后退 steps 帧，再前进 2 * steps 帧（前一半走回缓存里的帧）
+  struct Pass {
+    const char *name;
+    int direction;
+    int steps;
+  };
+  const Pass passes[] = {{"backward", -1, steps}, {"forward", 1, 2 * steps}};
+  qint64 pos = duration / 2;
+  for (const Pass &pass : passes) {
+    Stats hits, misses;
+    int moved = 0;
+    for (int i = 0; i < pass.steps; i++) {
+      Clock::time_point begin = Clock::now();
+      GopCache::Frame frame;
+      bool hit = false;
+      if (!step(pos, pass.direction, &frame, &hit))
+        break;
+      (hit ? hits : misses).samples.push_back(elapsedUs(begin));
+      pos = frame.ms;
+      moved++;
+    }
+    qDebug() << "Step" << pass.name << moved << "frames, now at" << pos << "ms";
+    hits.print(QString("  %1 cache hit").arg(pass.name).toUtf8().constData());
+    misses.print(
+        QString("  %1 GOP decode").arg(pass.name).toUtf8().constData());
+  }
+
+  GopCache::Stats stats = cache.stats();
+  qint64 lookups = stats.hits + stats.misses;
+  qDebug() << "Cache:" << stats.gops << "GOPs," << stats.frames << "frames,"
+           << stats.bytes / 1024 << "/" << stats.budget / 1024
+           << "KB, hit rate"
+           << (lookups > 0 ? 100.0 * stats.hits / lookups : 0.0) << "%";
+  if (gops > 0) {
+    // 倒放要在一个 GOP 放完之前解出上一个 GOP：解码速度须达到倒放倍速
+    double realtime = gop_us > 0 ? gop_span_ms * 1000.0 / gop_us : 0.0;
+    qDebug() << "GOP decode:" << gops << "GOPs, avg" << gop_us / gops / 1000.0
+             << "ms for" << gop_frames / gops << "frames /"
+             << gop_span_ms / gops << "ms of video," << realtime
+             << "x real time (reverse playback needs >= its speed)";
+  }
+  return 0;
+}
+
+} // namespace Benchmark
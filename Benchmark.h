@@ -0,0 +1,44 @@
+#pragma once
+#include <QString>
+
+// 命令行性能测试，结果通过 qDebug 输出，返回进程退出码
+namespace Benchmark {
+
+// seek 延迟：对同一组目标位置分别用时间戳 seek 和关键帧索引字节 seek，
+// 统计从发起 seek 到解出第一帧画面的耗时（快速跳转）；再统计精确跳转
+// 解码到目标帧的耗时和途中丢弃的帧数
+int seekLatency(const QString &path, int count = 20);
+
+// 输入层吞吐：通过 MediaSource 解复用整个文件（本地路径或 http URL），
+// 再做若干次回跳，输出读取耗时、卡顿时间和缓存命中率
+int inputThroughput(const QString &path);
+
+// 解码吞吐：对每种线程配置（单线程、片级、帧级 1~核数）尽快解码前 frames 帧，
+// 输出平均 fps
+int decodeFps(const QString &path, int frames = 600);
+
+// 显示格式：把第一帧按各候选格式转换到屏幕尺寸，并绘制到与屏幕后备缓冲
+// 相同格式的画布上，分别输出转换和绘制的单帧耗时
+int paintCost(const QString &path, int rounds = 50);
+
+// 帧转换：先校验各 SIMD 内核与 C 版本逐字节一致、C 版本与 swscale 误差在
+// 容许范围内（yuv420p/nv12 → RGB32/RGB16，原尺寸及缩放，含 3 倍以上缩小），
+// 再比较各内核与 swscale 的单帧转换耗时；校验失败时返回非零
+int convertThroughput(const QString &path, int rounds = 100);
+
+// 条带并行转换：第一帧按原尺寸、3/4 和 1/3 尺寸转换为 RGB32，线程数从 1 到
+// CPU 核数，输出单帧转换延迟和相对单线程的加速比，并确认结果与单线程逐字节一致
+int convertSlices(const QString &path, int rounds = 100);
+
+// 降分辨率解码：按屏幕尺寸对前 frames 帧分别用完整解码、各级 lowres 和
+// 跳过环路滤波的快速解码单线程解码，输出每帧解码耗时、CPU 时间、
+// 转换到屏幕尺寸的耗时（快速解码另测一遍不做 2^n 预缩小的转换作对照）
+// 和解码输出的内存占用
+int lowresCost(const QString &path, int frames = 300);
+
+// 逐帧步进：从文件中间用 GopDecoder + GopCache 后退 steps 帧再前进，
+// 分别统计缓存命中和需要解码 GOP 的单步延迟，输出缓存占用、命中率，
+// 以及 GOP 解码速度相对实时的倍数（决定倒放能否跟上）
+int frameStep(const QString &path, int steps = 100);
+
+} // namespace Benchmark
@@ -0,0 +1,459 @@
+#include "ConvertKernels.h"
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#define CONVERT_HAVE_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CONVERT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// BT.601 有限范围（swscale 的默认矩阵），按 Q6 定点计算：
+//   Yc = 74 (Y-16) + ((133 (Y-16) + 128) >> 8)   即 1.1644 × 64
+//   R = (Yc               + 102 (V-128) + 32) >> 6
+//   G = (Yc - 25 (U-128)  - 52 (V-128)  + 32) >> 6
+//   B = (Yc + 129 (U-128)               + 32) >> 6
+// 中间值在 16 位有符号范围内（只有 B 的上溢需要饱和，饱和后结果仍为 255），
+// 因此 SIMD 版本用 16 位饱和运算即可与 C 版本逐位一致
+namespace {
+enum DstFormat { RGB32, RGB565 };
+
+const int CY = 74, CY_FRAC = 133, CRV = 102, CGU = 25, CGV = 52, CBU = 129;
+
+inline uint8_t clamp255(int v) {
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+template <DstFormat F>
+inline void storePixel(uint8_t *dst, int x, int r, int g, int b,
+                       const uint8_t *dither) {
+  if (F == RGB32) {
+    dst[x * 4 + 0] = clamp255(b);
+    dst[x * 4 + 1] = clamp255(g);
+    dst[x * 4 + 2] = clamp255(r);
+    dst[x * 4 + 3] = 255;
+  } else {
+    int rb = 0, gd = 0;
+    if (dither) {
+      rb = dither[x & 15];
+      gd = rb >> 1;
+    }
+    int r8 = std::min(255, clamp255(r) + rb);
+    int g8 = std::min(255, clamp255(g) + gd);
+    int b8 = std::min(255, clamp255(b) + rb);
+    reinterpret_cast<uint16_t *>(dst)[x] =
+        static_cast<uint16_t>(((r8 >> 3) << 11) | ((g8 >> 2) << 5) | (b8 >> 3));
+  }
+}
+
+template <DstFormat F>
+void rowC(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+          int width, const uint8_t *dither) {
+  for (int x = 0; x < width; x++) {
+    int yy = y[x] - 16;
+    int c = CY * yy + ((CY_FRAC * yy + 128) >> 8);
+    int d = u[x >> 1] - 128;
+    int e = v[x >> 1] - 128;
+    int r = (c + CRV * e + 32) >> 6;
+    int g = (c - CGU * d - CGV * e + 32) >> 6;
+    int b = (c + CBU * d + 32) >> 6;
+    storePixel<F>(dst, x, r, g, b, dither);
+  }
+}
+
+// 从 x0 开始用 C 版本处理剩余像素（x0 为 16 的倍数，色度与抖动相位不变）
+template <DstFormat F>
+inline void rowTail(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                    uint8_t *dst, int x0, int width, const uint8_t *dither) {
+  if (x0 >= width)
+    return;
+  int bpp = F == RGB32 ? 4 : 2;
+  rowC<F>(y + x0, u + x0 / 2, v + x0 / 2, dst + x0 * bpp, width - x0, dither);
+}
+
+void lerpC(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int w) {
+  int wa = 256 - w;
+  for (int i = 0; i < n; i++)
+    dst[i] = static_cast<uint8_t>((a[i] * wa + b[i] * w + 128) >> 8);
+}
+
+void halveC(const uint8_t *src, uint8_t *dst, int n, int unit) {
+  for (int i = 0; i < n; i++) {
+    for (int c = 0; c < unit; c++)
+      dst[i * unit + c] = static_cast<uint8_t>(
+          (src[2 * i * unit + c] + src[(2 * i + 1) * unit + c] + 1) >> 1);
+  }
+}
+
+#ifdef CONVERT_HAVE_X86
+// 8 个像素的 16 位 R/G/B（未移位、未截断）
+struct Rgb16x8 {
+  __m128i r, g, b;
+};
+
+inline Rgb16x8 yuvToRgbSse2(__m128i y16, __m128i u16, __m128i v16) {
+  const __m128i round = _mm_set1_epi16(32);
+  __m128i yy = _mm_sub_epi16(y16, _mm_set1_epi16(16));
+  __m128i c = _mm_add_epi16(
+      _mm_mullo_epi16(yy, _mm_set1_epi16(CY)),
+      _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(yy, _mm_set1_epi16(CY_FRAC)),
+                                   _mm_set1_epi16(128)),
+                     8));
+  __m128i d = _mm_sub_epi16(u16, _mm_set1_epi16(128));
+  __m128i e = _mm_sub_epi16(v16, _mm_set1_epi16(128));
+  Rgb16x8 out;
+  out.r = _mm_adds_epi16(c, _mm_mullo_epi16(e, _mm_set1_epi16(CRV)));
+  out.g = _mm_subs_epi16(
+      _mm_subs_epi16(c, _mm_mullo_epi16(d, _mm_set1_epi16(CGU))),
+      _mm_mullo_epi16(e, _mm_set1_epi16(CGV)));
+  out.b = _mm_adds_epi16(c, _mm_mullo_epi16(d, _mm_set1_epi16(CBU)));
+  out.r = _mm_srai_epi16(_mm_adds_epi16(out.r, round), 6);
+  out.g = _mm_srai_epi16(_mm_adds_epi16(out.g, round), 6);
+  out.b = _mm_srai_epi16(_mm_adds_epi16(out.b, round), 6);
+  return out;
+}
+
+// 16 个 8 位 R/G/B 写出为目标格式
+template <DstFormat F>
+inline void storeSse2(uint8_t *dst, __m128i r8, __m128i g8, __m128i b8,
+                      const uint8_t *dither) {
+  const __m128i zero = _mm_setzero_si128();
+  if (F == RGB32) {
+    const __m128i a8 = _mm_set1_epi8(static_cast<char>(0xff));
+    __m128i bg_lo = _mm_unpacklo_epi8(b8, g8);
+    __m128i bg_hi = _mm_unpackhi_epi8(b8, g8);
+    __m128i ra_lo = _mm_unpacklo_epi8(r8, a8);
+    __m128i ra_hi = _mm_unpackhi_epi8(r8, a8);
+    __m128i *out = reinterpret_cast<__m128i *>(dst);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(bg_lo, ra_lo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+  } else {
+    if (dither) {
+      __m128i drb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dither));
+      __m128i dg = _mm_and_si128(_mm_srli_epi16(drb, 1), _mm_set1_epi8(0x7f));
+      r8 = _mm_adds_epu8(r8, drb);
+      g8 = _mm_adds_epu8(g8, dg);
+      b8 = _mm_adds_epu8(b8, drb);
+    }
+    __m128i *out = reinterpret_cast<__m128i *>(dst);
+    for (int half = 0; half < 2; half++) {
+      __m128i r = half ? _mm_unpackhi_epi8(r8, zero) : _mm_unpacklo_epi8(r8, zero);
+      __m128i g = half ? _mm_unpackhi_epi8(g8, zero) : _mm_unpacklo_epi8(g8, zero);
+      __m128i b = half ? _mm_unpackhi_epi8(b8, zero) : _mm_unpacklo_epi8(b8, zero);
+      __m128i px = _mm_or_si128(
+          _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 3), 11),
+                       _mm_slli_epi16(_mm_srli_epi16(g, 2), 5)),
+          _mm_srli_epi16(b, 3));
+      _mm_storeu_si128(out + half, px);
+    }
+  }
+}
+
+template <DstFormat F>
+void rowSse2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+             uint8_t *dst, int width, const uint8_t *dither) {
+  const __m128i zero = _mm_setzero_si128();
+  const int bpp = F == RGB32 ? 4 : 2;
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+    __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+    __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+    __m128i u16 = _mm_unpacklo_epi8(u8, zero);
+    __m128i v16 = _mm_unpacklo_epi8(v8, zero);
+    // 每个色度样本对应两个像素
+    Rgb16x8 lo = yuvToRgbSse2(_mm_unpacklo_epi8(y8, zero),
+                              _mm_unpacklo_epi16(u16, u16),
+                              _mm_unpacklo_epi16(v16, v16));
+    Rgb16x8 hi = yuvToRgbSse2(_mm_unpackhi_epi8(y8, zero),
+                              _mm_unpackhi_epi16(u16, u16),
+                              _mm_unpackhi_epi16(v16, v16));
+    storeSse2<F>(dst + x * bpp, _mm_packus_epi16(lo.r, hi.r),
+                 _mm_packus_epi16(lo.g, hi.g), _mm_packus_epi16(lo.b, hi.b),
+                 dither);
+  }
+  rowTail<F>(y, u, v, dst, x, width, dither);
+}
+
+void lerpSse2(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int w) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i wa = _mm_set1_epi16(static_cast<short>(256 - w));
+  const __m128i wb = _mm_set1_epi16(static_cast<short>(w));
+  const __m128i round = _mm_set1_epi16(128);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    // 乘积最大 255*256，按无符号 16 位处理不会溢出
+    __m128i lo = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb)),
+        round);
+    __m128i hi = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb)),
+        round);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+                                      _mm_srli_epi16(hi, 8)));
+  }
+  lerpC(a + i, b + i, dst + i, n - i, w);
+}
+
+void halveSse2(const uint8_t *src, uint8_t *dst, int n, int unit) {
+  int i = 0;
+  if (unit == 1) {
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for (; i + 16 <= n; i += 16) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+      __m128i b =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 16));
+      // 偶数和奇数样本分到 16 位通道里取平均，再压回字节
+      __m128i lo = _mm_avg_epu16(_mm_and_si128(a, lowBytes), _mm_srli_epi16(a, 8));
+      __m128i hi = _mm_avg_epu16(_mm_and_si128(b, lowBytes), _mm_srli_epi16(b, 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                       _mm_packus_epi16(lo, hi));
+    }
+  } else {
+    for (; i + 8 <= n; i += 8) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+      __m128i b =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i + 16));
+      // 每个 32 位通道的低半和高半是相邻两个样本；平均后留在低 16 位，
+      // 符号扩展后用有符号饱和压缩取回原值
+      a = _mm_avg_epu8(a, _mm_srli_epi32(a, 16));
+      b = _mm_avg_epu8(b, _mm_srli_epi32(b, 16));
+      a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+      b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i),
+                       _mm_packs_epi32(a, b));
+    }
+  }
+  halveC(src + 2 * i * unit, dst + i * unit, n - i, unit);
+}
+
+// AVX2：整套 16 位运算一次处理 16 个像素，写出时沿用 SSE2 的交织
+#define CONVERT_AVX2 __attribute__((target("avx2")))
+
+CONVERT_AVX2 inline __m256i dupChromaAvx2(const uint8_t *p) {
+  __m128i c16 = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_unpacklo_epi16(c16, c16)),
+      _mm_unpackhi_epi16(c16, c16), 1);
+}
+
+CONVERT_AVX2 inline __m128i packAvx2(__m256i v) {
+  return _mm_packus_epi16(_mm256_castsi256_si128(v),
+                          _mm256_extracti128_si256(v, 1));
+}
+
+template <DstFormat F>
+CONVERT_AVX2 void rowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                          uint8_t *dst, int width, const uint8_t *dither) {
+  const __m256i round = _mm256_set1_epi16(32);
+  const int bpp = F == RGB32 ? 4 : 2;
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i y16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+    __m256i d = _mm256_sub_epi16(dupChromaAvx2(u + x / 2),
+                                 _mm256_set1_epi16(128));
+    __m256i e = _mm256_sub_epi16(dupChromaAvx2(v + x / 2),
+                                 _mm256_set1_epi16(128));
+    __m256i yy = _mm256_sub_epi16(y16, _mm256_set1_epi16(16));
+    __m256i c = _mm256_add_epi16(
+        _mm256_mullo_epi16(yy, _mm256_set1_epi16(CY)),
+        _mm256_srai_epi16(
+            _mm256_add_epi16(_mm256_mullo_epi16(yy, _mm256_set1_epi16(CY_FRAC)),
+                             _mm256_set1_epi16(128)),
+            8));
+    __m256i r = _mm256_adds_epi16(
+        c, _mm256_mullo_epi16(e, _mm256_set1_epi16(CRV)));
+    __m256i g = _mm256_subs_epi16(
+        _mm256_subs_epi16(c, _mm256_mullo_epi16(d, _mm256_set1_epi16(CGU))),
+        _mm256_mullo_epi16(e, _mm256_set1_epi16(CGV)));
+    __m256i b = _mm256_adds_epi16(
+        c, _mm256_mullo_epi16(d, _mm256_set1_epi16(CBU)));
+    r = _mm256_srai_epi16(_mm256_adds_epi16(r, round), 6);
+    g = _mm256_srai_epi16(_mm256_adds_epi16(g, round), 6);
+    b = _mm256_srai_epi16(_mm256_adds_epi16(b, round), 6);
+    storeSse2<F>(dst + x * bpp, packAvx2(r), packAvx2(g), packAvx2(b), dither);
+  }
+  rowTail<F>(y, u, v, dst, x, width, dither);
+}
+
+CONVERT_AVX2 void lerpAvx2(const uint8_t *a, const uint8_t *b, uint8_t *dst,
+                           int n, int w) {
+  const __m256i wa = _mm256_set1_epi16(static_cast<short>(256 - w));
+  const __m256i wb = _mm256_set1_epi16(static_cast<short>(w));
+  const __m256i round = _mm256_set1_epi16(128);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i va = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+    __m256i vb = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    __m256i s = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(va, wa), _mm256_mullo_epi16(vb, wb)),
+        round);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     packAvx2(_mm256_srli_epi16(s, 8)));
+  }
+  lerpC(a + i, b + i, dst + i, n - i, w);
+}
+#endif // CONVERT_HAVE_X86
+
+#ifdef CONVERT_HAVE_NEON
+inline uint8x8_t yuvToChannelNeon(int16x8_t base, int16x8_t term) {
+  // vqrshrun：(x + 32) >> 6 后饱和到 0~255
+  return vqrshrun_n_s16(vqaddq_s16(base, term), 6);
+}
+
+template <DstFormat F>
+void rowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+             uint8_t *dst, int width, const uint8_t *dither) {
+  const int bpp = F == RGB32 ? 4 : 2;
+  const int16x8_t bias16 = vdupq_n_s16(16);
+  const int16x8_t bias128 = vdupq_n_s16(128);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x16_t y8 = vld1q_u8(y + x);
+    int16x8_t d =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x / 2))), bias128);
+    int16x8_t e =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x / 2))), bias128);
+    // 每个色度样本对应两个像素
+    int16x8x2_t dd = vzipq_s16(d, d);
+    int16x8x2_t ee = vzipq_s16(e, e);
+    uint8x8_t r8[2], g8[2], b8[2];
+    for (int half = 0; half < 2; half++) {
+      uint8x8_t yh = half ? vget_high_u8(y8) : vget_low_u8(y8);
+      int16x8_t yy = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yh)), bias16);
+      // vrshrq_n_s16：(x + 128) >> 8
+      int16x8_t c = vaddq_s16(vmulq_n_s16(yy, CY),
+                              vrshrq_n_s16(vmulq_n_s16(yy, CY_FRAC), 8));
+      r8[half] = yuvToChannelNeon(c, vmulq_n_s16(ee.val[half], CRV));
+      g8[half] = vqrshrun_n_s16(
+          vqsubq_s16(vqsubq_s16(c, vmulq_n_s16(dd.val[half], CGU)),
+                     vmulq_n_s16(ee.val[half], CGV)),
+          6);
+      b8[half] = yuvToChannelNeon(c, vmulq_n_s16(dd.val[half], CBU));
+    }
+    uint8x16_t r = vcombine_u8(r8[0], r8[1]);
+    uint8x16_t g = vcombine_u8(g8[0], g8[1]);
+    uint8x16_t b = vcombine_u8(b8[0], b8[1]);
+    if (F == RGB32) {
+      uint8x16x4_t bgra;
+      bgra.val[0] = b;
+      bgra.val[1] = g;
+      bgra.val[2] = r;
+      bgra.val[3] = vdupq_n_u8(255);
+      vst4q_u8(dst + x * bpp, bgra);
+    } else {
+      if (dither) {
+        uint8x16_t drb = vld1q_u8(dither);
+        r = vqaddq_u8(r, drb);
+        g = vqaddq_u8(g, vshrq_n_u8(drb, 1));
+        b = vqaddq_u8(b, drb);
+      }
+      uint16_t *out = reinterpret_cast<uint16_t *>(dst + x * bpp);
+      for (int half = 0; half < 2; half++) {
+        uint8x8_t rh = half ? vget_high_u8(r) : vget_low_u8(r);
+        uint8x8_t gh = half ? vget_high_u8(g) : vget_low_u8(g);
+        uint8x8_t bh = half ? vget_high_u8(b) : vget_low_u8(b);
+        uint16x8_t px = vsriq_n_u16(vshll_n_u8(rh, 8), vshll_n_u8(gh, 8), 5);
+        px = vsriq_n_u16(px, vshll_n_u8(bh, 8), 11);
+        vst1q_u16(out + half * 8, px);
+      }
+    }
+  }
+  rowTail<F>(y, u, v, dst, x, width, dither);
+}
+
+void lerpNeon(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int w) {
+  const uint8x8_t wa = vdup_n_u8(static_cast<uint8_t>(256 - w));
+  const uint8x8_t wb = vdup_n_u8(static_cast<uint8_t>(w));
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t va = vld1q_u8(a + i);
+    uint8x16_t vb = vld1q_u8(b + i);
+    uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), wa), vget_low_u8(vb), wb);
+    uint16x8_t hi =
+        vmlal_u8(vmull_u8(vget_high_u8(va), wa), vget_high_u8(vb), wb);
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+  }
+  lerpC(a + i, b + i, dst + i, n - i, w);
+}
+
+void halveNeon(const uint8_t *src, uint8_t *dst, int n, int unit) {
+  int i = 0;
+  if (unit == 1) {
+    for (; i + 16 <= n; i += 16) {
+      uint8x16x2_t v = vld2q_u8(src + 2 * i);
+      vst1q_u8(dst + i, vrhaddq_u8(v.val[0], v.val[1]));
+    }
+  } else {
+    for (; i + 8 <= n; i += 8) {
+      uint16x8x2_t v = vld2q_u16(reinterpret_cast<const uint16_t *>(src + 4 * i));
+      vst1q_u8(dst + 2 * i, vrhaddq_u8(vreinterpretq_u8_u16(v.val[0]),
+                                       vreinterpretq_u8_u16(v.val[1])));
+    }
+  }
+  halveC(src + 2 * i * unit, dst + i * unit, n - i, unit);
+}
+#endif // CONVERT_HAVE_NEON
+
+const ConvertKernels::Kernels kernelsC = {"c", &rowC<RGB32>, &rowC<RGB565>,
+                                          &lerpC, &halveC};
+#ifdef CONVERT_HAVE_X86
+const ConvertKernels::Kernels kernelsSse2 = {
+    "sse2", &rowSse2<RGB32>, &rowSse2<RGB565>, &lerpSse2, &halveSse2};
+// 2:1 缩小受内存带宽限制，AVX2 沿用 SSE2 版本
+const ConvertKernels::Kernels kernelsAvx2 = {
+    "avx2", &rowAvx2<RGB32>, &rowAvx2<RGB565>, &lerpAvx2, &halveSse2};
+#endif
+#ifdef CONVERT_HAVE_NEON
+const ConvertKernels::Kernels kernelsNeon = {
+    "neon", &rowNeon<RGB32>, &rowNeon<RGB565>, &lerpNeon, &halveNeon};
+#endif
+} // namespace
+
+namespace ConvertKernels {
+
+const Kernels *get(Isa isa) {
+  int flags = av_get_cpu_flags();
+  (void)flags;
+  switch (isa) {
+  case C:
+    return &kernelsC;
+#ifdef CONVERT_HAVE_X86
+  case Sse2:
+    return (flags & AV_CPU_FLAG_SSE2) ? &kernelsSse2 : nullptr;
+  case Avx2:
+    return (flags & AV_CPU_FLAG_AVX2) ? &kernelsAvx2 : nullptr;
+#endif
+#ifdef CONVERT_HAVE_NEON
+  case Neon:
+    return (flags & AV_CPU_FLAG_NEON) ? &kernelsNeon : nullptr;
+#endif
+  case Auto:
+    for (Isa candidate : {Neon, Avx2, Sse2}) {
+      if (const Kernels *k = get(candidate))
+        return k;
+    }
+    return &kernelsC;
+  default:
+    return nullptr;
+  }
+}
+
+} // namespace ConvertKernels
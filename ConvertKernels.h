@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// YUV→RGB 行转换内核
+// 每个指令集按目标格式在编译期各生成一份（模板特化），运行时按
+// av_get_cpu_flags 选择；所有实现与 C 版本逐像素一致
+namespace ConvertKernels {
+
+// 一行 YUV（u/v 为半宽色度）转为目标格式；dither 为 16 字节的有序抖动阈值
+// （0~7，按 x & 15 取值），仅 RGB565 使用，为 nullptr 时不抖动
+typedef void (*RowFn)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                      uint8_t *dst, int width, const uint8_t *dither);
+// 两行按权重 w（1~255，对应 b 的比例 w/256）线性混合
+typedef void (*LerpFn)(const uint8_t *a, const uint8_t *b, uint8_t *dst,
+                       int n, int w);
+// 水平 2:1 缩小：相邻两个样本取平均（向上取整），n 为输出样本数；
+// unit 为样本字节数（1 或 2，nv12 交织色度的一对 UV 为一个样本），可原地处理
+typedef void (*HalveFn)(const uint8_t *src, uint8_t *dst, int n, int unit);
+
+struct Kernels {
+  const char *name;
+  RowFn rgb32;  // 内存中 B G R A（小端 0xAARRGGBB），alpha 为 255
+  RowFn rgb565; // 本机字节序 RGB565
+  LerpFn lerp;
+  HalveFn halve;
+};
+
+enum Isa { Auto, C, Sse2, Avx2, Neon };
+
+// 返回指定指令集的内核；Auto 按 CPU 能力选最快的一组。
+// 当前编译目标或 CPU 不支持时返回 nullptr（C 版本总是可用）
+const Kernels *get(Isa isa = Auto);
+
+} // namespace ConvertKernels
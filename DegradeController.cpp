@@ -0,0 +1,171 @@
+#include "DegradeController.h"
+#include <QFile>
+#include <algorithm>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// 统计窗口长度
+static const int WINDOW_MS = 500;
+// 解码线程占用率超过该值视为过载，低于该值视为空闲
+static const double OVERLOAD_BUSY = 0.85;
+static const double RELAX_BUSY = 0.5;
+// 窗口内落后帧比例超过该值视为过载
+static const double OVERLOAD_LATE = 0.2;
+// 连续空闲这么多个窗口才恢复一级，避免在两级之间来回切换
+static const int RECOVER_WINDOWS = 4;
+// 降级后跳过的窗口数：队列中已解出的帧还要按旧负载显示一阵
+static const int SETTLE_WINDOWS = 1;
+static const int THERMAL_POLL_MS = 1000;
+
+const char *DegradeController::levelName(int level) {
+  switch (level) {
+  case Normal:
+    return "normal";
+  case SkipLoopFilter:
+    return "skip-loop-filter";
+  case SkipBidir:
+    return "skip-bidir";
+  case SkipNonRef:
+    return "skip-nonref";
+  case FastScale:
+    return "fast-scale";
+  case KeyframesOnly:
+    return "keyframes-only";
+  default:
+    return "unknown";
+  }
+}
+
+void DegradeController::applyToCodec(AVCodecContext *ctx, int level) {
+  ctx->skip_loop_filter =
+      level >= SkipLoopFilter ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+  if (level >= KeyframesOnly)
+    ctx->skip_frame = AVDISCARD_NONKEY;
+  else if (level >= SkipNonRef)
+    ctx->skip_frame = AVDISCARD_NONREF;
+  else if (level >= SkipBidir)
+    ctx->skip_frame = AVDISCARD_BIDIR;
+  else
+    ctx->skip_frame = AVDISCARD_DEFAULT;
+}
+
+void DegradeController::setOptions(const DegradeOptions &options) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_options = options;
+}
+
+void DegradeController::reset() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_level = Normal;
+  m_loadLevel = Normal;
+  m_thermalFloor = Normal;
+  m_minimumLevel = Normal;
+  m_temperature = 0;
+  m_lastThermalPoll = Clock::time_point();
+  m_calmWindows = 0;
+  m_settleWindows = 0;
+  m_busyUs = 0;
+  m_frames = 0;
+  m_lateFrames = 0;
+  m_windowStart = Clock::now();
+}
+
+void DegradeController::setMinimumLevel(int level) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_minimumLevel = level;
+  m_level = std::max({m_loadLevel, m_thermalFloor, m_minimumLevel});
+}
+
+void DegradeController::restartWindow() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_busyUs = 0;
+  m_frames = 0;
+  m_lateFrames = 0;
+  m_windowStart = Clock::now();
+}
+
+void DegradeController::addDecodeTime(int64_t us) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_busyUs += us;
+}
+
+void DegradeController::addFrame(int64_t lateMs, int frameIntervalMs,
+                                 bool dropped) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_frames++;
+  if (dropped || lateMs > frameIntervalMs * 2)
+    m_lateFrames++;
+}
+
+int DegradeController::level() const { return m_level.load(); }
+
+void DegradeController::pollThermalLocked(Clock::time_point now) {
+  if (m_options.thermalPath.isEmpty() ||
+      now - m_lastThermalPoll < std::chrono::milliseconds(THERMAL_POLL_MS))
+    return;
+  m_lastThermalPoll = now;
+  QFile f(m_options.thermalPath);
+  if (!f.open(QIODevice::ReadOnly))
+    return;
+  bool ok = false;
+  int temp = f.readAll().trimmed().toInt(&ok);
+  if (!ok)
+    return;
+  m_temperature = temp;
+  if (temp >= m_options.thermalCritical)
+    m_thermalFloor = FastScale;
+  else if (temp >= m_options.thermalHot)
+    m_thermalFloor = SkipBidir;
+  else
+    m_thermalFloor = Normal;
+}
+
+bool DegradeController::update(QString *reason) {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lk(m_mutex);
+  int64_t windowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                         now - m_windowStart)
+                         .count();
+  if (!m_options.enabled || windowUs < WINDOW_MS * 1000)
+    return false;
+
+  double busy = double(m_busyUs) / windowUs;
+  double late = m_frames > 0 ? double(m_lateFrames) / m_frames : 0;
+  m_busyUs = 0;
+  m_frames = 0;
+  m_lateFrames = 0;
+  m_windowStart = now;
+  pollThermalLocked(now);
+
+  if (m_settleWindows > 0) {
+    m_settleWindows--;
+  } else if (busy > OVERLOAD_BUSY || late > OVERLOAD_LATE) {
+    m_calmWindows = 0;
+    if (m_loadLevel < KeyframesOnly) {
+      m_loadLevel++;
+      m_settleWindows = SETTLE_WINDOWS;
+    }
+  } else if (busy < RELAX_BUSY && late == 0) {
+    if (++m_calmWindows >= RECOVER_WINDOWS && m_loadLevel > Normal) {
+      m_loadLevel--;
+      m_calmWindows = 0;
+    }
+  } else {
+    m_calmWindows = 0;
+  }
+
+  int level = std::max({m_loadLevel, m_thermalFloor, m_minimumLevel});
+  if (level == m_level.load())
+    return false;
+  m_level = level;
+  if (reason) {
+    *reason = QString("decode busy %1%, late frames %2%")
+                  .arg(qRound(busy * 100))
+                  .arg(qRound(late * 100));
+    if (!m_options.thermalPath.isEmpty())
+      *reason += QString(", %1 C").arg(m_temperature / 1000.0, 0, 'f', 1);
+  }
+  return true;
+}
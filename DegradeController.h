@@ -0,0 +1,73 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+struct AVCodecContext;
+
+// 解码降级配置
+struct DegradeOptions {
+  bool enabled = true;
+  // 温度文件（sysfs thermal_zone 的 temp，单位毫摄氏度），为空时不读取；
+  // 也可以指向普通文件，用于模拟发热
+  QString thermalPath;
+  int thermalHot = 70000;      // 达到后至少跳过 B 帧
+  int thermalCritical = 85000; // 达到后至少降到快速缩放
+};
+
+// 解码降级控制器：解码线程上报解码耗时，显示线程上报每帧相对音频时钟的延迟，
+// 每个统计窗口评估一次负载，过载时逐级降级，持续空闲后逐级恢复
+class DegradeController {
+public:
+  enum Level {
+    Normal,
+    SkipLoopFilter, // 跳过环路滤波
+    SkipBidir,      // 再跳过 B 帧
+    SkipNonRef,     // 再跳过所有非参考帧
+    FastScale,      // 再使用最近邻缩放
+    KeyframesOnly,  // 只解关键帧
+    LevelCount
+  };
+  static const char *levelName(int level);
+  // 把等级对应的跳过策略写入解码器（打开后也可随时修改）
+  static void applyToCodec(AVCodecContext *ctx, int level);
+
+  void setOptions(const DegradeOptions &options);
+  // 恢复正常等级并清空统计（开始播放时调用）
+  void reset();
+  // 不随负载恢复的最低等级（源远大于显示区域时不必做环路滤波）
+  void setMinimumLevel(int level);
+  // 丢弃当前窗口的统计（seek、暂停后的数据不代表负载）
+  void restartWindow();
+
+  // 解码线程：一次 send/receive 实际占用的时间
+  void addDecodeTime(int64_t us);
+  // 显示线程：一帧落后音频时钟的毫秒数（负数为超前），dropped 为因落后被丢弃
+  void addFrame(int64_t lateMs, int frameIntervalMs, bool dropped);
+
+  // 窗口结束时评估负载，等级变化时返回 true 并给出原因
+  bool update(QString *reason);
+  int level() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+  void pollThermalLocked(Clock::time_point now);
+
+  mutable std::mutex m_mutex;
+  DegradeOptions m_options;
+  std::atomic<int> m_level{Normal};
+  int m_loadLevel = Normal;   // 按负载得出的等级
+  int m_thermalFloor = Normal; // 按温度得出的最低等级
+  int m_minimumLevel = Normal;
+  int m_temperature = 0;
+
+  Clock::time_point m_windowStart = Clock::now();
+  Clock::time_point m_lastThermalPoll;
+  int64_t m_busyUs = 0;
+  int m_frames = 0;
+  int m_lateFrames = 0;
+  int m_calmWindows = 0;   // 连续空闲的窗口数
+  int m_settleWindows = 0; // 降级后等待生效的窗口数
+};
@@ -1,15 +1,21 @@
 #include "FFMpegDecoder.h"
+#include "FrameBufferPool.h"
+#include "FrameConverter.h"
+#include "ProbeCache.h"
 #include "qdebug.h"
+#include <QFileInfo>
 #include <QSharedPointer>
 #include <QtDebug>
 #include <chrono>
 #include <memory>
+#include <sys/stat.h>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 #include <libswresample/swresample.h>
 #include <libswscale/swscale.h>
 }
@@ -58,6 +64,29 @@ AVCodec *find_decoder(AVCodecID id, AVMediaType type) {
 }
 } // namespace
 
+// 直播模式：每个队列最多积压的时长，超过后丢弃到 LIVE_KEEP_MS
+static const int64_t LIVE_MAX_QUEUE_MS = 300;
+static const int64_t LIVE_KEEP_MS = 100;
+// 直播流时间戳跳变超过该值时重置同步参考点，而不是等待
+static const int64_t LIVE_RESYNC_MS = 200;
+
+// 显示帧缓冲池的容量，以及池耗尽时等待归还的时间
+static const size_t FRAME_POOL_BUFFERS = 4;
+static const int FRAME_POOL_WAIT_MS = 20;
+// 自动配置时颜色转换最多使用的线程数（与解码线程共用 CPU）
+static const int CONVERT_MAX_AUTO_THREADS = 4;
+
+// 最高倍速；达到 TRICK_PLAY_SPEED 起只解关键帧
+static const float MAX_PLAYBACK_SPEED = 16.0f;
+static const float MAX_AUDIO_ONLY_SPEED = 4.0f;
+static const float TRICK_PLAY_SPEED = 4.0f;
+// 快进模式下每张关键帧大约显示的时长，决定相邻两次读取之间跳过多少内容
+static const int64_t TRICK_FRAME_MS = 250;
+// 快进模式下视频队列最多预读的关键帧数
+static const size_t TRICK_QUEUE_PACKETS = 2;
+// 快进模式下找下一个关键帧时最多读取的 packet 数
+static const int TRICK_MAX_SCAN_PACKETS = 4096;
+
 static const int OUT_SAMPLE_RATE = 44100;
 static const int OUT_CHANNELS = 2;
 static const AVSampleFormat OUT_SAMPLE_FMT = AV_SAMPLE_FMT_S16;
@@ -69,6 +98,8 @@ FFMpegDecoder::FFMpegDecoder(QObject *parent) : QObject(parent) {
 
   // 注册 QSharedPointer<QImage> 类型，以便在信号槽中使用
   qRegisterMetaType<QSharedPointer<QImage>>("QSharedPointer<QImage>");
+  qRegisterMetaType<MediaInfo>("MediaInfo");
+  qRegisterMetaType<StartupStats>("StartupStats");
 }
 
 FFMpegDecoder::~FFMpegDecoder() { stop(); }
@@ -78,20 +109,55 @@ void FFMpegDecoder::start(const QString &path) {
   stop();
   // 设置解码器路径
   m_path = path;
+  m_live = isLiveInput(path);
+  // 直播输入只保留很短的队列，靠丢弃追赶而不是背压
+  if (m_live) {
+    m_videoQueue.setLimits(4 * 1024 * 1024, LIVE_MAX_QUEUE_MS);
+    m_audioQueue.setLimits(1024 * 1024, LIVE_MAX_QUEUE_MS);
+  } else {
+    m_videoQueue.setLimits(8 * 1024 * 1024, 3000);
+    m_audioQueue.setLimits(8 * 1024 * 1024, 3000);
+  }
   // 设置停止标志为 false
   m_stop = false;
   // 设置暂停标志为 false
   m_pause = false;
   // 设置 seek 标志为 false
   m_seeking = false;
-  // 设置视频 seek 处理标志为 false
-  m_videoSeekHandled = false;
-  // 设置音频 seek 处理标志为 false
-  m_audioSeekHandled = false;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_pendingSeek = SeekRequest();
+    m_activeSeek = SeekRequest();
+    m_supersededSeeks = 0;
+    m_loopAMs = -1;
+    m_loopBMs = -1;
+    m_loopId++;
+  }
+  m_loopLenMs = 0;
+  m_audioClockMs = 0;
+  m_audioClockValid = false;
+  m_videoClockMs = 0;
+  m_trickPlay = false;
   // 设置 eof 标志为 false
   m_eof = false;
-  // 创建视频解码线程
+  // 记录启动时间，用于统计首帧耗时
+  m_startTime = std::chrono::steady_clock::now();
+  m_startupStats = StartupStats();
+  m_readyEmitted = false;
+  m_degrade.reset();
+  // 重置解复用状态并启用 packet 队列
+  m_opened = false;
+  m_openFailed = false;
+  m_streamsDirty = false;
+  m_videoQueue.start();
+  m_audioQueue.start();
+  m_frameQueue.setCapacity(m_live ? 2 : 6);
+  m_frameQueue.start();
+  // 创建解复用线程
+  m_demuxThread = std::thread(&FFMpegDecoder::demuxLoop, this);
+  // 创建视频解码线程和显示线程
   m_videoThread = std::thread(&FFMpegDecoder::videoDecodeLoop, this);
+  m_presentThread = std::thread(&FFMpegDecoder::presentLoop, this);
   // 创建音频解码线程
   m_audioThread = std::thread(&FFMpegDecoder::audioDecodeLoop, this);
 }
@@ -99,20 +165,91 @@ void FFMpegDecoder::start(const QString &path) {
 void FFMpegDecoder::stop() {
   m_stop = true;
   m_eof = false;
+  m_videoQueue.abort();
+  m_audioQueue.abort();
+  m_frameQueue.abort();
   m_cond.notify_all();
+  if (m_demuxThread.joinable())
+    m_demuxThread.join();
   if (m_videoThread.joinable())
     m_videoThread.join();
+  if (m_presentThread.joinable())
+    m_presentThread.join();
   if (m_audioThread.joinable())
     m_audioThread.join();
+  if (m_indexThread.joinable())
+    m_indexThread.join();
+  // 所有线程退出后再释放输入，解码线程会读取其中的 codecpar
+  if (m_fmtCtx)
+    avformat_close_input(&m_fmtCtx);
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_source.reset();
+    m_keyframeIndex.reset();
+  }
+  m_opened = false;
 }
 
-void FFMpegDecoder::seek(qint64 ms) {
-  m_seekTarget = ms;
-  m_seeking = true;
-  m_videoSeekHandled = false;
-  m_audioSeekHandled = false;
+qint64 FFMpegDecoder::seek(qint64 ms, SeekMode mode) {
+  if (m_live)
+    return 0;
+  qint64 id;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    id = requestSeekLocked(ms, mode);
+  }
   m_eof = false;
   m_cond.notify_all();
+  return id;
+}
+
+qint64 FFMpegDecoder::requestSeekLocked(qint64 ms, SeekMode mode) {
+  // 解复用线程还没取走上一个请求时直接覆盖，只执行最新的目标
+  if (m_seeking)
+    m_supersededSeeks++;
+  m_pendingSeek = SeekRequest();
+  m_pendingSeek.id = ++m_nextSeekId;
+  m_pendingSeek.targetMs = ms;
+  m_pendingSeek.mode = mode;
+  m_pendingSeek.requestedMs = elapsedSinceStart();
+  m_seeking = true;
+  // 解码线程在 m_seeking 期间不再取 packet，解复用线程若正阻塞在满队列的
+  // put 上就永远执行不到跳转，这里把它唤醒
+  m_videoQueue.interruptPut();
+  m_audioQueue.interruptPut();
+  return m_pendingSeek.id;
+}
+
+bool FFMpegDecoder::seekForSerial(int serial, bool video,
+                                  SeekRequest *req) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  int active = video ? m_activeSeek.videoSerial : m_activeSeek.audioSerial;
+  if (m_activeSeek.id == 0 || active != serial)
+    return false;
+  *req = m_activeSeek;
+  return true;
+}
+
+void FFMpegDecoder::reportSeekLanded(int serial, bool video, qint64 landedMs) {
+  SeekRequest req;
+  int superseded;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    int active = video ? m_activeSeek.videoSerial : m_activeSeek.audioSerial;
+    if (m_activeSeek.id == 0 || active != serial ||
+        m_activeSeek.id <= m_reportedSeekId)
+      return;
+    req = m_activeSeek;
+    m_reportedSeekId = req.id;
+    superseded = m_supersededSeeks;
+    m_supersededSeeks = 0;
+  }
+  qint64 latency = elapsedSinceStart() - req.requestedMs;
+  qDebug() << "Seek" << req.id
+           << (req.mode == AccurateSeek ? "accurate" : "fast") << "target"
+           << req.targetMs << "ms, landed" << landedMs << "ms, took" << latency
+           << "ms," << superseded << "superseded";
+  emit seekCompleted(req.id, req.targetMs, landedMs, latency);
 }
 
 void FFMpegDecoder::togglePause() {
@@ -129,10 +266,13 @@ void FFMpegDecoder::setAudioTrack(int index) {
     return;
   if (m_audioTrackIndex != index) {
     m_audioTrackIndex = index;
-    m_seeking = true;
-    m_videoSeekHandled = false;
-    m_audioSeekHandled = false;
-    m_eof = false;
+    // 切换后从当前位置重新读取，新音轨的 packet 才会进入队列
+    // 直播无法回读，新音轨从下一个 packet 开始
+    m_streamsDirty = true;
+    if (!m_live) {
+      requestSeekLocked(m_audioClockMs.load(), AccurateSeek);
+      m_eof = false;
+    }
     m_cond.notify_all();
   }
 }
@@ -156,15 +296,13 @@ void FFMpegDecoder::setVideoTrack(int index) {
     return;
   if (m_videoTrackIndex != index) {
     m_videoTrackIndex = index;
+    m_streamsDirty = true;
+    if (!m_live)
+      requestSeekLocked(m_audioClockMs.load(), AccurateSeek);
     if (index == -1) {
-      m_seeking = true;
-      m_videoSeekHandled = false;
       m_cond.notify_all();
       emit frameReady(QSharedPointer<QImage>());
     } else {
-      m_seeking = true;
-      m_videoSeekHandled = false;
-      m_audioSeekHandled = false;
       m_eof = false;
       m_cond.notify_all();
     }
@@ -183,411 +321,1224 @@ QString FFMpegDecoder::videoTrackName(int idx) const {
   return m_videoStreamNames[idx];
 }
 
-void FFMpegDecoder::videoDecodeLoop() {
-  while (!m_stop) {
-    // 打开输入文件
-    AVFormatContext *raw_fmt_ctx = nullptr;
-    AVDictionary *opts = nullptr;
-    av_dict_set(&opts, "probe_size", "1048576", 0);
-    av_dict_set(&opts, "analyzeduration", "1000000", 0);
-    if (avformat_open_input(&raw_fmt_ctx, m_path.toUtf8().constData(), nullptr,
-                            &opts) < 0) {
-      qWarning() << "Failed to open input file:" << m_path;
-      emit errorOccurred(tr("无法打开文件: %1").arg(m_path));
-      av_dict_free(&opts);
-      return;
+void FFMpegDecoder::demuxLoop() {
+  // 打开输入文件（整个播放过程只打开一次）
+  AVFormatContext *raw_fmt_ctx = nullptr;
+  MediaSource::Options source_opts;
+  PacketRing::Options ring_opts;
+  LoopOptions loop_opts;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    source_opts = m_sourceOptions;
+    ring_opts = m_seekBufferOptions;
+    loop_opts = m_loopOptions;
+  }
+  std::unique_ptr<MediaSource> source;
+  if (!m_live)
+    source = MediaSource::create(m_path, source_opts);
+  raw_fmt_ctx = avformat_alloc_context();
+  if (raw_fmt_ctx && source && source->avioContext()) {
+    // 本地文件和 HTTP 走自定义 I/O，libavformat 只从我们的缓冲读取
+    raw_fmt_ctx->pb = source->avioContext();
+    qDebug() << "Input source:" << source->describe();
+  }
+  if (raw_fmt_ctx) {
+    // 停止时打断阻塞中的读取（管道、UDP 可能长时间没有数据）
+    raw_fmt_ctx->interrupt_callback.callback = [](void *opaque) {
+      return static_cast<FFMpegDecoder *>(opaque)->m_stop.load() ? 1 : 0;
+    };
+    raw_fmt_ctx->interrupt_callback.opaque = this;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_source = std::move(source);
+  }
+  AVDictionary *opts = nullptr;
+  QString url = m_path;
+  if (m_live) {
+    // 直播：尽量少探测，探测期间读到的 packet 不缓存
+    av_dict_set(&opts, "probesize", "65536", 0);
+    av_dict_set(&opts, "analyzeduration", "300000", 0);
+    av_dict_set(&opts, "fflags", "nobuffer", 0);
+    if (url == "-")
+      url = "pipe:0";
+    if (url.startsWith("udp://")) {
+      av_dict_set(&opts, "buffer_size", "1048576", 0);
+      av_dict_set(&opts, "overrun_nonfatal", "1", 0);
     }
+  } else {
+    av_dict_set(&opts, "probesize", "1048576", 0);
+    av_dict_set(&opts, "analyzeduration", "1000000", 0);
+  }
+  auto fail = [&](const QString &message) {
+    emit errorOccurred(message);
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_openFailed = true;
+    m_cond.notify_all();
+  };
+  if (avformat_open_input(&raw_fmt_ctx, url.toUtf8().constData(), nullptr,
+                          &opts) < 0) {
+    qWarning() << "Failed to open input file:" << m_path;
     av_dict_free(&opts);
-    AVFormatContextPtr fmt_ctx(raw_fmt_ctx);
-    if (avformat_find_stream_info(fmt_ctx.get(), nullptr) < 0) {
-      qWarning() << "Failed to get stream info";
-      emit errorOccurred(tr("无法获取媒体流信息"));
-      return;
-    }
-    // 获取所有视频流索引和名称
+    fail(tr("无法打开文件: %1").arg(m_path));
+    return;
+  }
+  av_dict_free(&opts);
+  AVFormatContextPtr fmt_ctx(raw_fmt_ctx);
+  qint64 open_ms = elapsedSinceStart();
+  bool probe_hit = false;
+  int probe_ret = m_live
+                      ? avformat_find_stream_info(fmt_ctx.get(), nullptr)
+                      : ProbeCache::findStreamInfo(fmt_ctx.get(), m_path,
+                                                   &probe_hit);
+  if (probe_ret < 0) {
+    qWarning() << "Failed to get stream info";
+    fail(tr("无法获取媒体流信息"));
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_startupStats.openMs = open_ms;
+    m_startupStats.probeMs = elapsedSinceStart() - open_ms;
+    m_startupStats.probeCacheHit = probe_hit;
+  }
+
+  // 收集所有视频流和音频流
+  auto stream_name = [&](unsigned i, size_t n) {
+    QString name = QString("Track %1").arg(n);
+    AVDictionaryEntry *lang =
+        av_dict_get(fmt_ctx->streams[i]->metadata, "language", nullptr, 0);
+    if (lang && lang->value)
+      name += QString(" [%1]").arg(lang->value);
+    return name;
+  };
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
     m_videoStreamIndices.clear();
     m_videoStreamNames.clear();
+    m_audioStreamIndices.clear();
+    m_audioStreamNames.clear();
     for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
       AVCodecParameters *p = fmt_ctx->streams[i]->codecpar;
       if (p->codec_type == AVMEDIA_TYPE_VIDEO) {
         m_videoStreamIndices.push_back(i);
-        QString name = QString("Track %1").arg(m_videoStreamIndices.size());
-        if (fmt_ctx->streams[i]->metadata) {
-          AVDictionaryEntry *lang = av_dict_get(fmt_ctx->streams[i]->metadata,
-                                                "language", nullptr, 0);
-          if (lang && lang->value)
-            name += QString(" [%1]").arg(lang->value);
-        }
-        m_videoStreamNames.push_back(name);
+        m_videoStreamNames.push_back(
+            stream_name(i, m_videoStreamIndices.size()));
+      } else if (p->codec_type == AVMEDIA_TYPE_AUDIO) {
+        m_audioStreamIndices.push_back(i);
+        m_audioStreamNames.push_back(
+            stream_name(i, m_audioStreamIndices.size()));
       }
     }
     if (m_videoTrackIndex >= static_cast<int>(m_videoStreamIndices.size()))
       m_videoTrackIndex = m_videoStreamIndices.empty() ? -1 : 0;
+    if (m_audioTrackIndex >= static_cast<int>(m_audioStreamIndices.size()))
+      m_audioTrackIndex = m_audioStreamIndices.empty() ? -1 : 0;
+  }
+
+  qint64 duration_ms = !m_live && fmt_ctx->duration >= 0
+                            ? fmt_ctx->duration / (AV_TIME_BASE / 1000)
+                            : 0;
+  emit durationChanged(duration_ms);
+
+  // 媒体信息直接来自本次打开的结果，界面无需再单独探测一次
+  MediaInfo info;
+  info.durationMs = duration_ms;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_videoTrackIndex >= 0) {
+      AVCodecParameters *vpar =
+          fmt_ctx->streams[m_videoStreamIndices[m_videoTrackIndex]]->codecpar;
+      info.width = vpar->width;
+      info.height = vpar->height;
+    }
+    if (m_audioTrackIndex >= 0) {
+      AVCodecParameters *apar =
+          fmt_ctx->streams[m_audioStreamIndices[m_audioTrackIndex]]->codecpar;
+      info.sampleRate = apar->sample_rate;
+      info.channels = apar->channels;
+    }
+  }
+  emit mediaInfoReady(info);
+
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_fmtCtx = fmt_ctx.release();
+    m_opened = true;
+  }
+  m_cond.notify_all();
+
+  AVFormatContext *fmt = m_fmtCtx;
+  // 索引不佳的容器在后台建立关键帧索引，供之后的 seek 使用
+  if (!m_live && KeyframeIndex::supportsByteSeek(fmt) &&
+      QFileInfo(m_path).isFile())
+    startIndexer(KeyframeIndex::pickStream(fmt));
+
+  AVPacketPtr pkt = make_avpacket();
+  int vid_idx = -1, aud_idx = -1;
+  bool eof_sent = false;
+  int64_t trick_pos = -1; // 快进模式下最近送出的关键帧时间，-1 表示从当前位置读起
+  // 最近读到的 packet，窗口内的跳转直接从这里重放；直播不支持跳转，不缓存
+  if (m_live)
+    ring_opts.maxDurationMs = 0;
+  PacketRing ring;
+  ring.setOptions(ring_opts);
+  PacketRing::Replay replay;
+  uint64_t replay_seq = 0; // 下一个要重放的序号，等于 ring.endSeq() 时从文件读取
+  int seeks = 0, ring_seeks = 0;
+
+  // A-B 循环：第一遍从 A 之前的关键帧起把 packet 存进 loop_store（放不下时
+  // 只存开头）；每遍读到 B 后在队列里插入回绕标记，再从内存送出 A 点的数据
+  PacketRing loop_store;
+  {
+    PacketRing::Options store_opts;
+    store_opts.maxBytes = loop_opts.packetBytes;
+    store_opts.keepHead = true;
+    loop_store.setOptions(store_opts);
+  }
+  qint64 loop_id = 0, loop_a = -1, loop_b = -1;
+  bool loop_storing = false;   // 这一遍从文件读取的 packet 同时存入 loop_store
+  bool loop_complete = false;  // loop_store 覆盖了整个区间
+  bool loop_replaying = false; // 正在从 loop_store 送出
+  uint64_t loop_seq = 0;
+  PacketRing::Replay loop_from;
+  bool video_done = false, audio_done = false; // 这一遍已读到 B
+  bool loop_skip_video = false; // 视频线程已缓存整段画面，这一遍不送视频 packet
+  int loop_packets = 0;         // 这一遍送出的 packet 数
+  // 只存了开头时，从文件续读要跳过的部分（各流最后缓存的时间戳）
+  int64_t head_video_ts = AV_NOPTS_VALUE, head_audio_ts = AV_NOPTS_VALUE;
+  int64_t skip_video_ts = AV_NOPTS_VALUE, skip_audio_ts = AV_NOPTS_VALUE;
+  int loop_wraps = 0, loop_memory_wraps = 0;
+
+  // 按时间戳（有视频流的关键帧索引时按字节偏移）把文件定位到 target 之前的
+  // 关键帧；索引建在别的流上（如切换了视频轨）时它的位置不是视频关键帧
+  auto seek_file = [&](qint64 target) {
+    std::shared_ptr<const KeyframeIndex> index = keyframeIndex();
+    KeyframeIndex::Entry kf;
+    if (!index || index->streamIndex() != vid_idx ||
+        !index->lookup(target, &kf) ||
+        av_seek_frame(fmt, -1, kf.pos, AVSEEK_FLAG_BYTE) < 0) {
+      int64_t ts = target * (AV_TIME_BASE / 1000);
+      av_seek_frame(fmt, -1, ts, AVSEEK_FLAG_BACKWARD);
+    }
+  };
+  auto reset_loop_pass = [&]() {
+    video_done = vid_idx < 0;
+    audio_done = aud_idx < 0;
+    loop_packets = 0;
+    skip_video_ts = skip_audio_ts = AV_NOPTS_VALUE;
+  };
+  auto start_storing = [&]() {
+    loop_store.clear();
+    loop_storing = true;
+    loop_complete = false;
+    head_video_ts = head_audio_ts = AV_NOPTS_VALUE;
+  };
+  // 循环区间变化（设置、取消或轨道变化）后丢弃旧的缓存
+  auto sync_loop = [&](bool force) {
+    if (!force && m_loopId == loop_id)
+      return;
+    loopState(&loop_id, &loop_a, &loop_b);
+    loop_store.clear();
+    loop_storing = loop_complete = loop_replaying = false;
+    loop_skip_video = false;
+    reset_loop_pass();
+    // 循环期间文件会被来回定位，跳转缓冲不再连续
+    ring.clear();
+    replay_seq = ring.endSeq();
+  };
+  auto cancel_loop = [&](const char *reason) {
+    bool cancelled;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      cancelled = cancelLoopLocked(loop_id);
+    }
+    if (!cancelled)
+      return;
+    qDebug() << "A-B loop cancelled:" << reason;
+    sync_loop(true);
+    emit loopChanged(-1, -1);
+  };
+  // 循环期间的 packet：读到 B 的流不再送出，从文件读到的顺便存进 loop_store
+  auto loop_forward = [&](AVPacket *p, bool from_file) {
+    bool video = p->stream_index == vid_idx;
+    bool &done = video ? video_done : audio_done;
+    if (done)
+      return;
+    // 视频按解码顺序判断，B 之前显示的帧引用的后续帧也要送出
+    int64_t t = video && p->dts != AV_NOPTS_VALUE ? p->dts
+                : p->pts != AV_NOPTS_VALUE        ? p->pts
+                                                  : p->dts;
+    AVStream *st = fmt->streams[p->stream_index];
+    if (t != AV_NOPTS_VALUE &&
+        av_rescale_q(t, st->time_base, {1, 1000}) >= loop_b) {
+      done = true;
+      return;
+    }
+    if (from_file && loop_storing && loop_store.push(p, st->time_base) &&
+        t != AV_NOPTS_VALUE)
+      (video ? head_video_ts : head_audio_ts) = t;
+    loop_packets++;
+    if (!video)
+      m_audioQueue.put(p);
+    else if (!loop_skip_video)
+      m_videoQueue.put(p);
+  };
+  // 只存了开头时从文件续读：已经送出的 packet 跳过
+  auto skip_resumed = [&](const AVPacket *p) {
+    bool video = p->stream_index == vid_idx;
+    int64_t &limit = video ? skip_video_ts : skip_audio_ts;
+    if (limit == AV_NOPTS_VALUE)
+      return false;
+    int64_t t = video && p->dts != AV_NOPTS_VALUE ? p->dts : p->pts;
+    if (t != AV_NOPTS_VALUE && t <= limit)
+      return true;
+    limit = AV_NOPTS_VALUE;
+    return false;
+  };
+  // 所有在用的流都读到 B（或文件末尾）：插入回绕标记，从 A 重新送出
+  auto loop_wrap = [&]() {
+    if (loop_storing) {
+      loop_storing = false;
+      loop_complete = !loop_store.full();
+    }
+    if (loop_packets == 0) {
+      cancel_loop("no packets between A and B");
+      return;
+    }
+    if (vid_idx >= 0)
+      m_videoQueue.putLoopMarker();
+    if (aud_idx >= 0)
+      m_audioQueue.putLoopMarker();
+    loop_wraps++;
+    reset_loop_pass();
+    loop_skip_video = vid_idx >= 0 && m_loopClipCached == loop_id;
+    if (loop_store.locate(loop_a, vid_idx, aud_idx, &loop_from)) {
+      loop_replaying = true;
+      loop_seq = loop_from.seq;
+      loop_memory_wraps++;
+    } else {
+      // 还没有缓存（如循环中途跳转过）：这一遍从文件读取并缓存
+      seek_file(loop_a);
+      start_storing();
+      loop_replaying = false;
+    }
+  };
 
-    // 简化为主循环：统一处理空轨道和视频轨道
-    qint64 duration_ms =
-        fmt_ctx->duration >= 0 ? fmt_ctx->duration / (AV_TIME_BASE / 1000) : 0;
-    emit durationChanged(duration_ms);
-
-    // 资源初始化（移出循环）
-    AVCodec *vcodec = nullptr;
-    AVCodecContextPtr vctx;
-    int vwidth = 0, vheight = 0;
-    AVRational vtime_base = {0, 1};
-    int sws_src_pix_fmt = -1;
-    SwsContext *sws_ctx = nullptr;
-    int rgb_stride = 0;
-    uint8_t *rgb_buf = nullptr;
-    int rgb_buf_size = 0;
-    AVPacketPtr pkt = make_avpacket();
-    AVFramePtr frame = make_avframe();
-    using clock = std::chrono::steady_clock;
-    clock::time_point playback_start_time = clock::now();
-
-    while (!m_stop) {
-      // 获取当前视频轨道索引
-      int vid_idx = -1;
+  // 根据当前选择的轨道设置各流的 discard，无人消费的流不再解复用
+  auto select_streams = [&]() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    vid_idx = (m_videoTrackIndex >= 0 &&
+               m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()))
+                  ? m_videoStreamIndices[m_videoTrackIndex]
+                  : -1;
+    aud_idx = (m_audioTrackIndex >= 0 &&
+               m_audioTrackIndex < static_cast<int>(m_audioStreamIndices.size()))
+                  ? m_audioStreamIndices[m_audioTrackIndex]
+                  : -1;
+    for (unsigned i = 0; i < fmt->nb_streams; i++) {
+      // 快进模式静音，音频流也不再解复用
+      bool used = static_cast<int>(i) == vid_idx ||
+                  (static_cast<int>(i) == aud_idx && !m_trickPlay);
+      fmt->streams[i]->discard = used ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    if (vid_idx >= 0)
+      m_videoQueue.setTimeBase(fmt->streams[vid_idx]->time_base);
+    if (aud_idx >= 0)
+      m_audioQueue.setTimeBase(fmt->streams[aud_idx]->time_base);
+    // 缓存里只有原来轨道的 packet
+    ring.clear();
+    replay_seq = ring.endSeq();
+    sync_loop(true);
+  };
+  select_streams();
+
+  while (!m_stop) {
+    if (m_streamsDirty.exchange(false))
+      select_streams();
+    sync_loop(false);
+
+    // 跳转处理：只在这里 seek 一次，随后清空队列，解码线程根据 serial 冲刷解码器
+    // m_seeking 保持到队列冲刷完成，期间解码线程不再解码旧位置的数据
+    if (m_seeking) {
+      SeekRequest req;
       {
         std::lock_guard<std::mutex> lk(m_mutex);
-        if (m_videoTrackIndex >= 0 &&
-            m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()))
-          vid_idx = m_videoStreamIndices[m_videoTrackIndex];
-      }
-
-      // 处理空轨道
-      if (vid_idx < 0) {
-        // 清空画面
-        emit frameReady(QSharedPointer<QImage>());
-
-        // 暂停或等待状态变化
-        if (m_pause) {
-          std::unique_lock<std::mutex> lk(m_mutex);
-          m_cond.wait(lk, [&] {
-            return m_stop || !m_pause || m_seeking || m_videoTrackIndex != -1;
-          });
-          if (m_stop)
-            break;
-        }
-
-        // 处理 seek
-        if (m_seeking) {
-          m_audioClockMs.store(m_seekTarget);
-          std::lock_guard<std::mutex> lk(m_mutex);
-          m_videoSeekHandled = true;
-          if (m_audioSeekHandled)
-            m_seeking = false;
-          continue;
-        }
+        req = m_pendingSeek;
+      }
+      qint64 target = req.targetMs;
+      // 跳到循环区间之外时取消循环；区间内已缓存的部分直接从内存送出
+      if (loop_a >= 0 && (target < loop_a || target >= loop_b))
+        cancel_loop("seek outside the loop");
+      bool from_loop = loop_a >= 0 && !m_trickPlay &&
+                       loop_store.locate(target, vid_idx, aud_idx, &loop_from);
+      // 目标在缓存窗口内时从内存重放，文件位置不动，重放完接着往后读
+      bool from_ring = !from_loop && loop_a < 0 && !m_trickPlay &&
+                       ring.locate(target, vid_idx, aud_idx, &replay);
+      if (!from_ring && !from_loop) {
+        seek_file(target);
+        ring.clear();
+      }
+      if (loop_a >= 0) {
+        reset_loop_pass();
+        loop_skip_video = false;
+        loop_replaying = from_loop;
+        loop_seq = loop_from.seq;
+        // 从 A 起播（设置循环时）的这一遍顺便缓存
+        if (!from_loop && target == loop_a)
+          start_storing();
+        else
+          loop_storing = false;
+      }
+      replay_seq = from_ring ? replay.seq : ring.endSeq();
+      seeks++;
+      if (from_loop)
+        ring_seeks++;
+      if (from_ring) {
+        ring_seeks++;
+        qDebug() << "Seek to" << target << "ms served from memory,"
+                 << ring.endSeq() - replay.seq << "packets to replay";
+      }
+      // 冲刷队列和登记本次跳转在同一把锁内完成，解码线程看到新 serial 后
+      // 一定能查到对应的请求
+      {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_videoQueue.flush();
+        m_audioQueue.flush();
+        req.videoSerial = m_videoQueue.serial();
+        req.audioSerial = m_audioQueue.serial();
+        m_activeSeek = req;
+        // 执行期间到来的新请求覆盖了 m_pendingSeek，下一轮循环立即执行最新的目标
+        m_seeking = m_pendingSeek.id != req.id;
+      }
+      m_frameQueue.flush();
+      m_eof = false;
+      eof_sent = false;
+      trick_pos = -1;
+      m_cond.notify_all();
+      continue;
+    }
 
-        // 推进位置（基于音频时钟）
-        emit positionChanged(m_audioClockMs.load());
-        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    // 快进模式：从一个关键帧直接跳到倍速间隔之后的下一个关键帧，中间的
+    // packet 不读取；队列里只预读一两个关键帧，显示节奏由显示线程按倍速控制
+    if (m_trickPlay && vid_idx >= 0) {
+      // 快进会跳着读文件，缓存不再连续
+      ring.clear();
+      replay_seq = ring.endSeq();
+      if (eof_sent || m_videoQueue.count() >= TRICK_QUEUE_PACKETS) {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cond.wait_for(lk, std::chrono::milliseconds(10), [&] {
+          return m_stop || m_seeking || m_streamsDirty;
+        });
         continue;
       }
-
-      // 初始化/重置视频解码资源（如果轨道变化）
-      if (!vctx || vid_idx !=
-                       m_videoStreamIndices
-                           [m_videoTrackIndex]) { // 假设轨道变化时重新初始化
-        vcodec = find_decoder(fmt_ctx->streams[vid_idx]->codecpar->codec_id,
-                              AVMEDIA_TYPE_VIDEO);
-        if (!vcodec) {
-          qWarning() << "Video decoder not found";
-          emit errorOccurred(tr("未找到视频解码器"));
-          break;
-        }
-        vctx = make_avcodec_ctx(vcodec);
-        if (!vctx) {
-          qWarning() << "Failed to allocate video decoder context";
-          emit errorOccurred(tr("无法分配视频解码器上下文"));
+      AVStream *vst = fmt->streams[vid_idx];
+      bool at_end = false;
+      if (trick_pos >= 0) {
+        int64_t next =
+            trick_pos +
+            std::max<int64_t>(1, static_cast<int64_t>(m_playbackSpeed.load() *
+                                                      TRICK_FRAME_MS));
+        std::shared_ptr<const KeyframeIndex> index = keyframeIndex();
+        KeyframeIndex::Entry kf;
+        if (index && index->streamIndex() == vid_idx &&
+            index->lookupAfter(next, &kf))
+          at_end = av_seek_frame(fmt, -1, kf.pos, AVSEEK_FLAG_BYTE) < 0;
+        else
+          at_end = av_seek_frame(fmt, vid_idx,
+                                 av_rescale_q(next, {1, 1000}, vst->time_base),
+                                 0) < 0;
+      }
+      // 读到下一个关键帧为止；定位不准落在旧关键帧上时继续往后找
+      bool found = false;
+      for (int scanned = 0; !at_end && !found && !m_stop &&
+                            scanned < TRICK_MAX_SCAN_PACKETS;
+           scanned++) {
+        int ret = av_read_frame(fmt, pkt.get());
+        if (ret < 0) {
+          at_end = ret == AVERROR_EOF || avio_feof(fmt->pb);
           break;
         }
-        if (avcodec_parameters_to_context(
-                vctx.get(), fmt_ctx->streams[vid_idx]->codecpar) < 0) {
-          qWarning() << "Failed to copy video decoder parameters";
-          emit errorOccurred(tr("无法复制视频解码器参数"));
-          break;
+        int64_t t = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        int64_t t_ms =
+            t == AV_NOPTS_VALUE ? -1 : av_rescale_q(t, vst->time_base, {1, 1000});
+        if (pkt->stream_index == vid_idx && (pkt->flags & AV_PKT_FLAG_KEY) &&
+            t_ms > trick_pos) {
+          trick_pos = t_ms;
+          m_videoQueue.put(pkt.get());
+          found = true;
         }
-        if (avcodec_open2(vctx.get(), vcodec, nullptr) < 0) {
-          qWarning() << "Failed to open video decoder";
-          emit errorOccurred(tr("无法打开视频解码器"));
-          break;
+        av_packet_unref(pkt.get());
+      }
+      if (at_end || !found) {
+        m_videoQueue.putEof();
+        eof_sent = true;
+        m_eof = true;
+      }
+      continue;
+    }
+
+    // 背压：所有在用队列都已缓存足够数据，或已读到文件末尾时等待
+    // 直播源不会等我们，始终读取，积压由下方的追帧处理
+    // 循环中不送视频 packet 时，视频队列里还有没处理的回绕标记就不急着读
+    bool video_enough = vid_idx < 0 ||
+                        (loop_a >= 0 && loop_skip_video
+                             ? m_videoQueue.count() > 0
+                             : m_videoQueue.hasEnough());
+    bool audio_enough = aud_idx < 0 || m_audioQueue.hasEnough();
+    if (eof_sent || (!m_live && video_enough && audio_enough)) {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait_for(lk, std::chrono::milliseconds(eof_sent ? 50 : 10), [&] {
+        return m_stop || m_seeking || m_streamsDirty;
+      });
+      continue;
+    }
+
+    if (loop_a >= 0) {
+      if (loop_replaying) {
+        if (loop_seq < loop_store.endSeq()) {
+          uint64_t seq = loop_seq++;
+          if (loop_store.packetAt(seq, pkt.get())) {
+            if ((pkt->stream_index == vid_idx && seq >= loop_from.videoFrom) ||
+                (pkt->stream_index == aud_idx && seq >= loop_from.audioFrom))
+              loop_forward(pkt.get(), false);
+            av_packet_unref(pkt.get());
+          }
+          if (video_done && audio_done)
+            loop_wrap();
+          continue;
         }
-        vwidth = vctx->width;
-        vheight = vctx->height;
-        vtime_base = fmt_ctx->streams[vid_idx]->time_base;
-        if (sws_ctx)
-          sws_freeContext(sws_ctx);
-        sws_ctx = nullptr;
-        if (rgb_buf)
-          av_free(rgb_buf);
-        rgb_buf = nullptr;
-        rgb_buf_size = 0;
-        if (vwidth && vheight) {
-          rgb_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          rgb_buf = (uint8_t *)av_malloc(rgb_buf_size);
+        loop_replaying = false;
+        if (loop_complete || (video_done && audio_done)) {
+          loop_wrap();
+          continue;
         }
+        // 只缓存了开头：从文件接着读，跳过已经送出的部分
+        int64_t resume_ms = INT64_MAX;
+        if (head_video_ts != AV_NOPTS_VALUE)
+          resume_ms = std::min<int64_t>(
+              resume_ms, av_rescale_q(head_video_ts,
+                                      fmt->streams[vid_idx]->time_base,
+                                      {1, 1000}));
+        if (head_audio_ts != AV_NOPTS_VALUE)
+          resume_ms = std::min<int64_t>(
+              resume_ms, av_rescale_q(head_audio_ts,
+                                      fmt->streams[aud_idx]->time_base,
+                                      {1, 1000}));
+        seek_file(resume_ms == INT64_MAX ? loop_a : resume_ms);
+        skip_video_ts = head_video_ts;
+        skip_audio_ts = head_audio_ts;
+        continue;
       }
-
-      // 暂停处理
-      if (m_pause) {
-        std::unique_lock<std::mutex> lk(m_mutex);
-        m_cond.wait(lk, [&] { return m_stop || !m_pause || m_seeking; });
-        if (m_stop)
-          break;
-        playback_start_time = clock::now();
+      int ret = av_read_frame(fmt, pkt.get());
+      if (ret < 0) {
+        // B 在文件末尾之后：读到末尾即回绕
+        if (ret == AVERROR_EOF || avio_feof(fmt->pb))
+          loop_wrap();
+        else
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
       }
+      if ((pkt->stream_index == vid_idx || pkt->stream_index == aud_idx) &&
+          !skip_resumed(pkt.get()))
+        loop_forward(pkt.get(), true);
+      av_packet_unref(pkt.get());
+      if (video_done && audio_done)
+        loop_wrap();
+      continue;
+    }
 
-      // 跳转处理
-      if (m_seeking) {
-        int64_t ts = m_seekTarget * (AV_TIME_BASE / 1000);
-        av_seek_frame(fmt_ctx.get(), -1, ts, AVSEEK_FLAG_BACKWARD);
-        avcodec_flush_buffers(vctx.get());
-        playback_start_time = clock::now();
+    // 重放缓存中的 packet，视频从关键帧起、音频从目标前一个 packet 起
+    if (replay_seq < ring.endSeq()) {
+      uint64_t seq = replay_seq++;
+      if (ring.packetAt(seq, pkt.get())) {
+        if (pkt->stream_index == vid_idx && seq >= replay.videoFrom)
+          m_videoQueue.put(pkt.get());
+        else if (pkt->stream_index == aud_idx && seq >= replay.audioFrom)
+          m_audioQueue.put(pkt.get());
         av_packet_unref(pkt.get());
-        av_frame_unref(frame.get());
-        {
-          std::lock_guard<std::mutex> lk(m_mutex);
-          m_videoSeekHandled = true;
-          if (m_audioSeekHandled)
-            m_seeking = false;
-        }
-        continue;
       }
+      continue;
+    }
 
-      // 读取视频帧
-      if (av_read_frame(fmt_ctx.get(), pkt.get()) < 0) {
+    int ret = av_read_frame(fmt, pkt.get());
+    if (ret < 0) {
+      if (ret == AVERROR_EOF || avio_feof(fmt->pb)) {
+        // 通知解码线程冲刷解码器中剩余的帧
+        m_videoQueue.putEof();
+        m_audioQueue.putEof();
+        eof_sent = true;
         m_eof = true;
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      continue;
+    }
+
+    if (pkt->stream_index == vid_idx || pkt->stream_index == aud_idx) {
+      ring.push(pkt.get(), fmt->streams[pkt->stream_index]->time_base);
+      replay_seq = ring.endSeq();
+    }
+    if (pkt->stream_index == vid_idx)
+      m_videoQueue.put(pkt.get());
+    else if (pkt->stream_index == aud_idx)
+      m_audioQueue.put(pkt.get());
+    av_packet_unref(pkt.get());
+
+    // 追帧：解码跟不上（或暂停）时丢掉旧数据，视频丢到下一个关键帧
+    if (m_live) {
+      int dropped = m_videoQueue.dropToDuration(LIVE_KEEP_MS, true) +
+                    m_audioQueue.dropToDuration(LIVE_KEEP_MS, false);
+      if (dropped > 0)
+        qDebug() << "Live: dropped" << dropped << "packets to catch up";
+    }
+  }
+
+  if (loop_wraps > 0)
+    qDebug() << "A-B loop:" << loop_wraps << "wraps," << loop_memory_wraps
+             << "from memory, packet cache" << loop_store.bytes() / 1024
+             << "KB" << (loop_complete ? "(whole loop)" : "(loop start)");
+  if (seeks > 0)
+    qDebug() << "Seek buffer:" << ring_seeks << "of" << seeks
+             << "seeks served from memory, window" << ring.durationMs()
+             << "ms" << ring.bytes() / 1024 << "KB";
+  IoStats io = ioStats();
+  if (io.readCalls > 0) {
+    qDebug() << "IO stats: bytes" << io.bytesRead << "reads" << io.readCalls
+             << "avg us" << io.totalReadUs / io.readCalls << "max us"
+             << io.maxReadUs << "stalls" << io.stalls << "stall ms"
+             << io.stallUs / 1000;
+    if (io.cacheHits + io.cacheMisses > 0)
+      qDebug() << "Cache hit rate:"
+               << 100.0 * io.cacheHits / (io.cacheHits + io.cacheMisses) << "%";
+  }
+}
+
+void FFMpegDecoder::startIndexer(int streamIndex) {
+  if (streamIndex < 0)
+    return;
+  m_indexThread = std::thread([this, streamIndex]() {
+    std::shared_ptr<KeyframeIndex> index = std::make_shared<KeyframeIndex>();
+    if (!index->load(m_path) || index->streamIndex() != streamIndex) {
+      auto begin = std::chrono::steady_clock::now();
+      if (!index->build(m_path, streamIndex, m_stop))
+        return;
+      index->save(m_path);
+      qDebug() << "Keyframe index built:" << index->entries().size()
+               << "keyframes in"
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - begin)
+                      .count()
+               << "ms";
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_keyframeIndex = index;
+    }
+    emit keyframeIndexReady();
+  });
+}
+
+std::shared_ptr<const KeyframeIndex> FFMpegDecoder::keyframeIndex() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_keyframeIndex;
+}
+
+bool FFMpegDecoder::waitForOpen() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_cond.wait(lk, [&] { return m_stop || m_opened || m_openFailed; });
+  return m_opened && !m_stop;
+}
+
+void FFMpegDecoder::videoDecodeLoop() {
+  // 等待解复用线程打开输入
+  if (!waitForOpen())
+    return;
+  AVFormatContext *fmt_ctx = m_fmtCtx;
+
+  // 资源初始化
+  AVCodec *vcodec = nullptr;
+  AVCodecContextPtr vctx;
+  int cur_vid_idx = -1;
+  AVRational vtime_base = {0, 1};
+  AVPacketPtr pkt = make_avpacket();
+  AVFramePtr frame = make_avframe();
+  int serial = m_videoQueue.serial();
+  int applied_level = -1; // 已写入解码器的降级等级
+  // 精确跳转：显示时间在该值之前的帧解出后丢弃，-1 表示不丢弃
+  qint64 discard_until = -1;
+  bool catching_up = false; // 追赶阶段已额外跳过非参考帧
+  using clock = std::chrono::steady_clock;
+  auto elapsedUs = [](clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() -
+                                                                 begin)
+        .count();
+  };
+
+  // A-B 循环：从 A 起解出的最初几帧（整段放得下时为整段）保留引用，
+  // 回绕标记到来时直接送入帧队列，解码器从 A 之前的关键帧追上来之前不缺帧
+  struct LoopFrame {
+    AVFramePtr frame;
+    int64_t ms;
+  };
+  std::vector<LoopFrame> loop_frames;
+  size_t loop_frame_bytes = 0;
+  qint64 loop_id = 0, loop_a = -1, loop_b = -1;
+  int loop_hot_frames = std::max(1, loopOptions().hotFrames);
+  size_t loop_clip_budget = loopOptions().frameBytes;
+  bool loop_capturing = false; // 这一遍从 A 起播，正在保留解出的帧
+  bool loop_clip = false;      // 按整段保留
+  bool loop_skip = false;      // 这一遍用缓存的整段，丢弃视频 packet
+  auto truncate_loop_frames = [&](size_t keep) {
+    m_loopClipCached = 0;
+    if (loop_frames.size() > keep)
+      loop_frames.resize(keep);
+    loop_frame_bytes = 0;
+    for (const LoopFrame &f : loop_frames)
+      loop_frame_bytes += av_image_get_buffer_size(
+          (AVPixelFormat)f.frame->format, f.frame->width, f.frame->height, 1);
+    loop_clip = false;
+  };
+  auto capture_loop_frame = [&](const AVFrame *f, int64_t ms,
+                                int frame_interval) {
+    int bytes = av_image_get_buffer_size((AVPixelFormat)f->format, f->width,
+                                         f->height, 1);
+    if (loop_frames.empty()) {
+      // 按第一帧估算整段的大小，放得下就整段保留
+      int64_t count = (loop_b - loop_a) / std::max(1, frame_interval) + 1;
+      loop_clip = bytes > 0 && count * bytes <= (int64_t)loop_clip_budget;
+    }
+    if (loop_clip && loop_frame_bytes + bytes > loop_clip_budget) {
+      // 估算偏小（如帧率不固定）：退回只保留开头
+      truncate_loop_frames(loop_hot_frames);
+      loop_capturing = false;
+      return;
+    }
+    AVFrame *ref = av_frame_clone(f);
+    if (!ref)
+      return;
+    loop_frames.push_back(LoopFrame{AVFramePtr(ref), ms});
+    loop_frame_bytes += std::max(0, bytes);
+    if (!loop_clip && (int)loop_frames.size() >= loop_hot_frames)
+      loop_capturing = false;
+  };
+
+  while (!m_stop) {
+    // 获取当前视频轨道索引
+    int vid_idx = -1;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (m_videoTrackIndex >= 0 &&
+          m_videoTrackIndex < static_cast<int>(m_videoStreamIndices.size()))
+        vid_idx = m_videoStreamIndices[m_videoTrackIndex];
+    }
+
+    // 处理空轨道
+    if (vid_idx < 0) {
+      // 清空画面
+      emit frameReady(QSharedPointer<QImage>());
+
+      // 暂停或等待状态变化
+      if (m_pause) {
         std::unique_lock<std::mutex> lk(m_mutex);
-        m_cond.wait_for(lk, std::chrono::milliseconds(50),
-                        [&] { return m_stop || m_seeking || m_eof == false; });
+        m_cond.wait(lk, [&] {
+          return m_stop || !m_pause || m_seeking || m_videoTrackIndex != -1;
+        });
         if (m_stop)
           break;
-        if (m_seeking) {
-          m_eof = false;
-          continue;
-        }
-        continue;
       }
 
-      // 判断是否为视频流
-      if (pkt->stream_index != vid_idx) {
-        av_packet_unref(pkt.get());
+      // 处理 seek（队列 serial 变化说明解复用线程已完成跳转）
+      if (m_videoQueue.serial() != serial) {
+        serial = m_videoQueue.serial();
+        SeekRequest req;
+        if (seekForSerial(serial, true, &req))
+          m_audioClockMs.store(req.targetMs);
         continue;
       }
 
-      // 发送视频帧到解码器
-      avcodec_send_packet(vctx.get(), pkt.get());
+      // 推进位置（基于音频时钟）
+      emit positionChanged(m_audioClockMs.load());
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+      continue;
+    }
 
-      // 接收解码后的视频帧
-      while (!m_stop && !m_seeking &&
-             avcodec_receive_frame(vctx.get(), frame.get()) == 0) {
-        double speed = m_playbackSpeed.load();
+    // 初始化/重置视频解码资源（如果轨道变化）
+    if (!vctx || vid_idx != cur_vid_idx) {
+      vcodec = find_decoder(fmt_ctx->streams[vid_idx]->codecpar->codec_id,
+                            AVMEDIA_TYPE_VIDEO);
+      if (!vcodec) {
+        qWarning() << "Video decoder not found";
+        emit errorOccurred(tr("未找到视频解码器"));
+        break;
+      }
+      vctx = make_avcodec_ctx(vcodec);
+      if (!vctx) {
+        qWarning() << "Failed to allocate video decoder context";
+        emit errorOccurred(tr("无法分配视频解码器上下文"));
+        break;
+      }
+      if (avcodec_parameters_to_context(
+              vctx.get(), fmt_ctx->streams[vid_idx]->codecpar) < 0) {
+        qWarning() << "Failed to copy video decoder parameters";
+        emit errorOccurred(tr("无法复制视频解码器参数"));
+        break;
+      }
+      DecoderThreading threading = decoderThreading();
+      // 帧级并行会让输出推迟 thread_count 帧，直播只用片级并行
+      if (m_live)
+        threading.lowDelay = true;
+      applyThreading(vctx.get(), threading);
+      // 源远大于显示区域时降低解码分辨率；不支持 lowres 的解码器（H.264、
+      // HEVC 等）走更便宜的解码路径，解出的整帧由 FrameConverter 先按 2^n
+      // 预缩小再缩放到显示尺寸
+      int shrink = 0, lowres = 0;
+      if (m_autoLowres) {
+        QSize box(m_outputWidth.load(), m_outputHeight.load());
+        shrink = lowresFor(vctx->width, vctx->height, box, 3);
+        lowres = std::min(shrink, av_codec_get_max_lowres(vcodec));
+      }
+      vctx->lowres = lowres;
+      if (shrink > 0 && lowres == 0)
+        vctx->flags2 |= AV_CODEC_FLAG2_FAST;
+      m_degrade.setMinimumLevel(shrink > 0 && lowres == 0
+                                    ? DegradeController::SkipLoopFilter
+                                    : DegradeController::Normal);
+      if (shrink > 0)
+        qDebug() << "Reduced decode for" << vctx->width << "x" << vctx->height
+                 << (lowres > 0 ? "lowres"
+                                : "no lowres, skip loop filter, pre-decimate")
+                 << (lowres > 0 ? lowres : shrink);
+      if (avcodec_open2(vctx.get(), vcodec, nullptr) < 0) {
+        qWarning() << "Failed to open video decoder";
+        emit errorOccurred(tr("无法打开视频解码器"));
+        break;
+      }
+      cur_vid_idx = vid_idx;
+      applied_level = -1;
+      vtime_base = fmt_ctx->streams[vid_idx]->time_base;
+      int frame_interval = 40;
+      if (vctx->framerate.num && vctx->framerate.den) {
+        frame_interval = 1000 * vctx->framerate.den / vctx->framerate.num;
+        frame_interval = std::max(10, std::min(frame_interval, 80));
+      }
+      m_frameIntervalMs = frame_interval;
+    }
+
+    // 已有新的跳转请求：队列里的数据即将作废，不再解码（包括精确跳转
+    // 还没追到目标的部分），等解复用线程执行最新的请求
+    if (m_seeking) {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait_for(lk, std::chrono::milliseconds(10),
+                      [&] { return m_stop || !m_seeking; });
+      continue;
+    }
+
+    // 从视频队列取出 packet
+    int pkt_serial = 0;
+    int got = m_videoQueue.get(pkt.get(), &pkt_serial, 50);
+    if (got < 0)
+      break;
+    if (got == 0)
+      continue;
+
+    // 循环区间变化，缓存的帧作废
+    if (m_loopId != loop_id) {
+      loopState(&loop_id, &loop_a, &loop_b);
+      loop_frames.clear();
+      loop_frame_bytes = 0;
+      loop_capturing = loop_clip = loop_skip = false;
+    }
 
+    // 跳转处理：serial 变化后丢弃解码器内的旧帧
+    if (pkt_serial != serial) {
+      serial = pkt_serial;
+      avcodec_flush_buffers(vctx.get());
+      av_frame_unref(frame.get());
+      m_degrade.restartWindow();
+      SeekRequest req;
+      bool found = seekForSerial(serial, true, &req);
+      discard_until = found && req.mode == AccurateSeek ? req.targetMs : -1;
+      // 循环中途的跳转打断了整段保留，只留下开头；从 A 起播时开始保留
+      loop_skip = false;
+      if (loop_capturing && loop_clip)
+        truncate_loop_frames(loop_hot_frames);
+      loop_capturing = loop_a >= 0 && found && req.targetMs == loop_a &&
+                       loop_frames.empty();
+    }
+
+    // 回绕标记：冲刷出 B 之前的最后几帧，再接上 A 点保留的帧
+    int frame_interval = m_frameIntervalMs.load();
+    if (PacketQueue::isLoopMarker(pkt.get())) {
+      av_packet_unref(pkt.get());
+      avcodec_send_packet(vctx.get(), nullptr);
+      while (!m_stop && !m_seeking && m_videoQueue.serial() == serial &&
+             avcodec_receive_frame(vctx.get(), frame.get()) == 0) {
         int64_t pts = frame->best_effort_timestamp;
         if (pts == AV_NOPTS_VALUE)
           pts = frame->pts;
-        if (pts == AV_NOPTS_VALUE)
-          pts = 0;
-        int64_t ms = pts * vtime_base.num * 1000LL / vtime_base.den;
-        qint64 audioClock = m_audioClockMs.load();
-        qint64 diff = ms - audioClock;
-
-        bool hasAudio = (m_audioTrackIndex != -1);
-        int frame_interval = 40;
-        if (vctx->framerate.num && vctx->framerate.den) {
-          frame_interval = 1000 * vctx->framerate.den / vctx->framerate.num;
-          frame_interval = std::max(10, std::min(frame_interval, 80));
+        int64_t ms = pts == AV_NOPTS_VALUE
+                         ? 0
+                         : av_rescale_q(pts, vtime_base, {1, 1000});
+        if (loop_skip || (loop_b >= 0 && ms >= loop_b) ||
+            (discard_until >= 0 && ms + frame_interval <= discard_until)) {
+          av_frame_unref(frame.get());
+          continue;
         }
-        int max_wait = frame_interval * 2;
-
-        if (hasAudio && audioClock > 0) {
-          if (diff > frame_interval) {
-            int waited = 0;
-            if (diff > 20 && waited < max_wait && !m_stop && !m_pause &&
-                !m_seeking) {
-              int sleep_time = static_cast<int>(diff * 0.8 / speed);
-              std::this_thread::sleep_for(
-                  std::chrono::milliseconds(sleep_time));
-              waited += sleep_time;
-              audioClock = m_audioClockMs.load();
-              diff = ms - audioClock;
-            }
-            while (diff > 5 && waited < max_wait && !m_stop && !m_pause &&
-                   !m_seeking) {
-              std::this_thread::sleep_for(std::chrono::milliseconds(5));
-              waited += 5;
-              audioClock = m_audioClockMs.load();
-              diff = ms - audioClock;
-            }
-            if (m_stop || m_seeking || m_pause)
-              break;
-            if (diff > frame_interval)
-              continue;
-          } else if (diff < -frame_interval * 6) {
-            continue;
-          }
+        if (loop_capturing && ms >= loop_a)
+          capture_loop_frame(frame.get(), ms, frame_interval);
+        m_frameQueue.put(frame.get(), serial, ms);
+      }
+      avcodec_flush_buffers(vctx.get());
+      av_frame_unref(frame.get());
+      if (loop_capturing) {
+        // 上一遍从 A 播到了 B，整段保留完成后不再需要视频 packet
+        loop_capturing = false;
+        if (loop_clip && !loop_frames.empty()) {
+          m_loopClipCached = loop_id;
+          qDebug() << "A-B loop: cached whole loop," << loop_frames.size()
+                   << "frames" << loop_frame_bytes / 1024 << "KB";
+        } else if (!loop_frames.empty()) {
+          qDebug() << "A-B loop: cached" << loop_frames.size()
+                   << "frames at the loop start";
         }
+      }
+      bool whole = loop_clip && !loop_frames.empty();
+      for (const LoopFrame &f : loop_frames) {
+        if (av_frame_ref(frame.get(), f.frame.get()) < 0 ||
+            !m_frameQueue.put(frame.get(), serial, f.ms))
+          break;
+      }
+      av_frame_unref(frame.get());
+      loop_skip = whole;
+      // 解码器从关键帧重新解码，保留的帧之前的部分只追赶不显示
+      if (whole)
+        discard_until = -1;
+      else if (!loop_frames.empty())
+        discard_until = loop_frames.back().ms + frame_interval;
+      else
+        discard_until = loop_a;
+      loop_capturing = loop_a >= 0 && loop_frames.empty();
+      continue;
+    }
+    if (loop_skip) {
+      av_packet_unref(pkt.get());
+      continue;
+    }
 
-        if (!hasAudio) {
-          static qint64 last_video_pts = 0;
-          static auto last_wall_clock = clock::now();
-          static float last_video_speed = 1.0f;
+    // 精确跳转的追赶阶段：显示时间在目标之前的 packet 若是非参考帧，
+    // 解出来也会被丢弃，又不被其他帧引用，交给解码器直接跳过
+    bool catch_up = discard_until >= 0 && pkt->pts != AV_NOPTS_VALUE &&
+                    av_rescale_q(pkt->pts, vtime_base, {1, 1000}) +
+                            frame_interval <=
+                        discard_until;
+
+    // 降级等级变化时修改跳过策略，下一个 packet 起生效
+    int level = m_degrade.level();
+    if (level != applied_level || catch_up != catching_up) {
+      DegradeController::applyToCodec(vctx.get(), level);
+      if (catch_up && vctx->skip_frame < AVDISCARD_NONREF)
+        vctx->skip_frame = AVDISCARD_NONREF;
+      applied_level = level;
+      catching_up = catch_up;
+    }
 
-          float speed = m_playbackSpeed.load(); // 加入倍速控制
+    // 发送视频帧到解码器（空 packet 表示流结束，冲刷剩余帧）
+    // 解码耗时不含在帧队列上阻塞的时间，用于判断解码是否跟得上
+    clock::time_point busy_begin = clock::now();
+    int64_t busy_us = 0;
+    avcodec_send_packet(vctx.get(), pkt.get());
+    av_packet_unref(pkt.get());
+    // 快进模式下相邻关键帧互不相关：每个都立即冲刷出来，不等解码器
+    // 攒够重排或帧级多线程所需的后续 packet
+    bool trick = m_trickPlay;
+    if (trick)
+      avcodec_send_packet(vctx.get(), nullptr);
+
+    // 接收解码后的视频帧，原样放入帧队列，由显示线程决定显示哪一帧
+    // 队列满时在这里阻塞，解码最多领先显示 m_frameQueue 容量的帧数
+    while (!m_stop && !m_seeking && m_videoQueue.serial() == serial &&
+           avcodec_receive_frame(vctx.get(), frame.get()) == 0) {
+      busy_us += elapsedUs(busy_begin);
+      int64_t pts = frame->best_effort_timestamp;
+      if (pts == AV_NOPTS_VALUE)
+        pts = frame->pts;
+      if (pts == AV_NOPTS_VALUE)
+        pts = 0;
+      int64_t ms = pts * vtime_base.num * 1000LL / vtime_base.den;
+      // 循环区间内只显示 B 之前的帧（B 之后的 packet 可能是前面帧的参考帧）
+      if (loop_b >= 0 && ms >= loop_b) {
+        av_frame_unref(frame.get());
+        busy_begin = clock::now();
+        continue;
+      }
+      // 目标之前的帧不进入帧队列，也就不做颜色转换；显示区间覆盖目标的帧起正常输出
+      if (discard_until >= 0) {
+        if (ms + frame_interval <= discard_until) {
+          av_frame_unref(frame.get());
+          busy_begin = clock::now();
+          continue;
+        }
+        discard_until = -1;
+      }
+      if (loop_capturing && ms >= loop_a)
+        capture_loop_frame(frame.get(), ms, frame_interval);
+      m_frameQueue.put(frame.get(), serial, ms);
+      busy_begin = clock::now();
+    }
+    if (trick)
+      avcodec_flush_buffers(vctx.get());
+    busy_us += elapsedUs(busy_begin);
+    m_degrade.addDecodeTime(busy_us);
+
+    QString reason;
+    if (m_degrade.update(&reason)) {
+      int new_level = m_degrade.level();
+      qDebug() << "Decode degrade level" << applied_level << "->" << new_level
+               << DegradeController::levelName(new_level) << ":" << reason;
+      emit degradeLevelChanged(new_level, reason);
+    }
+  }
+}
 
-          // 检测速度变化，如果速度变化超过阈值，重置视频同步参考点
-          bool speed_changed = fabs(speed - last_video_speed) > 0.1f;
-          if (speed_changed) {
-            last_video_pts = 0; // 强制重置参考点
-            last_video_speed = speed;
-          }
+void FFMpegDecoder::presentLoop() {
+  // 等待解复用线程打开输入
+  if (!waitForOpen())
+    return;
 
-          if (last_video_pts == 0 || ms < last_video_pts || speed_changed) {
-            last_video_pts = ms;
-            last_wall_clock = clock::now();
-          } else {
-            qint64 pts_diff = ms - last_video_pts;
-            auto now = clock::now();
-            auto elapsed =
-                std::chrono::duration_cast<std::chrono::milliseconds>(
-                    now - last_wall_clock)
-                    .count();
-
-            if (!m_stop && !m_seeking && !m_pause &&
-                elapsed < pts_diff / speed) {
-              std::this_thread::sleep_for(std::chrono::milliseconds(
-                  static_cast<int>((pts_diff / speed) - elapsed)));
-            }
-
-            if (!m_stop && !m_seeking) {
-              last_video_pts = ms;
-              last_wall_clock = clock::now();
-            }
-          }
-        }
+  int vwidth = 0, vheight = 0;
+  int out_width = 0, out_height = 0; // 转换输出尺寸（按显示区域等比缩放）
+  QImage::Format out_format = QImage::Format_Invalid;
+  bool out_dither = false;
+  int src_pix_fmt = -1;
+  FrameConverter converter;
+  int convert_threads = decoderThreading().convertThreads;
+  converter.setThreadCount(
+      convert_threads > 0
+          ? convert_threads
+          : WorkerPool::defaultThreadCount(CONVERT_MAX_AUTO_THREADS));
+  int rgb_stride = 0;
+  // 显示中的帧：显示线程 1 帧、信号队列中 1~2 帧、界面持有 1 帧
+  std::shared_ptr<FrameBufferPool> pool =
+      FrameBufferPool::create(FRAME_POOL_BUFFERS);
+  AVFramePtr frame = make_avframe();
+  using clock = std::chrono::steady_clock;
 
-        if (m_stop || m_seeking)
-          break;
+  // 无音频时按墙钟节奏显示
+  qint64 last_video_pts = 0;
+  clock::time_point last_wall_clock = clock::now();
+  float last_video_speed = 1.0f;
+  int last_serial = -1;
+  bool seek_landing = false; // 新 serial 的第一帧尚未显示
+  int shown_serial = -1;     // 最近显示的帧所属的 serial
 
-        // 初始化 SwsContext
-        if (!sws_ctx || sws_src_pix_fmt != frame->format ||
-            frame->width != vwidth || frame->height != vheight) {
-          if (sws_ctx)
-            sws_freeContext(sws_ctx);
-          vwidth = frame->width;
-          vheight = frame->height;
-          rgb_stride = vwidth * 3;
-          int new_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          if (new_buf_size != rgb_buf_size) {
-            if (rgb_buf)
-              av_free(rgb_buf);
-            rgb_buf = (uint8_t *)av_malloc(new_buf_size);
-            rgb_buf_size = new_buf_size;
-          }
-          sws_ctx = sws_getCachedContext(
-              nullptr, vwidth, vheight, (AVPixelFormat)frame->format, vwidth,
-              vheight, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr,
-              nullptr);
-          sws_src_pix_fmt = frame->format;
-          if (!sws_ctx)
-            continue;
+  while (!m_stop) {
+    // 暂停处理：暂停中跳转（或刚启动就暂停）时仍显示新位置的第一帧，
+    // 解复用线程冲刷队列后会唤醒这里
+    bool paused_preview = false;
+    if (m_pause) {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] {
+        return m_stop || !m_pause ||
+               (!m_seeking && m_videoQueue.serial() != shown_serial);
+      });
+      if (m_stop)
+        break;
+      last_video_pts = 0;
+      paused_preview = m_pause;
+    }
+
+    int serial = 0;
+    int64_t ms = 0;
+    int got = m_frameQueue.get(frame.get(), &serial, &ms, 50);
+    if (got < 0)
+      break;
+    if (got == 0)
+      continue;
+
+    // 新的跳转请求到来后，当前帧不再需要显示
+    auto superseded = [&] {
+      return m_stop || m_seeking || m_videoQueue.serial() != serial;
+    };
+    if (superseded()) {
+      av_frame_unref(frame.get());
+      continue;
+    }
+    if (serial != last_serial) {
+      last_serial = serial;
+      last_video_pts = 0;
+      seek_landing = true;
+    }
+
+    double speed = m_playbackSpeed.load();
+    // A-B 循环回绕前后音视频可能分处 B、A 两侧，时间差按循环长度折算
+    auto clock_diff = [&](qint64 audio_ms) {
+      qint64 d = ms - audio_ms;
+      qint64 loop_len = m_loopLenMs.load();
+      if (loop_len > 0) {
+        if (d > loop_len / 2)
+          d -= loop_len;
+        else if (d < -loop_len / 2)
+          d += loop_len;
+      }
+      return d;
+    };
+    qint64 audioClock = m_audioClockMs.load();
+    qint64 diff = clock_diff(audioClock);
+
+    // 快进模式静音，按墙钟和倍速控制关键帧的显示间隔
+    bool hasAudio = (m_audioTrackIndex != -1) && !m_trickPlay;
+    int frame_interval = m_frameIntervalMs.load();
+    int max_wait = frame_interval * 2;
+    bool drop = false;
+
+    if (hasAudio && m_audioClockValid && !paused_preview) {
+      if (diff > frame_interval) {
+        int waited = 0;
+        if (diff > 20 && waited < max_wait && !m_pause && !superseded()) {
+          int sleep_time = static_cast<int>(diff * 0.8 / speed);
+          std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+          waited += sleep_time;
+          audioClock = m_audioClockMs.load();
+          diff = clock_diff(audioClock);
+        }
+        while (diff > 5 && waited < max_wait && !m_pause && !superseded()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+          waited += 5;
+          audioClock = m_audioClockMs.load();
+          diff = clock_diff(audioClock);
         }
+        drop = superseded() || m_pause || diff > frame_interval;
+      } else if (diff < -frame_interval * 6) {
+        // 落后太多的帧直接丢弃，不做格式转换
+        drop = true;
+      }
+      // 落后程度交给降级控制器，持续落后时降低解码开销
+      if (!superseded() && !m_pause)
+        m_degrade.addFrame(-diff, frame_interval, drop && diff < 0);
+    }
 
-        if (!rgb_buf) {
-          rgb_buf_size =
-              av_image_get_buffer_size(AV_PIX_FMT_RGB24, vwidth, vheight, 1);
-          rgb_buf = (uint8_t *)av_malloc(rgb_buf_size);
-          if (!rgb_buf)
-            continue;
+    if (!hasAudio && !paused_preview) {
+      // 检测速度变化，如果速度变化超过阈值，重置视频同步参考点
+      bool speed_changed = fabs(speed - last_video_speed) > 0.1f;
+      if (speed_changed)
+        last_video_speed = speed;
+
+      // 直播追帧后时间戳会向前跳，直接以新帧为参考点
+      bool jumped = m_live && ms - last_video_pts > LIVE_RESYNC_MS;
+      if (last_video_pts == 0 || ms < last_video_pts || speed_changed ||
+          jumped) {
+        last_video_pts = ms;
+        last_wall_clock = clock::now();
+      } else {
+        qint64 pts_diff = ms - last_video_pts;
+        auto now = clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           now - last_wall_clock)
+                           .count();
+
+        if (!superseded() && !m_pause && elapsed < pts_diff / speed) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(
+              static_cast<int>((pts_diff / speed) - elapsed)));
         }
 
-        // 转换格式
-        uint8_t *dst[1] = {rgb_buf};
-        int dst_linesize[1] = {rgb_stride};
-        sws_scale(sws_ctx, frame->data, frame->linesize, 0, vheight, dst,
-                  dst_linesize);
-
-        // 创建 QImage
-        struct RGBBufferDeleter {
-          void operator()(QImage *img) { delete img; }
-        };
-        QSharedPointer<QImage> imgPtr;
-        if (rgb_buf) {
-          QImage *rawImg = new QImage(
-              rgb_buf, vwidth, vheight, rgb_stride, QImage::Format_RGB888,
-              [](void *buf) { av_free(buf); }, rgb_buf);
-          if (!rawImg->isNull()) {
-            imgPtr = QSharedPointer<QImage>(rawImg, RGBBufferDeleter());
-            rgb_buf = nullptr;
-          } else {
-            delete rawImg;
-            QImage tempImg(rgb_buf, vwidth, vheight, rgb_stride,
-                           QImage::Format_RGB888);
-            imgPtr = QSharedPointer<QImage>(new QImage(tempImg.copy()));
-            av_free(rgb_buf);
-            rgb_buf = nullptr;
-          }
+        if (!superseded()) {
+          last_video_pts = ms;
+          last_wall_clock = clock::now();
         }
-        emit frameReady(imgPtr);
-        emit positionChanged(ms);
       }
-      av_packet_unref(pkt.get());
     }
 
-    // 清理资源
-    if (rgb_buf)
-      av_free(rgb_buf);
-    if (sws_ctx)
-      sws_freeContext(sws_ctx);
-  }
-}
-
-void FFMpegDecoder::audioDecodeLoop() {
-  // 打开输入文件和查找流信息
-  AVFormatContext *raw_fmt_ctx = nullptr;
-  AVDictionary *opts = nullptr;
-  av_dict_set(&opts, "probe_size", "1048576", 0);
-  av_dict_set(&opts, "analyzeduration", "1000000", 0);
-  if (avformat_open_input(&raw_fmt_ctx, m_path.toUtf8().constData(), nullptr,
-                          &opts) < 0) {
-    qWarning() << "Failed to open input file:" << m_path;
-    emit errorOccurred(tr("无法打开文件: %1").arg(m_path));
-    av_dict_free(&opts);
-    return;
-  }
-  av_dict_free(&opts);
-  AVFormatContextPtr fmt_ctx(raw_fmt_ctx);
-  if (avformat_find_stream_info(fmt_ctx.get(), nullptr) < 0) {
-    qWarning() << "Failed to get stream info";
-    emit errorOccurred(tr("无法获取媒体流信息"));
-    return;
-  }
+    if (drop || superseded()) {
+      av_frame_unref(frame.get());
+      continue;
+    }
 
-  // 收集所有音频流
-  {
-    std::lock_guard<std::mutex> lk(m_mutex);
-    m_audioStreamIndices.clear();
-    m_audioStreamNames.clear();
-    for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
-      if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-        m_audioStreamIndices.push_back(i);
-        QString name = QString("Track %1").arg(m_audioStreamIndices.size());
-        AVDictionaryEntry *lang =
-            av_dict_get(fmt_ctx->streams[i]->metadata, "language", nullptr, 0);
-        if (lang && lang->value) {
-          name += QString(" [%1]").arg(lang->value);
-        }
-        m_audioStreamNames.push_back(name);
+    // 转换时直接缩放到显示区域内等比适配的尺寸，界面绘制时不必再缩放
+    QSize fit(frame->width, frame->height);
+    QSize box(m_outputWidth.load(), m_outputHeight.load());
+    if (!box.isEmpty() && !fit.isEmpty())
+      fit.scale(box, Qt::KeepAspectRatio);
+
+    QImage::Format format =
+        static_cast<QImage::Format>(m_outputFormat.load());
+    bool dither = m_outputDither.load();
+    bool fast_scale = m_degrade.level() >= DegradeController::FastScale;
+
+    // 源或输出参数变化时重新选择转换路径
+    if (!converter.isValid() || src_pix_fmt != frame->format ||
+        frame->width != vwidth || frame->height != vheight ||
+        fit.width() != out_width || fit.height() != out_height ||
+        format != out_format || dither != out_dither ||
+        fast_scale != converter.fastScaling()) {
+      vwidth = frame->width;
+      vheight = frame->height;
+      out_width = std::max(1, fit.width());
+      out_height = std::max(1, fit.height());
+      out_format = format;
+      out_dither = dither;
+      src_pix_fmt = frame->format;
+      converter.setFastScaling(fast_scale);
+      // 行宽按 32 字节对齐，SIMD 转换可以整行处理
+      int bytes_per_pixel =
+          av_get_padded_bits_per_pixel(
+              av_pix_fmt_desc_get(FrameConverter::avFormatFor(format))) /
+          8;
+      rgb_stride = FFALIGN(out_width * bytes_per_pixel, 32);
+      pool->setBufferSize(static_cast<size_t>(rgb_stride) * out_height);
+      if (!converter.configure(vwidth, vheight, (AVPixelFormat)frame->format,
+                               out_width, out_height, format, dither)) {
+        av_frame_unref(frame.get());
+        continue;
       }
+      qDebug() << "Frame converter:"
+               << av_get_pix_fmt_name((AVPixelFormat)frame->format) << vwidth
+               << "x" << vheight << "->" << out_width << "x" << out_height
+               << "via" << converter.pathName() << "threads"
+               << (converter.isFastPath() ? converter.threadCount() : 1)
+               << "pre-decimated to" << converter.decimatedSize().width()
+               << "x" << converter.decimatedSize().height();
     }
-    if (m_audioTrackIndex >= static_cast<int>(m_audioStreamIndices.size())) {
-      m_audioTrackIndex = m_audioStreamIndices.empty() ? -1 : 0;
+
+    // 界面迟迟不释放旧帧时借不到缓冲区，丢掉这一帧而不是继续分配
+    uint8_t *rgb_buf = pool->acquire(FRAME_POOL_WAIT_MS);
+    if (!rgb_buf) {
+      av_frame_unref(frame.get());
+      continue;
+    }
+
+    // 转换格式（只有确定要显示的帧才做转换）
+    converter.convert(frame.get(), rgb_buf, rgb_stride);
+    av_frame_unref(frame.get());
+
+    // 创建 QImage，图像释放时缓冲区回到池中
+    QSharedPointer<QImage> imgPtr(new QImage(
+        pool->wrap(rgb_buf, out_width, out_height, rgb_stride, out_format)));
+    emit frameReady(imgPtr);
+    emit positionChanged(ms);
+    m_videoClockMs = ms;
+    markFirstOutput(true);
+    shown_serial = serial;
+    if (seek_landing) {
+      seek_landing = false;
+      reportSeekLanded(serial, true, ms);
     }
   }
 
+  // 清理资源（仍被界面持有的缓冲区在 QImage 释放时归还，随后随池释放）
+  FrameBufferPool::Stats ps = pool->stats();
+  if (ps.hits + ps.misses > 0)
+    qDebug() << "Frame pool: hits" << ps.hits << "misses" << ps.misses
+             << "exhausted" << ps.exhausted << "peak"
+             << ps.peakBuffers * ps.bufferSize / 1024 << "KB";
+}
+
+void FFMpegDecoder::audioDecodeLoop() {
+  // 等待解复用线程打开输入
+  if (!waitForOpen())
+    return;
+  AVFormatContext *fmt_ctx = m_fmtCtx;
+
   // 资源和状态变量初始化
   AVCodecContextPtr actx = nullptr;
   SwrContext *swr_ctx = nullptr;
@@ -597,6 +1548,7 @@ void FFMpegDecoder::audioDecodeLoop() {
   int out_buf_samples = 0;
   int last_audio_stream_id = -1; // 用于检测音轨切换
   AVRational atime_base = {0, 1};
+  int serial = m_audioQueue.serial();
 
   // --- 同步状态变量 ---
   using clock = std::chrono::steady_clock;
@@ -605,6 +1557,11 @@ void FFMpegDecoder::audioDecodeLoop() {
   bool first_audio_frame;
   double audio_diff_avg;
   // --- 同步状态变量结束 ---
+  // 精确跳转：目标之前的采样不输出，-1 表示不裁剪
+  qint64 discard_until = -1;
+  bool seek_landing = false; // 无视频时由音频统计跳转延迟
+  // A-B 循环：B 之后的采样不输出，回绕标记之后从 A 接着输出
+  qint64 loop_id = 0, loop_a = -1, loop_b = -1;
 
   // 创建一个集中的函数来重置解码器和同步状态
   auto reset_decoder_and_sync_state = [&]() {
@@ -621,9 +1578,9 @@ void FFMpegDecoder::audioDecodeLoop() {
     first_audio_pts = AV_NOPTS_VALUE;
     first_audio_frame = true;
     audio_diff_avg = 0.0;
-    m_audioClockMs.store(0);
-    // 清理可能正在处理的 packet 和 frame
-    av_packet_unref(pkt.get());
+    // 时钟保持原值（切换轨道时按它回到当前位置），下一帧输出前不作为同步依据
+    m_audioClockValid = false;
+    // 清理可能正在处理的 frame（packet 发送后即已释放）
     av_frame_unref(frame.get());
   };
 
@@ -709,49 +1666,62 @@ void FFMpegDecoder::audioDecodeLoop() {
       }
     }
 
-    // 跳转处理
+    // 已有新的跳转请求时同样不再解码旧位置的数据
     if (m_seeking) {
-      int64_t ts = m_seekTarget * (AV_TIME_BASE / 1000);
-      av_seek_frame(fmt_ctx.get(), -1, ts, AVSEEK_FLAG_BACKWARD);
-      reset_decoder_and_sync_state(); // 跳转后调用集中的状态重置函数
-
-      {
-        std::lock_guard<std::mutex> lk(m_mutex);
-        m_audioSeekHandled = true;
-        if (m_videoSeekHandled)
-          m_seeking = false;
-      }
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait_for(lk, std::chrono::milliseconds(10),
+                      [&] { return m_stop || !m_seeking; });
       continue;
     }
 
-    // 从文件中读取一个 packet
-    if (av_read_frame(fmt_ctx.get(), pkt.get()) < 0) {
-      m_eof = true;
-      std::unique_lock<std::mutex> lk(m_mutex);
-      m_cond.wait_for(lk, std::chrono::milliseconds(50),
-                      [&] { return m_stop || m_seeking || m_eof == false; });
-      if (m_stop)
-        break;
-      if (m_seeking)
-        m_eof = false;
+    // 从音频队列取出 packet
+    int pkt_serial = 0;
+    int got = m_audioQueue.get(pkt.get(), &pkt_serial, 50);
+    if (got < 0)
+      break;
+    if (got == 0)
       continue;
+
+    // 跳转处理：serial 变化后调用集中的状态重置函数
+    if (pkt_serial != serial) {
+      serial = pkt_serial;
+      reset_decoder_and_sync_state();
+      // 新位置的第一帧输出前，位置先停在跳转目标
+      SeekRequest req;
+      discard_until = -1;
+      if (seekForSerial(serial, false, &req)) {
+        m_audioClockMs.store(req.targetMs);
+        if (req.mode == AccurateSeek)
+          discard_until = req.targetMs;
+      }
+      seek_landing = true;
     }
 
-    // 如果不是我们想要的音频流，则丢弃
-    if (pkt->stream_index != current_stream_id) {
+    if (m_loopId != loop_id)
+      loopState(&loop_id, &loop_a, &loop_b);
+    // 回绕标记：解码器不冲刷，A 之前的预读帧与 B 之前的最后一帧自然衔接，
+    // A 之前的采样裁掉；同步参考点从 A 重新开始
+    if (PacketQueue::isLoopMarker(pkt.get())) {
       av_packet_unref(pkt.get());
+      if (loop_a >= 0)
+        discard_until = loop_a;
+      first_audio_frame = true;
       continue;
     }
 
-    // 发送 packet 到解码器
+    // 发送 packet 到解码器（空 packet 表示流结束，冲刷剩余帧）
     if (avcodec_send_packet(actx.get(), pkt.get()) < 0) {
       av_packet_unref(pkt.get());
       continue;
     }
     av_packet_unref(pkt.get()); // 发送后即可释放 packet
 
+    auto superseded = [&] {
+      return m_stop || m_seeking || m_audioQueue.serial() != serial;
+    };
+
     // 从解码器接收解码后的 frame
-    while (!m_stop && !m_seeking) {
+    while (!superseded()) {
       int ret = avcodec_receive_frame(actx.get(), frame.get());
       if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
         break; // 需要更多 packet 或已到流末尾
@@ -769,9 +1739,30 @@ void FFMpegDecoder::audioDecodeLoop() {
       int64_t ms = (pts == AV_NOPTS_VALUE)
                        ? 0
                        : av_rescale_q(pts, atime_base, {1, 1000});
-      if (ms < 0)
+      if (ms < 0 || (loop_b >= 0 && ms >= loop_b)) {
+        av_frame_unref(frame.get());
         continue;
+      }
+
+      // 精确跳转：整帧在目标之前的直接丢弃；跨过目标的帧让重采样器
+      // 丢掉目标之前的输出采样，从目标时刻起播
+      if (discard_until >= 0) {
+        int64_t end_ms =
+            ms + av_rescale(frame->nb_samples, 1000, actx->sample_rate);
+        if (end_ms <= discard_until) {
+          av_frame_unref(frame.get());
+          continue;
+        }
+        if (ms < discard_until) {
+          swr_drop_output(swr_ctx, static_cast<int>(av_rescale(
+                                       discard_until - ms, OUT_SAMPLE_RATE,
+                                       1000)));
+          ms = discard_until;
+        }
+        discard_until = -1;
+      }
       m_audioClockMs.store(ms);
+      m_audioClockValid = true;
 
       // --- 音频同步逻辑 (改进版，支持倍速平滑切换) ---
       double speed = m_playbackSpeed.load();
@@ -795,15 +1786,18 @@ void FFMpegDecoder::audioDecodeLoop() {
                 .count();
         double diff_ms = ((ms - first_audio_pts) / speed) - elapsed_ms;
 
-        // 简单的同步：如果音频播放得太快，就等待一下
-        if (diff_ms > 10) { // 音频超前于时钟
+        // 直播追帧后时间戳跳变，重新以当前帧为参考点
+        if (m_live && fabs(diff_ms) > LIVE_RESYNC_MS) {
+          audio_playback_start_time = clock::now();
+          first_audio_pts = ms;
+        } else if (diff_ms > 10) { // 简单的同步：音频超前于时钟时等待一下
           std::this_thread::sleep_for(
               std::chrono::milliseconds(static_cast<int>(diff_ms * 0.8)));
         }
       }
       // --- 同步逻辑结束 ---
 
-      if (m_stop || m_seeking)
+      if (superseded())
         break;
 
       // 音频重采样
@@ -822,6 +1816,11 @@ void FFMpegDecoder::audioDecodeLoop() {
       int converted_samples =
           swr_convert(swr_ctx, out_buf, out_nb, (const uint8_t **)frame->data,
                       frame->nb_samples);
+      // 跨过 B 的帧只输出 B 之前的部分
+      if (loop_b >= 0)
+        converted_samples = std::min<int>(
+            converted_samples,
+            static_cast<int>(av_rescale(loop_b - ms, OUT_SAMPLE_RATE, 1000)));
       int data_size = av_samples_get_buffer_size(
           nullptr, OUT_CHANNELS, converted_samples, OUT_SAMPLE_FMT, 1);
 
@@ -829,6 +1828,12 @@ void FFMpegDecoder::audioDecodeLoop() {
           QByteArray::fromRawData((const char *)out_buf[0], data_size);
       emit audioReady(pcm);
       emit positionChanged(ms);
+      markFirstOutput(false);
+      if (seek_landing) {
+        seek_landing = false;
+        if (m_videoTrackIndex < 0)
+          reportSeekLanded(serial, false, ms);
+      }
 
       av_frame_unref(frame.get()); // 处理完一帧后立即释放
     }
@@ -844,15 +1849,235 @@ void FFMpegDecoder::audioDecodeLoop() {
   }
 }
 
+void FFMpegDecoder::setOutputSize(const QSize &size) {
+  m_outputWidth = size.width();
+  m_outputHeight = size.height();
+}
+
+void FFMpegDecoder::setOutputFormat(QImage::Format format, bool dither) {
+  if (FrameConverter::avFormatFor(format) == AV_PIX_FMT_NONE) {
+    qWarning() << "Unsupported output format" << format;
+    return;
+  }
+  m_outputFormat = format;
+  m_outputDither = dither && format == QImage::Format_RGB16;
+}
+
+QImage::Format FFMpegDecoder::preferredFormat(int screenDepth) {
+  return screenDepth <= 16 ? QImage::Format_RGB16 : QImage::Format_RGB32;
+}
+
+void FFMpegDecoder::setAutoLowres(bool enabled) { m_autoLowres = enabled; }
+
+int FFMpegDecoder::lowresFor(int srcWidth, int srcHeight, const QSize &box,
+                             int maxLowres) {
+  if (box.isEmpty() || srcWidth <= 0 || srcHeight <= 0)
+    return 0;
+  QSize fit(srcWidth, srcHeight);
+  fit.scale(box, Qt::KeepAspectRatio);
+  // 缩小后仍不小于显示尺寸，画面清晰度不受影响
+  int n = 0;
+  while (n < maxLowres && (srcWidth >> (n + 1)) >= fit.width() &&
+         (srcHeight >> (n + 1)) >= fit.height())
+    n++;
+  return n;
+}
+
+void FFMpegDecoder::setDegradeOptions(const DegradeOptions &options) {
+  m_degrade.setOptions(options);
+}
+
+int FFMpegDecoder::degradeLevel() const { return m_degrade.level(); }
+
+void FFMpegDecoder::setDecoderThreading(const DecoderThreading &threading) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_threading = threading;
+}
+
+DecoderThreading FFMpegDecoder::decoderThreading() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_threading;
+}
+
+void FFMpegDecoder::applyThreading(AVCodecContext *ctx,
+                                   const DecoderThreading &threading) {
+  int type = 0;
+  if (threading.frameThreads && !threading.lowDelay)
+    type |= FF_THREAD_FRAME;
+  if (threading.sliceThreads || threading.lowDelay)
+    type |= FF_THREAD_SLICE;
+  ctx->thread_count = threading.threadCount > 0 ? threading.threadCount : 0;
+  ctx->thread_type = type;
+  if (threading.lowDelay)
+    ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+}
+
+bool FFMpegDecoder::isLiveInput(const QString &path) {
+  if (path == "-" || path.startsWith("pipe:") || path.startsWith("udp://") ||
+      path.startsWith("rtp://"))
+    return true;
+  struct stat st;
+  return stat(path.toUtf8().constData(), &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+bool FFMpegDecoder::isLive() const { return m_live; }
+
 void FFMpegDecoder::setPlaybackSpeed(float speed) {
-  // 限制播放速度范围在0.25-4.0之间
-  float newSpeed = std::max(0.25f, std::min(speed, 4.0f));
+  // 直播按源的速度播放
+  if (m_live)
+    return;
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  // 关键帧快进只对视频有意义，纯音频最高 4 倍速
+  bool has_video = m_videoTrackIndex >= 0;
+  float newSpeed = std::max(
+      0.25f,
+      std::min(speed, has_video ? MAX_PLAYBACK_SPEED : MAX_AUDIO_ONLY_SPEED));
   float oldSpeed = m_playbackSpeed.load();
 
   // 只有当速度真正变化时才更新和发送信号
   if (fabs(newSpeed - oldSpeed) > 0.01f) {
     m_playbackSpeed.store(newSpeed);
   }
+
+  // 进出快进模式：从当前画面的位置重新读取，队列中按旧模式读取的数据作废；
+  // 回到正常播放时精确跳转，音画从最后显示的关键帧处接上
+  bool trick = has_video && newSpeed >= TRICK_PLAY_SPEED;
+  if (trick != m_trickPlay) {
+    m_trickPlay = trick;
+    m_streamsDirty = true;
+    requestSeekLocked(m_videoClockMs.load(), trick ? FastSeek : AccurateSeek);
+    m_eof = false;
+    qDebug() << (trick ? "Trick play on at" : "Trick play off at") << newSpeed
+             << "x, position" << m_videoClockMs.load() << "ms";
+    m_cond.notify_all();
+  }
+}
+
+bool FFMpegDecoder::isTrickPlay() const { return m_trickPlay; }
+
+qint64 FFMpegDecoder::elapsedSinceStart() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - m_startTime)
+      .count();
+}
+
+void FFMpegDecoder::markFirstOutput(bool video) {
+  if (m_readyEmitted)
+    return;
+  StartupStats stats;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_readyEmitted)
+      return;
+    qint64 &slot =
+        video ? m_startupStats.firstVideoMs : m_startupStats.firstAudioMs;
+    if (slot < 0)
+      slot = elapsedSinceStart();
+    // 当前选中的每一路都已有输出后才算就绪
+    if ((m_videoTrackIndex >= 0 && m_startupStats.firstVideoMs < 0) ||
+        (m_audioTrackIndex >= 0 && m_startupStats.firstAudioMs < 0))
+      return;
+    m_readyEmitted = true;
+    stats = m_startupStats;
+  }
+  qDebug() << "Playback ready: open" << stats.openMs << "ms, probe"
+           << stats.probeMs << "ms" << (stats.probeCacheHit ? "(cached)" : "")
+           << ", first video" << stats.firstVideoMs << "ms, first audio"
+           << stats.firstAudioMs << "ms";
+  emit playbackReady(stats);
+}
+
+void FFMpegDecoder::setSourceOptions(const MediaSource::Options &opts) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_sourceOptions = opts;
+}
+
+void FFMpegDecoder::setSeekBuffer(const PacketRing::Options &opts) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_seekBufferOptions = opts;
+}
+
+PacketRing::Options FFMpegDecoder::seekBuffer() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_seekBufferOptions;
+}
+
+void FFMpegDecoder::setLoop(qint64 aMs, qint64 bMs) {
+  if (m_live)
+    return;
+  aMs = std::max<qint64>(0, aMs);
+  if (bMs <= aMs) {
+    clearLoop();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_loopAMs = aMs;
+    m_loopBMs = bMs;
+    m_loopLenMs = bMs - aMs;
+    m_loopId++;
+    // 从 A 起播，第一遍顺便把 A 点起的 packet 和画面缓存下来
+    requestSeekLocked(aMs, AccurateSeek);
+  }
+  m_eof = false;
+  m_cond.notify_all();
+  qDebug() << "A-B loop" << aMs << "-" << bMs << "ms";
+  emit loopChanged(aMs, bMs);
+}
+
+void FFMpegDecoder::clearLoop() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (!cancelLoopLocked(m_loopId))
+      return;
+    // 队列里已经接上了 A 点的数据，从当前位置重新读取
+    qint64 pos = m_audioTrackIndex >= 0 ? m_audioClockMs.load()
+                                        : m_videoClockMs.load();
+    requestSeekLocked(pos, AccurateSeek);
+  }
+  m_eof = false;
+  m_cond.notify_all();
+  emit loopChanged(-1, -1);
+}
+
+bool FFMpegDecoder::cancelLoopLocked(qint64 id) {
+  if (id != m_loopId || m_loopAMs < 0)
+    return false;
+  m_loopAMs = -1;
+  m_loopBMs = -1;
+  m_loopLenMs = 0;
+  m_loopId++;
+  return true;
+}
+
+bool FFMpegDecoder::loopRange(qint64 *aMs, qint64 *bMs) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  *aMs = m_loopAMs;
+  *bMs = m_loopBMs;
+  return m_loopAMs >= 0;
+}
+
+void FFMpegDecoder::loopState(qint64 *id, qint64 *aMs, qint64 *bMs) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  *id = m_loopId;
+  *aMs = m_loopAMs;
+  *bMs = m_loopBMs;
+}
+
+void FFMpegDecoder::setLoopOptions(const LoopOptions &options) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_loopOptions = options;
+}
+
+LoopOptions FFMpegDecoder::loopOptions() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_loopOptions;
+}
+
+IoStats FFMpegDecoder::ioStats() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_source ? m_source->stats() : IoStats();
 }
 
 float FFMpegDecoder::playbackSpeed() const {
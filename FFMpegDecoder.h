@@ -2,16 +2,67 @@
 #include <QImage>
 #include <QObject>
 #include <QSharedPointer>
+#include <QSize>
 #include <QString>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
 
+#include "DegradeController.h"
+#include "FrameQueue.h"
+#include "KeyframeIndex.h"
+#include "MediaSource.h"
+#include "PacketQueue.h"
+#include "PacketRing.h"
+
 extern "C" {
+#include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 }
 
+// 解复用线程打开输入后得到的媒体信息（当前选中的音视频轨道）
+struct MediaInfo {
+  int width = 0;
+  int height = 0;
+  int sampleRate = 0;
+  int channels = 0;
+  qint64 durationMs = 0;
+};
+
+// 启动耗时统计，均相对 start() 调用时刻（ms），-1 表示没有该路输出
+struct StartupStats {
+  qint64 openMs = -1;         // 打开输入
+  qint64 probeMs = -1;        // 获取流信息
+  bool probeCacheHit = false; // 流信息是否来自缓存
+  qint64 firstVideoMs = -1;   // 第一帧画面
+  qint64 firstAudioMs = -1;   // 第一段音频
+};
+
+// 视频解码线程配置，下次打开解码器时生效
+struct DecoderThreading {
+  int threadCount = 0;      // 0 表示自动（按 CPU 核数）
+  bool frameThreads = true; // 帧级并行：吞吐最高，但每个线程多一帧延迟
+  bool sliceThreads = true; // 片级并行：不增加延迟，取决于码流的 slice 数
+  bool lowDelay = false;    // 只用片级并行，适合频繁 seek 和直播
+  int convertThreads = 0;   // 颜色转换的条带并行线程数，0 表示自动
+};
+
+// A-B 循环的内存预算，下次 start 生效
+struct LoopOptions {
+  // A 点起缓存的 packet，整段放不下时只保留开头，其余回绕后照常从文件读取
+  size_t packetBytes = 64 * 1024 * 1024;
+  // 整段解码后的画面不超过该值时缓存整段，之后的循环不再解码视频
+  size_t frameBytes = 96 * 1024 * 1024;
+  // 否则只保留 A 点起最初的这几帧，回绕时立即显示，解码器随后追上
+  int hotFrames = 8;
+};
+
+Q_DECLARE_METATYPE(MediaInfo)
+Q_DECLARE_METATYPE(StartupStats)
+
 class FFMpegDecoder : public QObject {
   Q_OBJECT
 public:
@@ -21,7 +72,13 @@ public:
   // path: 文件路径
   void start(const QString &path); // 移除 rate 参数
   void stop();
-  void seek(qint64 ms);
+  // 跳转方式：FastSeek 落在目标之前最近的关键帧，起播最快，适合拖动和快速浏览；
+  // AccurateSeek 从关键帧解码到目标位置，之前的帧解出后直接丢弃（不做颜色转换），
+  // 音频按采样裁掉目标之前的部分，适合精确定位
+  // 连续的跳转请求只执行最新的一个，被取代的请求不再解码；
+  // 返回本次请求的 id（直播不支持跳转，返回 0），落地后随 seekCompleted 报告
+  enum SeekMode { FastSeek, AccurateSeek };
+  qint64 seek(qint64 ms, SeekMode mode = FastSeek);
   void togglePause();
   bool isPaused() const; // 新增：判断是否暂停
 
@@ -37,9 +94,68 @@ public:
   int currentVideoTrack() const;
   QString videoTrackName(int idx) const;
 
-  // 倍速支持
+  // 倍速支持：0.25~16 倍（无视频时最高 4 倍）。4 倍及以上进入快进模式：
+  // 只解复用、解码关键帧，按倍速间隔显示，音频静音；进出快进模式时
+  // 在当前位置重新跳转（退出时精确跳转）
   void setPlaybackSpeed(float speed);
   float playbackSpeed() const; // <--- **确保这一行存在且是 public 的**
+  bool isTrickPlay() const;
+
+  // 直播输入（标准输入 "-"、pipe:、命名管道、udp://、rtp://）：最小探测、极小队列、
+  // 不支持 seek，队列积压超过上限时丢弃旧数据追赶，保持端到端延迟有界
+  static bool isLiveInput(const QString &path);
+  bool isLive() const;
+
+  // 输出帧的显示区域：画面按原比例缩放到区域内后再输出，为空时保持原始尺寸
+  void setOutputSize(const QSize &size);
+
+  // 输出帧的像素格式：与屏幕后备缓冲一致时 Qt 绘制不必再逐帧转换
+  // 支持 RGB32、ARGB32_Premultiplied、RGB16（可选有序抖动）和 RGB888
+  void setOutputFormat(QImage::Format format, bool dither = false);
+  // 根据屏幕色深选择默认输出格式：16 位屏用抖动的 RGB16，其余用 RGB32
+  static QImage::Format preferredFormat(int screenDepth);
+
+  // 视频解码多线程
+  void setDecoderThreading(const DecoderThreading &threading);
+  DecoderThreading decoderThreading() const;
+  // 打开解码器前把线程配置写入 ctx
+  static void applyThreading(AVCodecContext *ctx,
+                             const DecoderThreading &threading);
+
+  // 源远大于显示区域时降低解码分辨率：支持 lowres 的解码器（MPEG-1/2/4、H.263、
+  // MJPEG 等）直接输出 1/2~1/8 尺寸，其他解码器跳过环路滤波并启用快速解码，
+  // 下次打开解码器时生效
+  void setAutoLowres(bool enabled);
+  // 源按原比例适配到 box 后仍不小于显示尺寸的最大缩小级数 n（缩小 2^n 倍），
+  // 不超过 maxLowres
+  static int lowresFor(int srcWidth, int srcHeight, const QSize &box,
+                       int maxLowres);
+
+  // 解码跟不上时的自动降级（跳过环路滤波、B 帧、非参考帧，快速缩放，只解关键帧）
+  void setDegradeOptions(const DegradeOptions &options);
+  int degradeLevel() const;
+
+  // 输入层：本地文件的读取方式（预读窗口、内存映射、整体载入），下次 start 生效
+  void setSourceOptions(const MediaSource::Options &opts);
+  IoStats ioStats() const;
+  // 跳转缓冲：保留最近读到的 packet（按时长和字节数限制），目标在窗口内的
+  // 跳转直接从内存重放，不调用 av_seek_frame 也不读取存储，下次 start 生效
+  void setSeekBuffer(const PacketRing::Options &opts);
+  PacketRing::Options seekBuffer() const;
+
+  // A-B 循环：设置后精确跳转到 A，播放到 B 时不冲刷队列，直接在 packet 队列里
+  // 接上 A 点的数据，音频连续输出不留空隙。A 点起的 packet 缓存在内存，回绕
+  // 不读文件；A 点最初几帧（或整段）解码后保留，回绕时立即送去显示。
+  // 跳转到区间之外时自动取消；bMs <= aMs 时等同 clearLoop()
+  void setLoop(qint64 aMs, qint64 bMs);
+  // 取消循环，从当前位置继续播放
+  void clearLoop();
+  bool loopRange(qint64 *aMs, qint64 *bMs) const;
+  void setLoopOptions(const LoopOptions &options);
+  LoopOptions loopOptions() const;
+
+  // 后台建立（或从缓存读入）的关键帧索引，尚未就绪时为空
+  std::shared_ptr<const KeyframeIndex> keyframeIndex() const;
 
 signals:
   void frameReady(const QSharedPointer<QImage> &img);
@@ -47,33 +163,103 @@ signals:
   void durationChanged(qint64 ms);
   void positionChanged(qint64 ms);
   void errorOccurred(const QString &message); // 新增：错误信号
+  void mediaInfoReady(const MediaInfo &info);
+  // 第一帧画面和第一段音频都已输出（只发送一次）
+  void playbackReady(const StartupStats &stats);
+  // 解码降级等级变化（DegradeController::Level），reason 为触发时的负载
+  void degradeLevelChanged(int level, const QString &reason);
+  // 跳转后的第一帧画面已输出（无视频时为第一段音频），latencyMs 从 seek()
+  // 调用算起；被后续请求取代的跳转不会报告
+  void seekCompleted(qint64 id, qint64 targetMs, qint64 landedMs,
+                     qint64 latencyMs);
+  // A-B 循环区间变化，取消时（包括跳到区间外自动取消）均为 -1
+  void loopChanged(qint64 aMs, qint64 bMs);
+  // 关键帧索引就绪，可以通过 keyframeIndex() 取得
+  void keyframeIndexReady();
 
 private:
   // 线程与同步
+  std::thread m_demuxThread;
   std::thread m_videoThread;
+  std::thread m_presentThread;
   std::thread m_audioThread;
   std::atomic<bool> m_stop{false};
   std::atomic<bool> m_pause{false};
+  // 跳转请求；videoSerial/audioSerial 为执行后各 packet 队列的 serial
+  struct SeekRequest {
+    qint64 id = 0;
+    qint64 targetMs = 0;
+    int mode = FastSeek;
+    qint64 requestedMs = 0; // 发起时刻，相对 start()
+    int videoSerial = -1;
+    int audioSerial = -1;
+  };
+  // m_seeking 表示有待执行的请求（m_pendingSeek），后到的请求直接覆盖它；
+  // 解复用线程取走并执行后记为 m_activeSeek。均由 m_mutex 保护
   std::atomic<bool> m_seeking{false};
-  std::atomic<qint64> m_seekTarget{0};
-  std::mutex m_mutex;
+  SeekRequest m_pendingSeek;
+  SeekRequest m_activeSeek;
+  qint64 m_nextSeekId = 0;
+  qint64 m_reportedSeekId = 0;
+  int m_supersededSeeks = 0; // 上次报告以来被覆盖的请求数
+  qint64 requestSeekLocked(qint64 ms, SeekMode mode);
+  // 解码线程看到新 serial 时查询对应的跳转，serial 已过期时返回 false
+  bool seekForSerial(int serial, bool video, SeekRequest *req) const;
+  // 新 serial 的第一帧输出后调用，每个请求只报告一次
+  void reportSeekLanded(int serial, bool video, qint64 landedMs);
+  mutable std::mutex m_mutex;
   std::condition_variable m_cond;
 
-  // seek 同步标志
-  bool m_videoSeekHandled = false;
-  bool m_audioSeekHandled = false;
+  // 解复用：单线程读取文件，按流分发到各自的 packet 队列
+  AVFormatContext *m_fmtCtx = nullptr; // 由解复用线程打开，stop() 时释放
+  bool m_opened = false;               // 输入已打开且流信息就绪
+  bool m_openFailed = false;
+  std::unique_ptr<MediaSource> m_source; // 自定义 I/O，随 m_fmtCtx 一起释放
+  MediaSource::Options m_sourceOptions;
+  PacketRing::Options m_seekBufferOptions;
+  LoopOptions m_loopOptions;
+  DecoderThreading m_threading;
+  std::atomic<bool> m_streamsDirty{false}; // 轨道变化，需要重新设置 discard
+  PacketQueue m_videoQueue;
+  PacketQueue m_audioQueue;
+  // 解码后的视频帧（原始格式），由显示线程按时钟选帧、转换并输出
+  FrameQueue m_frameQueue;
+  std::atomic<int> m_frameIntervalMs{40};
+  std::atomic<int> m_outputWidth{0};
+  std::atomic<int> m_outputHeight{0};
+  std::atomic<int> m_outputFormat{QImage::Format_RGB888};
+  std::atomic<bool> m_outputDither{false};
+  DegradeController m_degrade;
+  std::atomic<bool> m_autoLowres{true};
+
+  // 关键帧索引：后台建立，就绪后 seek 直接按字节偏移跳转
+  std::thread m_indexThread;
+  std::shared_ptr<const KeyframeIndex> m_keyframeIndex;
+  void startIndexer(int streamIndex);
 
   // 播放结束标志
   std::atomic<bool> m_eof{false}; // 新增
 
-  // 音频时钟（ms）
+  // 首帧耗时统计
+  std::chrono::steady_clock::time_point m_startTime;
+  StartupStats m_startupStats;
+  std::atomic<bool> m_readyEmitted{false};
+  qint64 elapsedSinceStart() const;
+  void markFirstOutput(bool video);
+
+  // 音频时钟（ms）；跳转、恢复播放后到新的第一帧输出前无效，显示线程不按它同步
   std::atomic<qint64> m_audioClockMs{0};
+  std::atomic<bool> m_audioClockValid{false};
 
   // 播放参数
   QString m_path;
+  bool m_live = false; // start() 时根据路径判断
 
   // 解码主循环
+  void demuxLoop();
+  bool waitForOpen();
   void videoDecodeLoop();
+  void presentLoop();
   void audioDecodeLoop();
 
   int m_audioTrackIndex = 0;                       // -1为静音
@@ -86,4 +272,21 @@ private:
 
   // 倍速支持
   std::atomic<float> m_playbackSpeed{1.0f};
+  // 关键帧快进模式，只在跳转请求的同一把锁内切换
+  std::atomic<bool> m_trickPlay{false};
+  // 最近显示的画面时间，快进模式下没有音频时钟，进出快进按它定位
+  std::atomic<qint64> m_videoClockMs{0};
+
+  // A-B 循环区间，由 m_mutex 保护，-1 表示没有循环；每次变化 m_loopId 递增，
+  // 各线程看到新 id 后刷新自己的副本
+  qint64 m_loopAMs = -1;
+  qint64 m_loopBMs = -1;
+  std::atomic<qint64> m_loopId{0};
+  // 循环长度，显示线程折算回绕前后的音视频时间差，0 表示没有循环
+  std::atomic<qint64> m_loopLenMs{0};
+  // 视频解码线程已缓存整段画面的循环 id，解复用线程回绕时不再送视频 packet
+  std::atomic<qint64> m_loopClipCached{0};
+  void loopState(qint64 *id, qint64 *aMs, qint64 *bMs) const;
+  // 调用方持有 m_mutex；id 不是当前循环时不做任何事，返回是否已取消
+  bool cancelLoopLocked(qint64 id);
 };
\ No newline at end of file
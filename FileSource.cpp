@@ -0,0 +1,158 @@
+#include "FileSource.h"
+#include <QtDebug>
+#include <algorithm>
+#include <cstring>
+
+// 预读线程单次读取的块大小，较大的顺序读取对 SD 卡/eMMC 更友好
+static const int READ_AHEAD_CHUNK = 512 * 1024;
+
+FileSource::FileSource(const QString &path, Mode mode, size_t readAheadBytes)
+    : m_file(path), m_mode(mode) {
+  if (m_mode == ReadAhead)
+    m_ring.resize(std::max<size_t>(readAheadBytes, READ_AHEAD_CHUNK * 2));
+}
+
+FileSource::~FileSource() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_abort = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  if (m_map)
+    m_file.unmap(const_cast<uchar *>(m_map));
+}
+
+bool FileSource::open() {
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Failed to open file:" << m_file.fileName();
+    return false;
+  }
+  m_size = m_file.size();
+
+  switch (m_mode) {
+  case Mmap:
+    m_map = m_file.map(0, m_size);
+    return m_map != nullptr;
+  case Memory:
+    m_memory = m_file.readAll();
+    m_file.close();
+    return m_memory.size() == m_size;
+  case ReadAhead:
+    m_thread = std::thread(&FileSource::readAheadLoop, this);
+    return true;
+  default:
+    return false;
+  }
+}
+
+int64_t FileSource::size() const { return m_size; }
+
+QString FileSource::describe() const {
+  switch (m_mode) {
+  case Mmap:
+    return "mmap";
+  case Memory:
+    return "memory";
+  case ReadAhead:
+    return QString("read-ahead %1KB").arg(m_ring.size() / 1024);
+  default:
+    return "file";
+  }
+}
+
+int FileSource::readAt(int64_t pos, uint8_t *buf, int size) {
+  if (pos >= m_size)
+    return 0;
+  int n = static_cast<int>(std::min<int64_t>(size, m_size - pos));
+  switch (m_mode) {
+  case Mmap:
+    memcpy(buf, m_map + pos, n);
+    return n;
+  case Memory:
+    memcpy(buf, m_memory.constData() + pos, n);
+    return n;
+  case ReadAhead:
+    return readAheadAt(pos, buf, n);
+  default:
+    return AVERROR(EINVAL);
+  }
+}
+
+int FileSource::readAheadAt(int64_t pos, uint8_t *buf, int size) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_readPos = pos;
+  // 目标位置不在窗口内（跳转），从新位置重新预读
+  if (pos < m_winStart || pos > m_winEnd) {
+    m_winStart = m_winEnd = pos;
+    m_fillEof = false;
+    m_generation++;
+  }
+  m_cond.notify_all();
+  m_cond.wait(lk, [&] {
+    return m_abort || m_winEnd > m_readPos || m_fillEof;
+  });
+  if (m_abort)
+    return AVERROR_EXIT;
+  if (m_winEnd <= m_readPos)
+    return 0;
+
+  size_t cap = m_ring.size();
+  int n = static_cast<int>(std::min<int64_t>(size, m_winEnd - m_readPos));
+  size_t off = static_cast<size_t>(m_readPos % cap);
+  size_t first = std::min<size_t>(n, cap - off);
+  memcpy(buf, m_ring.data() + off, first);
+  if (first < static_cast<size_t>(n))
+    memcpy(buf + first, m_ring.data(), n - first);
+  m_readPos += n;
+  m_cond.notify_all();
+  return n;
+}
+
+void FileSource::readAheadLoop() {
+  std::vector<uint8_t> chunk(READ_AHEAD_CHUNK);
+  size_t cap = m_ring.size();
+  while (true) {
+    int64_t fill_pos;
+    quint64 generation;
+    int want;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      // 窗口内未读数据已填满整个缓冲区时等待消费
+      m_cond.wait(lk, [&] {
+        return m_abort ||
+               (!m_fillEof && m_winEnd - m_readPos < static_cast<int64_t>(cap));
+      });
+      if (m_abort)
+        return;
+      fill_pos = m_winEnd;
+      generation = m_generation;
+      want = static_cast<int>(std::min<int64_t>(
+          READ_AHEAD_CHUNK, static_cast<int64_t>(cap) - (m_winEnd - m_readPos)));
+    }
+
+    qint64 n = -1;
+    if (m_file.seek(fill_pos))
+      n = m_file.read(reinterpret_cast<char *>(chunk.data()), want);
+
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (generation != m_generation)
+      continue; // 读取期间发生了跳转，结果作废
+    if (n <= 0) {
+      if (n < 0)
+        qWarning() << "Read-ahead failed at" << fill_pos;
+      m_fillEof = true;
+      m_cond.notify_all();
+      continue;
+    }
+    size_t off = static_cast<size_t>(fill_pos % cap);
+    size_t first = std::min<size_t>(n, cap - off);
+    memcpy(m_ring.data() + off, chunk.data(), first);
+    if (first < static_cast<size_t>(n))
+      memcpy(m_ring.data(), chunk.data() + first, n - first);
+    m_winEnd += n;
+    m_winStart = std::max<int64_t>(m_winStart, m_winEnd - cap);
+    m_cond.notify_all();
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "MediaSource.h"
+#include <QByteArray>
+#include <QFile>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 本地文件输入源，支持后台预读、内存映射和整体载入三种方式
+class FileSource : public MediaSource {
+public:
+  FileSource(const QString &path, Mode mode, size_t readAheadBytes);
+  ~FileSource() override;
+
+  bool open() override;
+  int64_t size() const override;
+  QString describe() const override;
+
+protected:
+  int readAt(int64_t pos, uint8_t *buf, int size) override;
+
+private:
+  int readAheadAt(int64_t pos, uint8_t *buf, int size);
+  void readAheadLoop();
+
+  QFile m_file;
+  Mode m_mode;
+  int64_t m_size = 0;
+
+  // Mmap / Memory
+  const uchar *m_map = nullptr;
+  QByteArray m_memory;
+
+  // ReadAhead：环形缓冲区保存文件区间 [m_winStart, m_winEnd)
+  std::vector<uint8_t> m_ring;
+  int64_t m_winStart = 0;
+  int64_t m_winEnd = 0;
+  int64_t m_readPos = 0;
+  quint64 m_generation = 0; // 预读位置重置计数，丢弃过期的读取结果
+  bool m_fillEof = false;
+  bool m_abort = false;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::thread m_thread;
+};
@@ -0,0 +1,109 @@
+#include "FrameBufferPool.h"
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+namespace {
+// QImage 清理回调的参数：持有池的引用，保证归还时池仍然存在
+struct Lease {
+  std::shared_ptr<FrameBufferPool> pool;
+  uint8_t *buf;
+  size_t size;
+};
+} // namespace
+
+std::shared_ptr<FrameBufferPool> FrameBufferPool::create(size_t maxBuffers) {
+  return std::shared_ptr<FrameBufferPool>(new FrameBufferPool(maxBuffers));
+}
+
+FrameBufferPool::FrameBufferPool(size_t maxBuffers)
+    : m_maxBuffers(std::max<size_t>(1, maxBuffers)) {}
+
+FrameBufferPool::~FrameBufferPool() {
+  for (uint8_t *buf : m_free)
+    av_free(buf);
+}
+
+void FrameBufferPool::setBufferSize(size_t bytes) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (bytes == m_bufferSize)
+    return;
+  for (uint8_t *buf : m_free)
+    av_free(buf);
+  m_stats.buffers -= m_free.size();
+  m_free.clear();
+  m_bufferSize = bytes;
+  m_stats.bufferSize = bytes;
+  m_cond.notify_all();
+}
+
+uint8_t *FrameBufferPool::acquire(int timeoutMs) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (m_bufferSize == 0)
+    return nullptr;
+  if (!m_cond.wait_for(lk, std::chrono::milliseconds(timeoutMs), [&] {
+        return !m_free.empty() || m_stats.buffers < m_maxBuffers;
+      })) {
+    m_stats.exhausted++;
+    return nullptr;
+  }
+  if (!m_free.empty()) {
+    uint8_t *buf = m_free.back();
+    m_free.pop_back();
+    m_stats.hits++;
+    return buf;
+  }
+  uint8_t *buf = static_cast<uint8_t *>(av_malloc(m_bufferSize));
+  if (!buf)
+    return nullptr;
+  m_stats.misses++;
+  m_stats.buffers++;
+  m_stats.peakBuffers = std::max(m_stats.peakBuffers, m_stats.buffers);
+  return buf;
+}
+
+QImage FrameBufferPool::wrap(uint8_t *buf, int width, int height, int stride,
+                             QImage::Format format) {
+  size_t size;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    size = m_bufferSize;
+  }
+  Lease *lease = new Lease{shared_from_this(), buf, size};
+  return QImage(
+      buf, width, height, stride, format,
+      [](void *info) {
+        Lease *l = static_cast<Lease *>(info);
+        l->pool->releaseSized(l->buf, l->size);
+        delete l;
+      },
+      lease);
+}
+
+void FrameBufferPool::release(uint8_t *buf) {
+  size_t size;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    size = m_bufferSize;
+  }
+  releaseSized(buf, size);
+}
+
+void FrameBufferPool::releaseSized(uint8_t *buf, size_t size) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (size != m_bufferSize) {
+    av_free(buf);
+    m_stats.buffers--;
+  } else {
+    m_free.push_back(buf);
+  }
+  m_cond.notify_all();
+}
+
+FrameBufferPool::Stats FrameBufferPool::stats() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <QImage>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 显示帧缓冲池：复用固定大小的对齐缓冲区，避免每帧 av_malloc 几 MB 内存
+// QImage 直接引用池中的缓冲区，最后一个副本释放时由清理回调归还；
+// 同时借出的缓冲区数量有上限，从而限制峰值内存
+class FrameBufferPool : public std::enable_shared_from_this<FrameBufferPool> {
+public:
+  struct Stats {
+    qint64 hits = 0;      // 复用空闲缓冲区
+    qint64 misses = 0;    // 新分配缓冲区
+    qint64 exhausted = 0; // 达到上限、借不到缓冲区的次数
+    size_t buffers = 0;   // 当前持有的缓冲区（空闲 + 借出）
+    size_t peakBuffers = 0;
+    size_t bufferSize = 0;
+  };
+
+  // 池需要比借出的 QImage 活得久，因此只通过 shared_ptr 创建
+  static std::shared_ptr<FrameBufferPool> create(size_t maxBuffers);
+  ~FrameBufferPool();
+
+  // 设置缓冲区大小（分辨率变化时调用），旧尺寸的缓冲区归还时直接释放
+  void setBufferSize(size_t bytes);
+  // 借出缓冲区；已达上限且 timeoutMs 内没有归还时返回 nullptr
+  uint8_t *acquire(int timeoutMs);
+  // 用借出的 buf 构造 QImage，QImage 的数据被释放时归还缓冲区
+  QImage wrap(uint8_t *buf, int width, int height, int stride,
+              QImage::Format format);
+  // 未交给 QImage 的缓冲区直接归还
+  void release(uint8_t *buf);
+
+  Stats stats() const;
+
+private:
+  explicit FrameBufferPool(size_t maxBuffers);
+  void releaseSized(uint8_t *buf, size_t size);
+
+  std::vector<uint8_t *> m_free;
+  size_t m_bufferSize = 0;
+  size_t m_maxBuffers;
+  Stats m_stats;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
@@ -0,0 +1,405 @@
+#include "FrameConverter.h"
+#include <QtGlobal>
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+// 每个条带至少这么多行，小画面不值得拆分
+static const int MIN_SLICE_ROWS = 16;
+
+namespace {
+// 4x4 Bayer 矩阵，右移一位后作为 RGB565 红/蓝分量的抖动量（0~7）
+const uint8_t BAYER_4X4[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+void deinterleave(const uint8_t *uv, uint8_t *u, uint8_t *v, int n) {
+  for (int i = 0; i < n; i++) {
+    u[i] = uv[2 * i];
+    v[i] = uv[2 * i + 1];
+  }
+}
+} // namespace
+
+FrameConverter::FrameConverter() {}
+
+FrameConverter::~FrameConverter() { reset(); }
+
+AVPixelFormat FrameConverter::avFormatFor(QImage::Format format) {
+  switch (format) {
+  case QImage::Format_RGB32:
+  case QImage::Format_ARGB32_Premultiplied:
+    // 0xAARRGGBB 按本机字节序存放；sws 对不透明源填充 alpha=255，预乘后不变
+    return AV_PIX_FMT_RGB32;
+  case QImage::Format_RGB16:
+    return AV_PIX_FMT_RGB565;
+  case QImage::Format_RGB888:
+    return AV_PIX_FMT_RGB24;
+  default:
+    return AV_PIX_FMT_NONE;
+  }
+}
+
+SwsContext *FrameConverter::createScaler(int srcWidth, int srcHeight,
+                                         AVPixelFormat srcFormat, int dstWidth,
+                                         int dstHeight, QImage::Format format,
+                                         bool dither, bool fast) {
+  SwsContext *ctx = sws_alloc_context();
+  if (!ctx)
+    return nullptr;
+  av_opt_set_int(ctx, "srcw", srcWidth, 0);
+  av_opt_set_int(ctx, "srch", srcHeight, 0);
+  av_opt_set_int(ctx, "src_format", srcFormat, 0);
+  av_opt_set_int(ctx, "dstw", dstWidth, 0);
+  av_opt_set_int(ctx, "dsth", dstHeight, 0);
+  av_opt_set_int(ctx, "dst_format", avFormatFor(format), 0);
+  av_opt_set_int(ctx, "sws_flags", fast ? SWS_POINT : SWS_BILINEAR, 0);
+  av_opt_set(ctx, "sws_dither", dither ? "bayer" : "none", 0);
+  if (sws_init_context(ctx, nullptr, nullptr) < 0) {
+    sws_freeContext(ctx);
+    return nullptr;
+  }
+  return ctx;
+}
+
+bool FrameConverter::configure(int srcWidth, int srcHeight,
+                               AVPixelFormat srcFormat, int dstWidth,
+                               int dstHeight, QImage::Format format,
+                               bool dither, ConvertKernels::Isa isa) {
+  reset();
+  if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0 ||
+      avFormatFor(format) == AV_PIX_FMT_NONE)
+    return false;
+  m_srcWidth = srcWidth;
+  m_srcHeight = srcHeight;
+  m_srcFormat = srcFormat;
+  m_dstWidth = dstWidth;
+  m_dstHeight = dstHeight;
+  m_format = format;
+  m_dither = dither && format == QImage::Format_RGB16;
+
+  // sws 在未设置色彩参数时对 yuv420p/nv12 一律按 BT.601 有限范围转换，
+  // 快速路径沿用同一矩阵；yuvj420p 等全范围格式和 10 位格式交给 sws
+  bool fastFormat =
+      (srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_NV12) &&
+      format != QImage::Format_RGB888 && Q_BYTE_ORDER == Q_LITTLE_ENDIAN;
+  // 缩小超过一半时双线性会混叠：先按 2^n 做 box 预缩小，剩下不超过一半的
+  // 部分再双线性缩放（最近邻不在乎混叠，直接采样）；预缩小后每个色度平面
+  // 至少保留两个样本
+  if (m_preDecimation && !m_fastScaling) {
+    while (dstWidth * 2 < (srcWidth >> m_shiftX) &&
+           (srcWidth >> (m_shiftX + 1)) >= 4)
+      m_shiftX++;
+    while (dstHeight * 2 < (srcHeight >> m_shiftY) &&
+           (srcHeight >> (m_shiftY + 1)) >= 4)
+      m_shiftY++;
+  }
+  bool fastScale = srcWidth >= 2 && srcHeight >= 2 &&
+                   (m_fastScaling || (dstWidth * 2 >= (srcWidth >> m_shiftX) &&
+                                      dstHeight * 2 >= (srcHeight >> m_shiftY)));
+  if (fastFormat && fastScale)
+    m_kernels = ConvertKernels::get(isa);
+
+  if (m_kernels) {
+    m_row = format == QImage::Format_RGB16 ? m_kernels->rgb565
+                                           : m_kernels->rgb32;
+    m_scaled = dstWidth != srcWidth || dstHeight != srcHeight;
+    int cw = (srcWidth + 1) / 2, ch = (srcHeight + 1) / 2;
+    int dcw = (dstWidth + 1) / 2;
+    if (m_scaled) {
+      m_lumaX = makeTaps(srcWidth >> m_shiftX, dstWidth, m_fastScaling);
+      m_lumaY = makeTaps(srcHeight >> m_shiftY, dstHeight, m_fastScaling);
+      m_chromaX = makeTaps(cw >> m_shiftX, dcw, m_fastScaling);
+      m_chromaY = makeTaps(ch >> m_shiftY, dstHeight, m_fastScaling);
+    }
+    // 垂直插值行：亮度 + 两个色度（nv12 为交织的整行）；重采样行：亮度 + 两个色度
+    m_scratchBytes = srcWidth + 4 * cw + dstWidth + 2 * std::max(cw, dcw);
+    // 预缩小：每个平面缓存两行
+    if (m_shiftX || m_shiftY)
+      m_scratchBytes += 2 * (srcWidth + 4 * cw);
+    m_scratch.clear();
+    return true;
+  }
+
+  // swscale 路径：按行存放的格式可以把行宽放大 2^n 倍、高度缩小 2^n 倍，
+  // 隔行取样后再缩放，swscale 只读取用到的源行；水平方向无法这样跳过
+  m_shiftX = 0;
+  m_shiftY = 0;
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(srcFormat);
+  bool rowAddressable =
+      desc && !(desc->flags & (AV_PIX_FMT_FLAG_HWACCEL |
+                               AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL));
+  if (m_preDecimation && rowAddressable) {
+    while (dstHeight * 2 < (srcHeight >> m_shiftY) &&
+           (srcHeight >> (m_shiftY + 1)) >= (4 << desc->log2_chroma_h))
+      m_shiftY++;
+  }
+  m_sws = createScaler(srcWidth, srcHeight >> m_shiftY, srcFormat, dstWidth,
+                       dstHeight, format, m_dither, m_fastScaling);
+  return m_sws != nullptr;
+}
+
+void FrameConverter::reset() {
+  if (m_sws) {
+    sws_freeContext(m_sws);
+    m_sws = nullptr;
+  }
+  m_kernels = nullptr;
+  m_row = nullptr;
+  m_scaled = false;
+  m_shiftX = m_shiftY = 0;
+  m_lumaX.clear();
+  m_lumaY.clear();
+  m_chromaX.clear();
+  m_chromaY.clear();
+}
+
+void FrameConverter::setFastScaling(bool fast) { m_fastScaling = fast; }
+
+void FrameConverter::setPreDecimation(bool enabled) {
+  m_preDecimation = enabled;
+}
+
+bool FrameConverter::preDecimation() const { return m_preDecimation; }
+
+QSize FrameConverter::decimatedSize() const {
+  return QSize(m_srcWidth >> m_shiftX, m_srcHeight >> m_shiftY);
+}
+
+bool FrameConverter::fastScaling() const { return m_fastScaling; }
+
+void FrameConverter::setThreadCount(int threads) {
+  threads = std::max(1, threads);
+  if (threads == threadCount())
+    return;
+  m_pool.reset(threads > 1 ? new WorkerPool(threads) : nullptr);
+}
+
+int FrameConverter::threadCount() const {
+  return m_pool ? m_pool->threadCount() : 1;
+}
+
+bool FrameConverter::isValid() const { return m_kernels || m_sws; }
+
+bool FrameConverter::isFastPath() const { return m_kernels != nullptr; }
+
+const char *FrameConverter::pathName() const {
+  if (m_kernels)
+    return m_kernels->name;
+  return m_sws ? "swscale" : "none";
+}
+
+void FrameConverter::convert(const AVFrame *frame, uint8_t *dst, int stride) {
+  if (m_kernels) {
+    int slices =
+        std::min(threadCount(), std::max(1, m_dstHeight / MIN_SLICE_ROWS));
+    if (m_scratch.size() < static_cast<size_t>(slices))
+      m_scratch.resize(slices, std::vector<uint8_t>(m_scratchBytes));
+    auto slice = [&](int i) {
+      int yBegin = m_dstHeight * i / slices;
+      int yEnd = m_dstHeight * (i + 1) / slices;
+      convertRows(frame, dst, stride, yBegin, yEnd, m_scratch[i].data());
+    };
+    if (slices > 1)
+      m_pool->run(slices, slice);
+    else
+      slice(0);
+  } else if (m_sws) {
+    uint8_t *dstPlanes[1] = {dst};
+    int dstStride[1] = {stride};
+    int linesize[AV_NUM_DATA_POINTERS];
+    for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+      linesize[i] = frame->linesize[i] * (1 << m_shiftY);
+    sws_scale(m_sws, frame->data, linesize, 0, m_srcHeight >> m_shiftY,
+              dstPlanes, dstStride);
+  }
+}
+
+std::vector<FrameConverter::Tap>
+FrameConverter::makeTaps(int srcSize, int dstSize, bool nearest) {
+  // 像素中心对齐：输出第 i 个样本对应源坐标 (i + 0.5) * src / dst - 0.5，Q8 定点
+  std::vector<Tap> taps(dstSize);
+  for (int i = 0; i < dstSize; i++) {
+    int64_t pos = (2 * i + 1) * int64_t(srcSize) * 256 / (2 * dstSize) - 128;
+    if (nearest)
+      pos = (pos + 128) & ~int64_t(255);
+    if (pos < 0)
+      pos = 0;
+    int i0 = static_cast<int>(pos >> 8);
+    int frac = static_cast<int>(pos & 255);
+    if (i0 >= srcSize - 1) {
+      i0 = srcSize - 1;
+      frac = 0;
+    }
+    taps[i] = {i0, std::min(i0 + 1, srcSize - 1), frac};
+  }
+  return taps;
+}
+
+void FrameConverter::resampleRow(const uint8_t *src, int step,
+                                 const std::vector<Tap> &taps,
+                                 uint8_t *dst) const {
+  if (m_fastScaling) {
+    for (size_t i = 0; i < taps.size(); i++)
+      dst[i] = src[taps[i].i0 * step];
+    return;
+  }
+  for (size_t i = 0; i < taps.size(); i++) {
+    const Tap &t = taps[i];
+    dst[i] = static_cast<uint8_t>(
+        (src[t.i0 * step] * (256 - t.frac) + src[t.i1 * step] * t.frac + 128) >>
+        8);
+  }
+}
+
+const uint8_t *FrameConverter::sourceRow(const uint8_t *plane, int linesize,
+                                         int bytes, const Tap &tap,
+                                         uint8_t *tmp) const {
+  const uint8_t *a = plane + static_cast<ptrdiff_t>(tap.i0) * linesize;
+  if (tap.frac == 0)
+    return a;
+  m_kernels->lerp(a, plane + static_cast<ptrdiff_t>(tap.i1) * linesize, tmp,
+                  bytes, tap.frac);
+  return tmp;
+}
+
+const uint8_t *FrameConverter::boxRow(const uint8_t *plane, int linesize,
+                                      int units, int unit, int row,
+                                      BoxRows *cache) const {
+  for (int k = 0; k < 2; k++) {
+    if (cache->row[k] == row)
+      return cache->ptr[k];
+  }
+  // 行号自上而下递增，换掉较早的一行
+  int k = cache->row[0] <= cache->row[1] ? 0 : 1;
+  uint8_t *out = cache->buf[k];
+  int rows = 1 << m_shiftY;
+  const uint8_t *src =
+      plane + static_cast<ptrdiff_t>(row) * rows * linesize;
+  if (rows > 1) {
+    // 第 i 行按 1/(i+1) 的权重并入，逐行累积出各行的平均
+    m_kernels->lerp(src, src + linesize, out, units * unit, 128);
+    for (int i = 2; i < rows; i++)
+      m_kernels->lerp(out, src + static_cast<ptrdiff_t>(i) * linesize, out,
+                      units * unit, 256 / (i + 1));
+    src = out;
+  }
+  for (int i = 0; i < m_shiftX; i++) {
+    units >>= 1;
+    m_kernels->halve(src, out, units, unit);
+    src = out;
+  }
+  cache->row[k] = row;
+  cache->ptr[k] = src;
+  return src;
+}
+
+const uint8_t *FrameConverter::boxSourceRow(const uint8_t *plane, int linesize,
+                                            int units, int unit, const Tap &tap,
+                                            BoxRows *cache,
+                                            uint8_t *tmp) const {
+  const uint8_t *a = boxRow(plane, linesize, units, unit, tap.i0, cache);
+  if (tap.frac == 0)
+    return a;
+  const uint8_t *b = boxRow(plane, linesize, units, unit, tap.i1, cache);
+  m_kernels->lerp(a, b, tmp, (units >> m_shiftX) * unit, tap.frac);
+  return tmp;
+}
+
+void FrameConverter::convertRows(const AVFrame *frame, uint8_t *dst,
+                                 int stride, int yBegin, int yEnd,
+                                 uint8_t *scratch) const {
+  const bool nv12 = m_srcFormat == AV_PIX_FMT_NV12;
+  const int cw = (m_srcWidth + 1) / 2, dcw = (m_dstWidth + 1) / 2;
+  uint8_t *yTmp = scratch;
+  uint8_t *uTmp = yTmp + m_srcWidth;
+  uint8_t *vTmp = uTmp + 2 * cw;
+  uint8_t *yOut = vTmp + 2 * cw;
+  uint8_t *uOut = yOut + m_dstWidth;
+  uint8_t *vOut = uOut + std::max(cw, dcw);
+  uint8_t dither[16];
+  const bool boxed = m_shiftX || m_shiftY;
+  BoxRows yRows, uRows, vRows;
+  if (boxed) {
+    uint8_t *p = vOut + std::max(cw, dcw);
+    for (BoxRows *rows : {&yRows, &uRows, &vRows}) {
+      int bytes = rows == &yRows ? m_srcWidth : 2 * cw;
+      for (int k = 0; k < 2; k++) {
+        rows->buf[k] = p;
+        rows->row[k] = -1;
+        rows->ptr[k] = nullptr;
+        p += bytes;
+      }
+    }
+  }
+
+  for (int dy = yBegin; dy < yEnd; dy++) {
+    const uint8_t *y, *u, *v;
+    if (!m_scaled) {
+      // 原尺寸：色度取最近的行和列，与 sws 的非缩放 yuv2rgb 路径相同
+      int cy = dy >> 1;
+      y = frame->data[0] + static_cast<ptrdiff_t>(dy) * frame->linesize[0];
+      if (nv12) {
+        deinterleave(frame->data[1] +
+                         static_cast<ptrdiff_t>(cy) * frame->linesize[1],
+                     uOut, vOut, cw);
+        u = uOut;
+        v = vOut;
+      } else {
+        u = frame->data[1] + static_cast<ptrdiff_t>(cy) * frame->linesize[1];
+        v = frame->data[2] + static_cast<ptrdiff_t>(cy) * frame->linesize[2];
+      }
+    } else if (boxed) {
+      resampleRow(boxSourceRow(frame->data[0], frame->linesize[0], m_srcWidth,
+                               1, m_lumaY[dy], &yRows, yTmp),
+                  1, m_lumaX, yOut);
+      if (nv12) {
+        const uint8_t *uv = boxSourceRow(frame->data[1], frame->linesize[1],
+                                         cw, 2, m_chromaY[dy], &uRows, uTmp);
+        resampleRow(uv, 2, m_chromaX, uOut);
+        resampleRow(uv + 1, 2, m_chromaX, vOut);
+      } else {
+        resampleRow(boxSourceRow(frame->data[1], frame->linesize[1], cw, 1,
+                                 m_chromaY[dy], &uRows, uTmp),
+                    1, m_chromaX, uOut);
+        resampleRow(boxSourceRow(frame->data[2], frame->linesize[2], cw, 1,
+                                 m_chromaY[dy], &vRows, vTmp),
+                    1, m_chromaX, vOut);
+      }
+      y = yOut;
+      u = uOut;
+      v = vOut;
+    } else {
+      const uint8_t *ys = sourceRow(frame->data[0], frame->linesize[0],
+                                    m_srcWidth, m_lumaY[dy], yTmp);
+      resampleRow(ys, 1, m_lumaX, yOut);
+      if (nv12) {
+        const uint8_t *uv = sourceRow(frame->data[1], frame->linesize[1],
+                                      2 * cw, m_chromaY[dy], uTmp);
+        resampleRow(uv, 2, m_chromaX, uOut);
+        resampleRow(uv + 1, 2, m_chromaX, vOut);
+      } else {
+        resampleRow(sourceRow(frame->data[1], frame->linesize[1], cw,
+                              m_chromaY[dy], uTmp),
+                    1, m_chromaX, uOut);
+        resampleRow(sourceRow(frame->data[2], frame->linesize[2], cw,
+                              m_chromaY[dy], vTmp),
+                    1, m_chromaX, vOut);
+      }
+      y = yOut;
+      u = uOut;
+      v = vOut;
+    }
+
+    const uint8_t *d = nullptr;
+    if (m_dither) {
+      for (int i = 0; i < 16; i++)
+        dither[i] = BAYER_4X4[dy & 3][i & 3] >> 1;
+      d = dither;
+    }
+    m_row(y, u, v, dst + static_cast<ptrdiff_t>(dy) * stride, m_dstWidth, d);
+  }
+}
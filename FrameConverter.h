@@ -0,0 +1,123 @@
+#pragma once
+#include "ConvertKernels.h"
+#include "WorkerPool.h"
+#include <QImage>
+#include <QSize>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+struct SwsContext;
+
+// 解码帧到显示格式的转换（含缩放）
+// 常见的 yuv420p/nv12 → RGB32/RGB16 走 SIMD 快速路径：逐行做垂直插值、
+// 水平双线性重采样和颜色转换，结果与 swscale 的 BT.601 有限范围转换一致
+// （误差在取整范围内）；缩小超过一半时先按 2^n 做 box 预缩小，再双线性缩放
+// 到目标尺寸，避免混叠。其余组合回退到 swscale，缩小超过一半时按 2^n
+// 隔行取样后再交给 swscale，不读取全部源行
+// 快速路径的输出行彼此独立，按水平条带分给常驻工作线程并行转换
+class FrameConverter {
+public:
+  FrameConverter();
+  ~FrameConverter();
+  FrameConverter(const FrameConverter &) = delete;
+  FrameConverter &operator=(const FrameConverter &) = delete;
+
+  static AVPixelFormat avFormatFor(QImage::Format format);
+  // 创建转换到 format 的缩放上下文，dither 时使用 bayer 有序抖动
+  // fast 时用最近邻缩放
+  static SwsContext *createScaler(int srcWidth, int srcHeight,
+                                  AVPixelFormat srcFormat, int dstWidth,
+                                  int dstHeight, QImage::Format format,
+                                  bool dither, bool fast = false);
+
+  // 按源和目标参数选择转换路径，失败时返回 false；
+  // isa 指定快速路径的指令集，指定的指令集不可用时回退到 swscale
+  bool configure(int srcWidth, int srcHeight, AVPixelFormat srcFormat,
+                 int dstWidth, int dstHeight, QImage::Format format,
+                 bool dither, ConvertKernels::Isa isa = ConvertKernels::Auto);
+  void reset();
+  bool isValid() const;
+  bool isFastPath() const;
+  // 当前路径的名称："c"、"sse2"、"avx2"、"neon" 或 "swscale"
+  const char *pathName() const;
+
+  // 缩放改用最近邻（解码降级时减少转换开销），下次 configure 生效
+  void setFastScaling(bool fast);
+  bool fastScaling() const;
+
+  // 缩小超过一半时先按 2^n 预缩小（默认开启），下次 configure 生效；
+  // 关闭时快速路径只处理不超过一半的缩小，swscale 读取全部源行
+  void setPreDecimation(bool enabled);
+  bool preDecimation() const;
+  // 预缩小后交给缩放的源尺寸（未预缩小时为源尺寸）
+  QSize decimatedSize() const;
+
+  // 快速路径（含 box 预缩小）的并行线程数（含调用线程），默认 1；
+  // swscale 回退路径（全范围、10 位等格式）始终单线程
+  void setThreadCount(int threads);
+  int threadCount() const;
+
+  // 整帧转换到 dst（行宽 stride 字节），帧尺寸和格式须与 configure 一致
+  void convert(const AVFrame *frame, uint8_t *dst, int stride);
+
+private:
+  // 采样位置：在 i0、i1 之间按 frac/256 插值
+  struct Tap {
+    int i0, i1, frac;
+  };
+  // nearest 时每个位置只取最近的一个样本（frac 为 0）
+  static std::vector<Tap> makeTaps(int srcSize, int dstSize, bool nearest);
+  // 水平重采样，step 为源样本间距（nv12 交织色度为 2）
+  void resampleRow(const uint8_t *src, int step, const std::vector<Tap> &taps,
+                   uint8_t *dst) const;
+
+  // 逐行处理 [yBegin, yEnd) 的输出行，scratch 为本条带独占的中间缓冲
+  void convertRows(const AVFrame *frame, uint8_t *dst, int stride, int yBegin,
+                   int yEnd, uint8_t *scratch) const;
+  // 取得输出行对应的源平面行（需要时垂直插值到 tmp）
+  const uint8_t *sourceRow(const uint8_t *plane, int linesize, int bytes,
+                           const Tap &tap, uint8_t *tmp) const;
+
+  // 预缩小后某个平面最近算出的两行：条带内输出行自上而下处理，相邻输出行
+  // 大多用到同样的行
+  struct BoxRows {
+    uint8_t *buf[2];
+    int row[2];
+    const uint8_t *ptr[2];
+  };
+  // 预缩小后平面的第 row 行：2^m_shiftY 行源数据取平均，再水平减半
+  // m_shiftX 次；units 为源行的样本数，unit 为样本字节数
+  const uint8_t *boxRow(const uint8_t *plane, int linesize, int units,
+                        int unit, int row, BoxRows *cache) const;
+  // 预缩小时的 sourceRow：在预缩小后的两行之间垂直插值
+  const uint8_t *boxSourceRow(const uint8_t *plane, int linesize, int units,
+                              int unit, const Tap &tap, BoxRows *cache,
+                              uint8_t *tmp) const;
+
+  int m_srcWidth = 0, m_srcHeight = 0;
+  int m_dstWidth = 0, m_dstHeight = 0;
+  AVPixelFormat m_srcFormat = AV_PIX_FMT_NONE;
+  QImage::Format m_format = QImage::Format_Invalid;
+  bool m_dither = false;
+  bool m_fastScaling = false;
+  bool m_preDecimation = true;
+
+  SwsContext *m_sws = nullptr;
+  const ConvertKernels::Kernels *m_kernels = nullptr;
+  ConvertKernels::RowFn m_row = nullptr;
+
+  // 快速路径：水平/垂直采样表和每个条带的逐行中间缓冲
+  bool m_scaled = false;
+  // 预缩小的级数（各缩小 2^n）；swscale 路径只有垂直方向（隔行取样）
+  int m_shiftX = 0, m_shiftY = 0;
+  std::vector<Tap> m_lumaX, m_lumaY, m_chromaX, m_chromaY;
+  size_t m_scratchBytes = 0;
+  std::vector<std::vector<uint8_t>> m_scratch;
+
+  std::unique_ptr<WorkerPool> m_pool;
+};
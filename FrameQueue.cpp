@@ -0,0 +1,88 @@
+#include "FrameQueue.h"
+#include <algorithm>
+#include <chrono>
+
+FrameQueue::FrameQueue(size_t maxFrames) : m_maxFrames(maxFrames) {}
+
+FrameQueue::~FrameQueue() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+}
+
+void FrameQueue::setCapacity(size_t maxFrames) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_maxFrames = std::max<size_t>(1, maxFrames);
+  m_cond.notify_all();
+}
+
+bool FrameQueue::put(AVFrame *frame, int serial, int64_t ms) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  uint64_t generation = m_generation;
+  m_cond.wait(lk, [&] {
+    return m_abort || generation != m_generation ||
+           m_entries.size() < m_maxFrames;
+  });
+  if (m_abort || generation != m_generation) {
+    av_frame_unref(frame);
+    return false;
+  }
+  AVFrame *copy = av_frame_alloc();
+  if (!copy) {
+    av_frame_unref(frame);
+    return false;
+  }
+  av_frame_move_ref(copy, frame);
+  m_entries.push_back({copy, serial, ms});
+  m_cond.notify_all();
+  return true;
+}
+
+int FrameQueue::get(AVFrame *frame, int *serial, int64_t *ms, int timeoutMs) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (!m_cond.wait_for(lk, std::chrono::milliseconds(timeoutMs),
+                       [&] { return m_abort || !m_entries.empty(); }))
+    return 0;
+  if (m_abort)
+    return -1;
+  Entry e = m_entries.front();
+  m_entries.pop_front();
+  av_frame_move_ref(frame, e.frame);
+  av_frame_free(&e.frame);
+  if (serial)
+    *serial = e.serial;
+  if (ms)
+    *ms = e.ms;
+  m_cond.notify_all();
+  return 1;
+}
+
+void FrameQueue::flush() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+  m_generation++;
+  m_cond.notify_all();
+}
+
+void FrameQueue::abort() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_abort = true;
+  m_cond.notify_all();
+}
+
+void FrameQueue::start() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+  m_abort = false;
+  m_generation++;
+}
+
+size_t FrameQueue::count() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_entries.size();
+}
+
+void FrameQueue::clearLocked() {
+  for (Entry &e : m_entries)
+    av_frame_free(&e.frame);
+  m_entries.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// 线程安全的有界解码帧队列（保持解码器输出的原始格式，如 YUV）
+// 由视频解码线程写入、显示线程读取；帧带有来源 packet 的 serial，
+// 显示线程据此丢弃 seek 之前的旧帧
+class FrameQueue {
+public:
+  explicit FrameQueue(size_t maxFrames = 6);
+  ~FrameQueue();
+
+  void setCapacity(size_t maxFrames);
+
+  // 放入帧（转移引用），队列满时阻塞；flush 或中止后丢弃该帧并返回 false
+  bool put(AVFrame *frame, int serial, int64_t ms);
+  // 取出帧：成功返回 1，超时返回 0，中止返回 -1
+  int get(AVFrame *frame, int *serial, int64_t *ms, int timeoutMs);
+
+  // 清空队列，并让阻塞在 put 中的写入方放弃当前帧
+  void flush();
+  void abort();
+  void start();
+
+  size_t count() const;
+
+private:
+  struct Entry {
+    AVFrame *frame;
+    int serial;
+    int64_t ms;
+  };
+
+  void clearLocked();
+
+  std::deque<Entry> m_entries;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  size_t m_maxFrames;
+  uint64_t m_generation = 0; // flush 计数
+  bool m_abort = true;
+};
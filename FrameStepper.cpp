@@ -0,0 +1,201 @@
+#include "FrameStepper.h"
+#include "GopDecoder.h"
+#include <QtDebug>
+
+// 缓存帧的尺寸上限：步进和倒放时画面由 paintEvent 放大到窗口，
+// 用 RGB16 保存，同样的预算能多放一倍的帧
+static const int MAX_FRAME_WIDTH = 960;
+static const int MAX_FRAME_HEIGHT = 540;
+static const QImage::Format CACHE_FORMAT = QImage::Format_RGB16;
+
+FrameStepper::FrameStepper(QObject *parent) : QObject(parent) {
+  m_thread = std::thread(&FrameStepper::workerLoop, this);
+}
+
+FrameStepper::~FrameStepper() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void FrameStepper::setSource(const QString &path) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_path = path;
+    m_request = Request();
+    m_prefetch = -1;
+    m_lastMs = -1;
+    m_pollMissed = false;
+    m_seq++;
+    m_sourceGeneration++;
+    // 与工作线程的插入在同一把锁内，旧文件的 GOP 不会在清空之后放进来
+    m_cache.clear();
+  }
+}
+
+void FrameStepper::setOutputSize(const QSize &size) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_size = size.boundedTo(QSize(MAX_FRAME_WIDTH, MAX_FRAME_HEIGHT));
+}
+
+bool FrameStepper::frameAt(qint64 ms, QImage *out, qint64 *frameMs) {
+  return lookup(std::max<qint64>(0, ms), 0, out, frameMs);
+}
+
+bool FrameStepper::step(qint64 fromMs, int direction, QImage *out,
+                        qint64 *frameMs) {
+  return lookup(std::max<qint64>(0, fromMs), direction > 0 ? 1 : -1, out,
+                frameMs);
+}
+
+void FrameStepper::cancel() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_request = Request();
+  m_prefetch = -1;
+  m_lastMs = -1;
+  m_pollMissed = false;
+  m_seq++;
+}
+
+GopCache::Stats FrameStepper::cacheStats() const { return m_cache.stats(); }
+
+bool FrameStepper::lookup(qint64 ms, int direction, QImage *out,
+                          qint64 *frameMs) {
+  GopCache::Frame frame;
+  qint64 need = -1;
+  // 倒放按时钟反复取帧，同一帧会被取很多次：只有取到的帧变化时才计一次命中，
+  // 连续未命中只计一次
+  bool poll = direction == 0;
+  bool hit = m_cache.find(ms, direction, &frame, &need, !poll);
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_path.isEmpty())
+      return false;
+    if (poll && (hit ? frame.ms != m_lastMs : !m_pollMissed))
+      m_cache.recordLookup(hit);
+    m_pollMissed = poll && !hit;
+    // 新请求取代尚未处理的请求
+    m_request = Request();
+    m_seq++;
+    if (hit) {
+      // 倒放没有方向参数，按相邻两次取帧的先后判断
+      int motion = direction != 0 ? direction
+                                  : (m_lastMs >= 0 && frame.ms < m_lastMs ? -1
+                                                                          : 1);
+      m_lastMs = frame.ms;
+      m_prefetch = m_cache.neighbour(frame.ms, motion);
+    } else if (need >= 0) {
+      m_request.ms = ms;
+      m_request.direction = direction;
+      m_request.needMs = need;
+      m_request.seq = m_seq;
+    }
+  }
+  m_cond.notify_all();
+  if (!hit)
+    return false;
+  *out = frame.image;
+  *frameMs = frame.ms;
+  return true;
+}
+
+void FrameStepper::workerLoop() {
+  GopDecoder decoder;
+  QString opened;
+  int gops = 0;
+  qint64 total_us = 0;
+
+  while (true) {
+    Request req;
+    qint64 target;
+    QString path;
+    QSize size;
+    int generation;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] {
+        return m_stop || m_request.ms >= 0 || m_prefetch >= 0;
+      });
+      if (m_stop)
+        break;
+      // 等待中的请求优先于预取
+      if (m_request.ms >= 0) {
+        req = m_request;
+        m_request = Request();
+        target = req.needMs;
+      } else {
+        target = m_prefetch;
+        m_prefetch = -1;
+      }
+      path = m_path;
+      size = m_size;
+      generation = m_sourceGeneration;
+    }
+
+    // 打开失败（如纯音频文件）时同一文件不再重试
+    if (path != opened) {
+      opened = path;
+      if (!decoder.open(path, size, CACHE_FORMAT))
+        qDebug() << "Frame stepping unavailable for" << path;
+    }
+    if (!decoder.isOpen())
+      continue;
+    decoder.setOutput(size, CACHE_FORMAT);
+
+    if (!m_cache.contains(target)) {
+      // 留一半预算给相邻的 GOP，倒放时当前 GOP 和预取的 GOP 同时在缓存中
+      std::shared_ptr<GopCache::Gop> gop =
+          decoder.decodeGop(target, m_cache.budget() / 2);
+      if (!gop)
+        continue;
+      {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        // 解码期间切换了文件：这是旧文件的画面，丢弃
+        if (generation != m_sourceGeneration)
+          continue;
+        m_cache.insert(gop);
+      }
+      gops++;
+      total_us += decoder.lastDecodeUs();
+      GopCache::Stats stats = m_cache.stats();
+      qDebug() << "GOP" << gop->startMs << "ms:" << gop->frames.size()
+               << "frames" << gop->frames.front().image.size() << "in"
+               << decoder.lastDecodeUs() / 1000 << "ms, cache"
+               << stats.bytes / 1024 << "/" << stats.budget / 1024 << "KB";
+    }
+    if (req.ms < 0)
+      continue;
+
+    GopCache::Frame frame;
+    qint64 need;
+    if (!m_cache.find(req.ms, req.direction, &frame, &need, false))
+      continue;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      // 解码期间已有新的请求（或已退出步进），这一帧不再需要
+      if (req.seq != m_seq)
+        continue;
+      int motion = req.direction != 0
+                       ? req.direction
+                       : (m_lastMs >= 0 && frame.ms < m_lastMs ? -1 : 1);
+      m_lastMs = frame.ms;
+      if (m_prefetch < 0)
+        m_prefetch = m_cache.neighbour(frame.ms, motion);
+    }
+    emit frameReady(QSharedPointer<QImage>(new QImage(frame.image)), frame.ms);
+  }
+
+  if (gops > 0) {
+    GopCache::Stats stats = m_cache.stats();
+    qint64 lookups = stats.hits + stats.misses;
+    qDebug() << "Frame stepper:" << gops << "GOPs decoded, avg"
+             << total_us / gops / 1000.0 << "ms; cache hit rate"
+             << (lookups > 0 ? 100.0 * stats.hits / lookups : 0.0) << "% of"
+             << lookups << "lookups," << stats.gops << "GOPs"
+             << stats.frames << "frames" << stats.bytes / 1024 << "KB";
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "GopCache.h"
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 暂停时的逐帧步进和倒放：后台线程用独立的 GopDecoder 把整个 GOP 解码进
+// GopCache，界面线程直接在缓存里按显示时间取帧。命中时立即返回；未命中时
+// 记下请求（只保留最新一个），GOP 解码完成后通过 frameReady 送出。
+// 每次取帧后预取运动方向上相邻的 GOP，连续步进和倒放跨 GOP 时不必等解码
+class FrameStepper : public QObject {
+  Q_OBJECT
+public:
+  explicit FrameStepper(QObject *parent = nullptr);
+  ~FrameStepper();
+
+  // 切换文件并清空缓存，为空时不可用；输入在第一次请求时才打开
+  void setSource(const QString &path);
+  // 缓存帧的最大尺寸（有上限），之后解码的 GOP 生效
+  void setOutputSize(const QSize &size);
+
+  // ms 处正在显示的帧（倒放按时钟调用）
+  bool frameAt(qint64 ms, QImage *out, qint64 *frameMs);
+  // fromMs 处那一帧的后一帧（direction > 0）或前一帧（direction < 0）
+  // 已到文件头/尾时返回 false，也不会再送出 frameReady
+  bool step(qint64 fromMs, int direction, QImage *out, qint64 *frameMs);
+  // 退出步进，丢弃尚未处理的请求和预取
+  void cancel();
+
+  GopCache::Stats cacheStats() const;
+
+signals:
+  // 未命中的请求在 GOP 解码完成后送出，ms 为该帧的显示时间
+  void frameReady(const QSharedPointer<QImage> &img, qint64 ms);
+
+private:
+  bool lookup(qint64 ms, int direction, QImage *out, qint64 *frameMs);
+  void workerLoop();
+
+  GopCache m_cache;
+  std::thread m_thread;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_stop = false;
+  QString m_path;
+  QSize m_size;
+  // 待处理的请求：在 ms 处按 direction 取帧，需要先解码 needMs 所在的 GOP
+  struct Request {
+    qint64 ms = -1; // -1 表示没有
+    int direction = 0;
+    qint64 needMs = -1;
+    qint64 seq = 0;
+  };
+  Request m_request;
+  qint64 m_seq = 0;
+  int m_sourceGeneration = 0; // setSource 递增，解码完成时据此丢弃旧文件的 GOP
+  qint64 m_prefetch = -1; // 待预取的 GOP 内的时间，-1 表示没有
+  qint64 m_lastMs = -1;   // 上次取到的帧，用于判断倒放时的运动方向
+  bool m_pollMissed = false; // 倒放轮询未命中，等到命中前不再重复计入
+};
@@ -0,0 +1,139 @@
+#include "GopCache.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+// 时间不晚于 ms 的最后一帧的下标，ms 早于第一帧时返回 -1
+int frameIndexAt(const GopCache::Gop &gop, qint64 ms) {
+  auto it = std::upper_bound(
+      gop.frames.begin(), gop.frames.end(), ms,
+      [](qint64 t, const GopCache::Frame &f) { return t < f.ms; });
+  return static_cast<int>(it - gop.frames.begin()) - 1;
+}
+
+bool isLastGop(const GopCache::Gop &gop) {
+  return gop.endMs == std::numeric_limits<qint64>::max();
+}
+} // namespace
+
+GopCache::GopCache(size_t budget) : m_budget(budget) {}
+
+std::shared_ptr<const GopCache::Gop> GopCache::lookupLocked(qint64 ms) {
+  for (auto it = m_gops.begin(); it != m_gops.end(); ++it) {
+    if (ms >= (*it)->startMs && ms < (*it)->endMs) {
+      if (it != m_gops.begin())
+        m_gops.splice(m_gops.begin(), m_gops, it);
+      return m_gops.front();
+    }
+  }
+  return nullptr;
+}
+
+bool GopCache::find(qint64 ms, int direction, Frame *out, qint64 *needMs,
+                    bool record) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  *needMs = -1;
+  std::shared_ptr<const Gop> gop = lookupLocked(ms);
+  if (!gop) {
+    *needMs = ms;
+    m_misses += record;
+    return false;
+  }
+  int i = frameIndexAt(*gop, ms);
+  int count = static_cast<int>(gop->frames.size());
+  if (direction == 0) {
+    *out = gop->frames[std::max(i, 0)];
+    m_hits += record;
+    return true;
+  }
+  int target = i + (direction > 0 ? 1 : -1);
+  if (target >= 0 && target < count) {
+    *out = gop->frames[target];
+    m_hits += record;
+    return true;
+  }
+
+  // 跨到相邻的 GOP：后一帧是下一个 GOP 的第一帧，前一帧是上一个 GOP 的最后一帧
+  if (direction > 0 ? isLastGop(*gop) : gop->startMs <= 0)
+    return false;
+  qint64 adjacent = direction > 0 ? gop->endMs : gop->startMs - 1;
+  std::shared_ptr<const Gop> next = lookupLocked(adjacent);
+  if (!next) {
+    *needMs = adjacent;
+    m_misses += record;
+    return false;
+  }
+  *out = direction > 0 ? next->frames.front() : next->frames.back();
+  m_hits += record;
+  return true;
+}
+
+void GopCache::recordLookup(bool hit) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (hit)
+    m_hits++;
+  else
+    m_misses++;
+}
+
+bool GopCache::contains(qint64 ms) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (const auto &gop : m_gops)
+    if (ms >= gop->startMs && ms < gop->endMs)
+      return true;
+  return false;
+}
+
+qint64 GopCache::neighbour(qint64 ms, int direction) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (const auto &gop : m_gops) {
+    if (ms < gop->startMs || ms >= gop->endMs)
+      continue;
+    if (direction > 0)
+      return isLastGop(*gop) ? -1 : gop->endMs;
+    return gop->startMs > 0 ? gop->startMs - 1 : -1;
+  }
+  return -1;
+}
+
+void GopCache::insert(const std::shared_ptr<const Gop> &gop) {
+  if (!gop || gop->frames.empty())
+    return;
+  std::lock_guard<std::mutex> lk(m_mutex);
+  // 与新 GOP 重叠的旧条目（如输出尺寸变化后重新解码）直接替换
+  for (auto it = m_gops.begin(); it != m_gops.end();) {
+    if ((*it)->startMs < gop->endMs && gop->startMs < (*it)->endMs) {
+      m_bytes -= (*it)->bytes;
+      it = m_gops.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  m_gops.push_front(gop);
+  m_bytes += gop->bytes;
+  while (m_bytes > m_budget && m_gops.size() > 1) {
+    m_bytes -= m_gops.back()->bytes;
+    m_gops.pop_back();
+  }
+}
+
+void GopCache::clear() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_gops.clear();
+  m_bytes = 0;
+}
+
+size_t GopCache::budget() const { return m_budget; }
+
+GopCache::Stats GopCache::stats() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  Stats s;
+  s.bytes = m_bytes;
+  s.budget = m_budget;
+  s.gops = static_cast<int>(m_gops.size());
+  for (const auto &gop : m_gops)
+    s.frames += static_cast<int>(gop->frames.size());
+  s.hits = m_hits;
+  s.misses = m_misses;
+  return s;
+}
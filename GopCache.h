@@ -0,0 +1,65 @@
+#pragma once
+#include <QImage>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 解码后的 GOP 缓存：每个 GOP 的帧按显示顺序缩小后保存，总内存不超过预算，
+// 超出时按最近最少使用淘汰整个 GOP。逐帧步进和倒放都在缓存里按显示时间查找，
+// 命中时不读文件也不解码。线程安全
+class GopCache {
+public:
+  struct Frame {
+    qint64 ms = 0;
+    QImage image;
+  };
+  // 覆盖 [startMs, endMs) 的一个 GOP；frames 按 ms 升序
+  struct Gop {
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+    std::vector<Frame> frames;
+    size_t bytes = 0;
+  };
+  struct Stats {
+    size_t bytes = 0;
+    size_t budget = 0;
+    int gops = 0;
+    int frames = 0;
+    qint64 hits = 0;   // 查找时所需的 GOP 已在缓存中
+    qint64 misses = 0; // 需要先解码 GOP
+  };
+
+  explicit GopCache(size_t budget = 64 * 1024 * 1024);
+
+  // direction 为 0 时查找 ms 处正在显示的帧（时间不晚于 ms 的最后一帧），
+  // 为 ±1 时查找 ms 处那一帧的后一帧/前一帧。命中时返回 true；
+  // 未命中时 needMs 为需要先解码的 GOP 内的时间，已到文件头/尾时为 -1
+  // record 为 false 时不计入命中率（解码完成后重新解析同一个请求）
+  bool find(qint64 ms, int direction, Frame *out, qint64 *needMs,
+            bool record = true);
+  // 把一次 record 为 false 的查找补记进命中率（调用方自行判断是否算新的查找）
+  void recordLookup(bool hit);
+  bool contains(qint64 ms) const;
+  // ms 所在 GOP 在 direction 方向上相邻的 GOP 内的时间，供预取；
+  // ms 所在 GOP 未缓存或已到头时返回 -1
+  qint64 neighbour(qint64 ms, int direction) const;
+
+  // 放入新解码的 GOP，必要时淘汰其他 GOP（新放入的不淘汰）
+  void insert(const std::shared_ptr<const Gop> &gop);
+  void clear();
+  size_t budget() const;
+  Stats stats() const;
+
+private:
+  typedef std::list<std::shared_ptr<const Gop>> GopList;
+  // 返回覆盖 ms 的 GOP，并移到最近使用的位置；调用方持有 m_mutex
+  std::shared_ptr<const Gop> lookupLocked(qint64 ms);
+
+  mutable std::mutex m_mutex;
+  GopList m_gops; // 最近使用的在前
+  size_t m_budget;
+  size_t m_bytes = 0;
+  qint64 m_hits = 0;
+  qint64 m_misses = 0;
+};
@@ -0,0 +1,165 @@
+#include "GopDecoder.h"
+#include "FFMpegDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// 只有极少关键帧的码流：一次最多读这么多个 packet，超出部分留给下一次
+static const int MAX_GOP_PACKETS = 1000;
+// 为了不超出内存预算缩小帧尺寸时的最小宽度
+static const int MIN_FRAME_WIDTH = 64;
+
+namespace {
+int64_t packetTime(const AVPacket *pkt) {
+  return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+size_t imageBytes(const QImage &img) {
+  return static_cast<size_t>(img.bytesPerLine()) * img.height();
+}
+} // namespace
+
+GopDecoder::GopDecoder() {}
+
+bool GopDecoder::open(const QString &path, const QSize &box,
+                      QImage::Format format) {
+  return openInput(path, box, format);
+}
+
+void GopDecoder::setupCodec(AVCodecContext *codec) {
+  // 一次解完整个 GOP，看重吞吐：按默认配置启用帧级和片级多线程
+  FFMpegDecoder::applyThreading(codec, DecoderThreading());
+}
+
+std::shared_ptr<GopCache::Gop> GopDecoder::decodeGop(qint64 ms,
+                                                     size_t maxBytes) {
+  if (!m_codec)
+    return nullptr;
+  auto begin = std::chrono::steady_clock::now();
+  AVStream *st = m_fmt->streams[m_stream];
+  if (!seekTo(ms))
+    return nullptr;
+  avcodec_flush_buffers(m_codec);
+
+  auto gop = std::make_shared<GopCache::Gop>();
+  QSize box = m_box;
+  int64_t start_pts = AV_NOPTS_VALUE, end_pts = AV_NOPTS_VALUE;
+  int packets = 0;
+  bool full = false, truncated = false;
+
+  auto receive = [&]() {
+    while (!full && avcodec_receive_frame(m_codec, m_frame) == 0) {
+      int64_t pts = frameTimestamp();
+      // 开放 GOP 开头引用上一个 GOP 的 B 帧不完整，属于上一个 GOP；
+      // 下一个关键帧起的帧属于下一个 GOP
+      bool inside = pts != AV_NOPTS_VALUE && pts >= start_pts &&
+                    (end_pts == AV_NOPTS_VALUE || pts < end_pts);
+      if (inside && !addFrame(gop.get(), &box, maxBytes))
+        full = true;
+      av_frame_unref(m_frame);
+    }
+  };
+
+  // 起始关键帧必须带时间戳，才能判断解出的帧属于哪个 GOP
+  while (start_pts == AV_NOPTS_VALUE && readKeyframe()) {
+    start_pts = packetTime(m_pkt);
+    if (start_pts == AV_NOPTS_VALUE)
+      av_packet_unref(m_pkt);
+  }
+  if (start_pts == AV_NOPTS_VALUE)
+    return nullptr;
+  avcodec_send_packet(m_codec, m_pkt);
+  av_packet_unref(m_pkt);
+  receive();
+
+  while (!full && av_read_frame(m_fmt, m_pkt) >= 0) {
+    if (m_pkt->stream_index != m_stream) {
+      av_packet_unref(m_pkt);
+      continue;
+    }
+    int64_t t = packetTime(m_pkt);
+    bool key = (m_pkt->flags & AV_PKT_FLAG_KEY) && t != AV_NOPTS_VALUE;
+    if (end_pts == AV_NOPTS_VALUE) {
+      // 下一个关键帧也送入解码器：开放 GOP 里紧随其后、显示在它之前的
+      // B 帧要参考它才能解出来
+      if (key && t > start_pts)
+        end_pts = t;
+      else if (++packets >= MAX_GOP_PACKETS) {
+        av_packet_unref(m_pkt);
+        truncated = true;
+        break;
+      }
+    } else if (m_pkt->pts == AV_NOPTS_VALUE || m_pkt->pts >= end_pts) {
+      av_packet_unref(m_pkt);
+      break;
+    }
+    avcodec_send_packet(m_codec, m_pkt);
+    av_packet_unref(m_pkt);
+    receive();
+  }
+  if (!full) {
+    avcodec_send_packet(m_codec, nullptr);
+    receive();
+  }
+  avcodec_flush_buffers(m_codec);
+  if (gop->frames.empty())
+    return nullptr;
+
+  std::sort(gop->frames.begin(), gop->frames.end(),
+            [](const GopCache::Frame &a, const GopCache::Frame &b) {
+              return a.ms < b.ms;
+            });
+  auto last = std::unique(gop->frames.begin(), gop->frames.end(),
+                          [](const GopCache::Frame &a,
+                             const GopCache::Frame &b) { return a.ms == b.ms; });
+  gop->frames.erase(last, gop->frames.end());
+  gop->bytes = 0;
+  for (const GopCache::Frame &f : gop->frames)
+    gop->bytes += imageBytes(f.image);
+
+  // 没读到下一个关键帧时：文件结束则延伸到无穷，被截断则止于最后一帧之后
+  gop->startMs =
+      std::min<qint64>(av_rescale_q(start_pts, st->time_base, {1, 1000}), ms);
+  if (end_pts != AV_NOPTS_VALUE && !full)
+    gop->endMs = av_rescale_q(end_pts, st->time_base, {1, 1000});
+  else if (full || truncated)
+    gop->endMs = gop->frames.back().ms + 1;
+  else
+    gop->endMs = std::numeric_limits<qint64>::max();
+  gop->endMs = std::max(gop->endMs, ms + 1);
+
+  m_lastDecodeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  return gop;
+}
+
+bool GopDecoder::addFrame(GopCache::Gop *gop, QSize *box, size_t maxBytes) {
+  GopCache::Frame f;
+  f.ms = av_rescale_q(frameTimestamp(), m_fmt->streams[m_stream]->time_base,
+                      {1, 1000});
+  if (!convertFrame(*box, &f.image))
+    return false;
+  gop->bytes += imageBytes(f.image);
+  gop->frames.push_back(f);
+
+  // 超出预算：已解出的帧缩小一半，之后的帧按缩小后的尺寸输出
+  while (gop->bytes > maxBytes) {
+    if (box->isEmpty())
+      *box = f.image.size();
+    if (box->width() / 2 < MIN_FRAME_WIDTH) {
+      gop->bytes -= imageBytes(gop->frames.back().image);
+      gop->frames.pop_back();
+      return false;
+    }
+    *box = QSize(box->width() / 2, box->height() / 2);
+    gop->bytes = 0;
+    for (GopCache::Frame &old : gop->frames) {
+      old.image = old.image.scaled(old.image.size().scaled(*box,
+                                                           Qt::KeepAspectRatio)
+                                       .expandedTo(QSize(1, 1)));
+      gop->bytes += imageBytes(old.image);
+    }
+  }
+  return true;
+}
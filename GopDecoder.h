@@ -0,0 +1,25 @@
+#pragma once
+#include "GopCache.h"
+#include "SideDecoder.h"
+#include <memory>
+
+// 整 GOP 解码器：定位到指定时间之前最近的关键帧，解出到下一个
+// 关键帧为止的所有帧，按显示顺序缩小后交给 GopCache。供逐帧步进和倒放使用，
+// 与播放线程互不影响；不是线程安全的
+class GopDecoder : public SideDecoder {
+public:
+  GopDecoder();
+
+  bool open(const QString &path, const QSize &box,
+            QImage::Format format = QImage::Format_RGB16);
+
+  // 解出包含 ms 的 GOP，返回的区间保证覆盖 ms；失败时返回空指针
+  // 帧的总大小超过 maxBytes 时逐级减半帧尺寸，单个长 GOP 也不会撑爆缓存
+  std::shared_ptr<GopCache::Gop> decodeGop(qint64 ms, size_t maxBytes);
+
+protected:
+  void setupCodec(AVCodecContext *codec) override;
+
+private:
+  bool addFrame(GopCache::Gop *gop, QSize *box, size_t maxBytes);
+};
@@ -0,0 +1,303 @@
+#include "HttpSource.h"
+#include "MediaCache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtDebug>
+#include <algorithm>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 缓存与请求的粒度：块太小请求开销大，太大则跳转后首包等待变长
+static const int64_t HTTP_CHUNK_SIZE = 256 * 1024;
+// 每下载这么多块保存一次位图，异常退出时最多丢失这部分缓存
+static const int MAP_SAVE_INTERVAL = 16;
+static const quint32 HTTP_CACHE_MAGIC = 0x48545450; // "HTTP"
+static const quint32 HTTP_CACHE_VERSION = 1;
+
+namespace {
+QString mapPathFor(const QFileInfo &data) {
+  return data.absolutePath() + "/" + data.completeBaseName() + ".map";
+}
+
+// 条目实际下载的字节数：数据文件按远端长度预分配（稀疏文件），只有位图里
+// 标记的块才占用空间；位图无效时条目不可用，按 0 计
+qint64 cachedBytes(const QString &mapPath) {
+  QFile f(mapPath);
+  if (!f.open(QIODevice::ReadOnly))
+    return 0;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0, version = 0;
+  QString url;
+  qint64 size = 0, chunkSize = 0;
+  QByteArray bits;
+  in >> magic >> version >> url >> size >> chunkSize >> bits;
+  if (in.status() != QDataStream::Ok || magic != HTTP_CACHE_MAGIC ||
+      version != HTTP_CACHE_VERSION || chunkSize <= 0)
+    return 0;
+  qint64 chunks = std::count_if(bits.begin(), bits.end(),
+                                [](char b) { return b != 0; });
+  return std::min(size, chunks * chunkSize);
+}
+
+// 缓存总量超过上限时按最近使用时间删除最旧的条目（保留 keep）
+// 数据文件的修改时间即最近使用时间：每次打开都会刷新，只读缓存的条目也不会先被删
+void trimCache(const QString &dir, qint64 limit, const QString &keep) {
+  QFileInfoList files = QDir(dir).entryInfoList(
+      QStringList() << "*.data", QDir::Files, QDir::Time | QDir::Reversed);
+  std::vector<qint64> sizes;
+  qint64 total = 0;
+  for (const QFileInfo &info : files) {
+    sizes.push_back(cachedBytes(mapPathFor(info)));
+    total += sizes.back();
+  }
+  for (int i = 0; i < files.size(); i++) {
+    if (total <= limit)
+      break;
+    const QFileInfo &info = files.at(i);
+    if (info.absoluteFilePath() == keep)
+      continue;
+    total -= sizes[i];
+    QFile::remove(info.absoluteFilePath());
+    QFile::remove(mapPathFor(info));
+  }
+}
+} // namespace
+
+HttpSource::HttpSource(const QString &url, size_t prefetchBytes,
+                       qint64 cacheLimit)
+    : m_url(url), m_prefetchBytes(prefetchBytes), m_cacheLimit(cacheLimit) {}
+
+HttpSource::~HttpSource() {
+  m_abort = true;
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  if (m_conn)
+    avio_closep(&m_conn);
+  if (m_data.isOpen())
+    saveMap();
+  avformat_network_deinit();
+}
+
+bool HttpSource::isHttpUrl(const QString &path) {
+  return path.startsWith("http://", Qt::CaseInsensitive) ||
+         path.startsWith("https://", Qt::CaseInsensitive);
+}
+
+int HttpSource::interruptCallback(void *opaque) {
+  return static_cast<HttpSource *>(opaque)->m_abort.load() ? 1 : 0;
+}
+
+bool HttpSource::open() {
+  avformat_network_init();
+  AVIOInterruptCB cb = {&HttpSource::interruptCallback, this};
+  int ret = avio_open2(&m_conn, m_url.toUtf8().constData(), AVIO_FLAG_READ, &cb,
+                       nullptr);
+  if (ret < 0) {
+    qWarning() << "Failed to open" << m_url;
+    return false;
+  }
+  m_size = avio_size(m_conn);
+  if (m_size <= 0 || !(m_conn->seekable & AVIO_SEEKABLE_NORMAL)) {
+    qWarning() << "Server does not support range requests for" << m_url;
+    return false;
+  }
+
+  QByteArray hash =
+      QCryptographicHash::hash(m_url.toUtf8(), QCryptographicHash::Sha1);
+  QString base = MediaCache::directory("http") + "/" +
+                 QString::fromLatin1(hash.toHex());
+  m_mapPath = base + ".map";
+  m_data.setFileName(base + ".data");
+  if (!m_data.open(QIODevice::ReadWrite) || !m_data.resize(m_size)) {
+    qWarning() << "Failed to create HTTP cache file" << m_data.fileName();
+    return false;
+  }
+  // 完全命中缓存时不会写文件，打开时手动刷新修改时间供淘汰排序
+  m_data.setFileTime(QDateTime::currentDateTime(),
+                     QFileDevice::FileModificationTime);
+  m_present.assign((m_size + HTTP_CHUNK_SIZE - 1) / HTTP_CHUNK_SIZE, false);
+  if (!loadMap())
+    std::fill(m_present.begin(), m_present.end(), false);
+  trimCache(MediaCache::directory("http"), m_cacheLimit, m_data.fileName());
+
+  m_thread = std::thread(&HttpSource::fetchLoop, this);
+  return true;
+}
+
+int64_t HttpSource::size() const { return m_size; }
+
+QString HttpSource::describe() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  size_t cached = std::count(m_present.begin(), m_present.end(), true);
+  return QString("http %1/%2 chunks cached, prefetch %3KB")
+      .arg(cached)
+      .arg(m_present.size())
+      .arg(m_prefetchBytes / 1024);
+}
+
+int HttpSource::readAt(int64_t pos, uint8_t *buf, int size) {
+  if (pos >= m_size)
+    return 0;
+  int64_t chunk = pos / HTTP_CHUNK_SIZE;
+  // 每次只读到块尾，剩余部分由 libavformat 的下一次读取继续
+  int n = static_cast<int>(
+      std::min<int64_t>(size, std::min(m_size, (chunk + 1) * HTTP_CHUNK_SIZE) -
+                                  pos));
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_readPos = pos;
+    bool hit = m_present[chunk];
+    recordCacheLookup(hit);
+    if (!hit) {
+      m_wanted = chunk;
+      m_failed = -1; // 重新请求时恢复预取
+      m_cond.notify_all();
+      m_cond.wait(lk, [&] {
+        return m_abort || m_present[chunk] || m_failed == chunk;
+      });
+      m_wanted = -1;
+      if (m_abort)
+        return AVERROR_EXIT;
+      if (!m_present[chunk])
+        return AVERROR(EIO);
+    } else {
+      // 播放位置前进，唤醒预取线程补齐前方的块
+      m_cond.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(m_fileMutex);
+  if (!m_data.seek(pos))
+    return AVERROR(EIO);
+  qint64 got = m_data.read(reinterpret_cast<char *>(buf), n);
+  return got > 0 ? static_cast<int>(got) : AVERROR(EIO);
+}
+
+int64_t HttpSource::nextChunkLocked() const {
+  if (m_wanted >= 0 && !m_present[m_wanted])
+    return m_wanted;
+  if (m_failed >= 0)
+    return -1;
+  int64_t first = m_readPos / HTTP_CHUNK_SIZE;
+  int64_t last = std::min<int64_t>(
+      (m_readPos + m_prefetchBytes) / HTTP_CHUNK_SIZE,
+      static_cast<int64_t>(m_present.size()) - 1);
+  for (int64_t i = first; i <= last; i++) {
+    if (!m_present[i])
+      return i;
+  }
+  return -1;
+}
+
+bool HttpSource::fetchChunk(int64_t chunk, std::vector<uint8_t> &buf) {
+  int64_t start = chunk * HTTP_CHUNK_SIZE;
+  int len = static_cast<int>(std::min(HTTP_CHUNK_SIZE, m_size - start));
+  // 连续的块沿用同一个连接，跳转时 http 协议会重新发起 Range 请求
+  if (m_connPos != start) {
+    if (avio_seek(m_conn, start, SEEK_SET) < 0) {
+      m_connPos = -1;
+      return false;
+    }
+    m_connPos = start;
+  }
+  int got = 0;
+  while (got < len) {
+    int n = avio_read(m_conn, buf.data() + got, len - got);
+    if (n <= 0) {
+      m_connPos = -1;
+      return false;
+    }
+    got += n;
+  }
+  m_connPos += got;
+
+  std::lock_guard<std::mutex> lk(m_fileMutex);
+  return m_data.seek(start) &&
+         m_data.write(reinterpret_cast<const char *>(buf.data()), len) == len;
+}
+
+void HttpSource::fetchLoop() {
+  std::vector<uint8_t> buf(HTTP_CHUNK_SIZE);
+  while (true) {
+    int64_t chunk;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] { return m_abort || nextChunkLocked() >= 0; });
+      if (m_abort)
+        return;
+      chunk = nextChunkLocked();
+    }
+
+    bool ok = fetchChunk(chunk, buf);
+    bool save = false;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (ok) {
+        m_present[chunk] = true;
+        save = ++m_unsavedChunks >= MAP_SAVE_INTERVAL;
+      } else {
+        if (!m_abort)
+          qWarning() << "HTTP fetch failed at" << chunk * HTTP_CHUNK_SIZE;
+        m_failed = chunk;
+      }
+    }
+    m_cond.notify_all();
+    if (save)
+      saveMap();
+  }
+}
+
+bool HttpSource::loadMap() {
+  QFile f(m_mapPath);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0, version = 0;
+  QString url;
+  qint64 size = 0, chunkSize = 0;
+  QByteArray bits;
+  in >> magic >> version >> url >> size >> chunkSize >> bits;
+  // 服务器上的文件长度变化视为内容已更新，整个缓存作废
+  if (in.status() != QDataStream::Ok || magic != HTTP_CACHE_MAGIC ||
+      version != HTTP_CACHE_VERSION || url != m_url || size != m_size ||
+      chunkSize != HTTP_CHUNK_SIZE ||
+      bits.size() != static_cast<int>(m_present.size()))
+    return false;
+  for (int i = 0; i < bits.size(); i++)
+    m_present[i] = bits[i] != 0;
+  return true;
+}
+
+void HttpSource::saveMap() {
+  QByteArray bits;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    bits.resize(static_cast<int>(m_present.size()));
+    for (size_t i = 0; i < m_present.size(); i++)
+      bits[static_cast<int>(i)] = m_present[i] ? 1 : 0;
+    m_unsavedChunks = 0;
+  }
+  {
+    // 位图只记录已经写入的块，先把数据落盘
+    std::lock_guard<std::mutex> lk(m_fileMutex);
+    m_data.flush();
+  }
+  QSaveFile f(m_mapPath);
+  if (!f.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << HTTP_CACHE_MAGIC << HTTP_CACHE_VERSION << m_url << qint64(m_size)
+      << qint64(HTTP_CHUNK_SIZE) << bits;
+  if (!f.commit())
+    qWarning() << "Failed to write HTTP cache map for" << m_url;
+}
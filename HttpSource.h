@@ -0,0 +1,55 @@
+#pragma once
+#include "MediaSource.h"
+#include <QFile>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// HTTP 输入源：按固定大小的块发起 Range 请求，块保存在磁盘缓存中
+// 同一 URL 再次播放或回跳时直接从缓存读取；后台线程按播放位置向前预取
+class HttpSource : public MediaSource {
+public:
+  HttpSource(const QString &url, size_t prefetchBytes, qint64 cacheLimit);
+  ~HttpSource() override;
+
+  static bool isHttpUrl(const QString &path);
+
+  // 服务器不支持 Range 或长度未知时失败，由调用方退回到 libavformat 的 http 协议
+  bool open() override;
+  int64_t size() const override;
+  QString describe() const override;
+
+protected:
+  int readAt(int64_t pos, uint8_t *buf, int size) override;
+
+private:
+  static int interruptCallback(void *opaque);
+  void fetchLoop();
+  int64_t nextChunkLocked() const;
+  bool fetchChunk(int64_t chunk, std::vector<uint8_t> &buf);
+  bool loadMap();
+  void saveMap();
+
+  QString m_url;
+  size_t m_prefetchBytes;
+  qint64 m_cacheLimit;
+  int64_t m_size = -1;
+  AVIOContext *m_conn = nullptr; // 只由预取线程使用
+  int64_t m_connPos = 0;
+
+  // 缓存：稀疏数据文件 + 已下载块的位图
+  QFile m_data;
+  QString m_mapPath;
+  std::mutex m_fileMutex;
+  std::vector<bool> m_present;
+  int m_unsavedChunks = 0;
+
+  int64_t m_readPos = 0;
+  int64_t m_wanted = -1; // 读取方正在等待的块
+  int64_t m_failed = -1; // 最近一次下载失败的块，失败后暂停预取
+  std::atomic<bool> m_abort{false};
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::thread m_thread;
+};
@@ -0,0 +1,71 @@
+#include "KeyframeDecoder.h"
+#include <chrono>
+
+KeyframeDecoder::KeyframeDecoder() {}
+
+bool KeyframeDecoder::open(const QString &path, const QSize &box,
+                           QImage::Format format) {
+  return openInput(path, box, format);
+}
+
+void KeyframeDecoder::setupCodec(AVCodecContext *codec) {
+  // 每次只解一帧，多线程只会增加延迟
+  codec->thread_count = 1;
+  codec->skip_frame = AVDISCARD_NONKEY;
+  codec->skip_loop_filter = AVDISCARD_ALL;
+}
+
+bool KeyframeDecoder::keyframeBefore(qint64 ms, qint64 *keyframeMs) const {
+  if (!m_fmt)
+    return false;
+  if (m_useIndex) {
+    KeyframeIndex::Entry kf;
+    if (!m_index.lookup(ms, &kf))
+      return false;
+    *keyframeMs = kf.ms;
+    return true;
+  }
+  // MP4、MKV 等容器打开时已载入每条流的关键帧表
+  AVStream *st = m_fmt->streams[m_stream];
+  int i = av_index_search_timestamp(
+      st, av_rescale_q(ms, {1, 1000}, st->time_base), AVSEEK_FLAG_BACKWARD);
+  if (i < 0)
+    return false;
+  *keyframeMs = av_rescale_q(st->index_entries[i].timestamp, st->time_base,
+                             {1, 1000});
+  return true;
+}
+
+bool KeyframeDecoder::decodeAt(qint64 ms, QImage *out, qint64 *frameMs) {
+  if (!m_codec)
+    return false;
+  auto begin = std::chrono::steady_clock::now();
+  if (!seekTo(ms))
+    return false;
+
+  bool got = false;
+  while (!got && readKeyframe()) {
+    // 只送入这一个关键帧并立即冲刷，不必等解码器攒够重排所需的帧
+    int ret = avcodec_send_packet(m_codec, m_pkt);
+    av_packet_unref(m_pkt);
+    if (ret >= 0) {
+      avcodec_send_packet(m_codec, nullptr);
+      got = avcodec_receive_frame(m_codec, m_frame) == 0;
+    }
+    avcodec_flush_buffers(m_codec);
+  }
+  if (!got)
+    return false;
+
+  int64_t pts = frameTimestamp();
+  *frameMs = pts == AV_NOPTS_VALUE
+                 ? ms
+                 : av_rescale_q(pts, m_fmt->streams[m_stream]->time_base,
+                                {1, 1000});
+  bool ok = convertFrame(m_box, out);
+  av_frame_unref(m_frame);
+  m_lastDecodeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  return ok;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "SideDecoder.h"
+
+// 只解关键帧的轻量解码器：定位到指定时间之前最近的关键帧，
+// 单独解出这一帧（不解码任何依赖它的帧）并直接缩放到输出尺寸
+// 供拖动预览和缩略图使用，与播放线程互不影响；不是线程安全的
+class KeyframeDecoder : public SideDecoder {
+public:
+  KeyframeDecoder();
+
+  bool open(const QString &path, const QSize &box,
+            QImage::Format format = QImage::Format_RGB32);
+
+  // 查询 decodeAt(ms) 会落在哪个关键帧上（关键帧索引或容器自带的索引），
+  // 不读取文件；查不到时返回 false
+  bool keyframeBefore(qint64 ms, qint64 *keyframeMs) const;
+  // 解出时间不晚于 ms 的最后一个关键帧，frameMs 返回该帧的显示时间
+  bool decodeAt(qint64 ms, QImage *out, qint64 *frameMs);
+
+protected:
+  void setupCodec(AVCodecContext *codec) override;
+};
@@ -0,0 +1,162 @@
+#include "KeyframeIndex.h"
+#include "MediaCache.h"
+#include "ProbeCache.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QtDebug>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+static const quint32 KEYFRAME_INDEX_MAGIC = 0x4b464958; // "KFIX"
+static const quint32 KEYFRAME_INDEX_VERSION = 1;
+
+bool KeyframeIndex::supportsByteSeek(const AVFormatContext *fmt) {
+  if (!fmt || !fmt->iformat || (fmt->iformat->flags & AVFMT_NO_BYTE_SEEK))
+    return false;
+  // 这些容器/码流的解复用器能从任意 packet 边界重新同步
+  static const char *const names[] = {"mpegts", "mpeg", "mpegvideo", "h264",
+                                      "hevc"};
+  for (const char *name : names) {
+    if (strcmp(fmt->iformat->name, name) == 0)
+      return true;
+  }
+  return false;
+}
+
+int KeyframeIndex::pickStream(const AVFormatContext *fmt) {
+  int idx = av_find_best_stream(const_cast<AVFormatContext *>(fmt),
+                                AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (idx < 0)
+    idx = av_find_best_stream(const_cast<AVFormatContext *>(fmt),
+                              AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+  return idx;
+}
+
+bool KeyframeIndex::load(const QString &path) {
+  QString cacheFile = MediaCache::fileFor(path, "keyframes", ".idx");
+  if (cacheFile.isEmpty())
+    return false;
+  QFile f(cacheFile);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0, version = 0, count = 0;
+  qint32 stream = -1;
+  in >> magic >> version;
+  if (magic != KEYFRAME_INDEX_MAGIC || version != KEYFRAME_INDEX_VERSION ||
+      !MediaCache::checkKey(in, path))
+    return false;
+  in >> stream >> count;
+  if (in.status() != QDataStream::Ok ||
+      count > static_cast<quint64>(f.size()) / sizeof(Entry))
+    return false;
+  std::vector<Entry> entries(count);
+  // 条目按原始字节存储，每个关键帧 16 字节
+  int bytes = static_cast<int>(count * sizeof(Entry));
+  if (in.readRawData(reinterpret_cast<char *>(entries.data()), bytes) != bytes)
+    return false;
+  m_streamIndex = stream;
+  m_entries.swap(entries);
+  return true;
+}
+
+bool KeyframeIndex::save(const QString &path) const {
+  QString cacheFile = MediaCache::fileFor(path, "keyframes", ".idx");
+  if (cacheFile.isEmpty())
+    return false;
+  QSaveFile f(cacheFile);
+  if (!f.open(QIODevice::WriteOnly))
+    return false;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << KEYFRAME_INDEX_MAGIC << KEYFRAME_INDEX_VERSION;
+  MediaCache::writeKey(out, path);
+  out << qint32(m_streamIndex) << quint32(m_entries.size());
+  out.writeRawData(reinterpret_cast<const char *>(m_entries.data()),
+                   static_cast<int>(m_entries.size() * sizeof(Entry)));
+  return f.commit();
+}
+
+bool KeyframeIndex::build(const QString &path, int streamIndex,
+                          const std::atomic<bool> &abort) {
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+      0)
+    return false;
+  if (ProbeCache::findStreamInfo(fmt, path) < 0 || streamIndex < 0 ||
+      streamIndex >= static_cast<int>(fmt->nb_streams)) {
+    avformat_close_input(&fmt);
+    return false;
+  }
+  for (unsigned i = 0; i < fmt->nb_streams; i++)
+    fmt->streams[i]->discard =
+        static_cast<int>(i) == streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+  AVRational tb = fmt->streams[streamIndex]->time_base;
+
+  std::vector<Entry> entries;
+  AVPacket *pkt = av_packet_alloc();
+  qint64 bytes_since_pause = 0;
+  bool ok = pkt != nullptr;
+  while (ok && !abort) {
+    int ret = av_read_frame(fmt, pkt);
+    if (ret < 0) {
+      ok = ret == AVERROR_EOF || avio_feof(fmt->pb);
+      break;
+    }
+    if (pkt->stream_index == streamIndex && (pkt->flags & AV_PKT_FLAG_KEY) &&
+        pkt->pos >= 0) {
+      int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+      if (ts != AV_NOPTS_VALUE)
+        entries.push_back({av_rescale_q(ts, tb, {1, 1000}), pkt->pos});
+    }
+    // 后台扫描让出存储带宽，避免影响正在进行的播放
+    bytes_since_pause += pkt->size;
+    if (bytes_since_pause > 4 * 1024 * 1024) {
+      bytes_since_pause = 0;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+  avformat_close_input(&fmt);
+  if (!ok || abort)
+    return false;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.ms < b.ms; });
+  m_streamIndex = streamIndex;
+  m_entries.swap(entries);
+  return true;
+}
+
+bool KeyframeIndex::lookup(qint64 ms, Entry *out) const {
+  auto it = std::upper_bound(
+      m_entries.begin(), m_entries.end(), ms,
+      [](qint64 v, const Entry &e) { return v < e.ms; });
+  if (it == m_entries.begin())
+    return false;
+  *out = *(it - 1);
+  return true;
+}
+
+bool KeyframeIndex::lookupAfter(qint64 ms, Entry *out) const {
+  auto it = std::lower_bound(
+      m_entries.begin(), m_entries.end(), ms,
+      [](const Entry &e, qint64 v) { return e.ms < v; });
+  if (it == m_entries.end())
+    return false;
+  *out = *it;
+  return true;
+}
+
+const std::vector<KeyframeIndex::Entry> &KeyframeIndex::entries() const {
+  return m_entries;
+}
+
+int KeyframeIndex::streamIndex() const { return m_streamIndex; }
+
+bool KeyframeIndex::isEmpty() const { return m_entries.empty(); }
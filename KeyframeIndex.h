@@ -0,0 +1,42 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 关键帧索引：记录一条流上每个关键帧的时间戳和字节偏移
+// 由后台线程扫描一次文件建立，保存在磁盘缓存中；之后对索引不佳的容器
+// （MPEG-TS/PS、裸码流）可直接按字节偏移跳转，省去 av_seek_frame 的反复读取
+class KeyframeIndex {
+public:
+  struct Entry {
+    qint64 ms;  // 显示时间（与解码线程计算的 ms 同一时间轴）
+    qint64 pos; // packet 在文件中的字节偏移
+  };
+
+  // 容器能否从任意 packet 起点恢复解复用，只有这类容器才按字节跳转
+  static bool supportsByteSeek(const AVFormatContext *fmt);
+  // 选择要建立索引的流：优先视频流，其次音频流
+  static int pickStream(const AVFormatContext *fmt);
+
+  bool load(const QString &path);
+  bool save(const QString &path) const;
+  // 扫描整个文件；abort 置位时中止并返回 false
+  bool build(const QString &path, int streamIndex,
+             const std::atomic<bool> &abort);
+
+  // 查找时间不晚于 ms 的最后一个关键帧
+  bool lookup(qint64 ms, Entry *out) const;
+  // 查找时间不早于 ms 的第一个关键帧
+  bool lookupAfter(qint64 ms, Entry *out) const;
+  const std::vector<Entry> &entries() const;
+  int streamIndex() const;
+  bool isEmpty() const;
+
+private:
+  int m_streamIndex = -1;
+  std::vector<Entry> m_entries; // 按 ms 升序
+};
@@ -0,0 +1,79 @@
+#include "MediaCache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// 后台线程的 nice 值
+static const int BACKGROUND_NICE = 10;
+
+namespace {
+struct MediaKey {
+  QString path;
+  qint64 size = -1;
+  qint64 mtime = 0;
+};
+
+MediaKey keyOf(const QString &mediaPath) {
+  MediaKey key;
+  QFileInfo info(mediaPath);
+  if (!info.isFile())
+    return key;
+  key.path = info.absoluteFilePath();
+  key.size = info.size();
+  key.mtime = info.lastModified().toMSecsSinceEpoch();
+  return key;
+}
+} // namespace
+
+namespace MediaCache {
+
+QString directory(const QString &kind) {
+  QString root =
+      QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+  if (root.isEmpty())
+    root = QDir::tempPath();
+  QString dir = root + "/NewPlayer/" + kind;
+  QDir().mkpath(dir);
+  return dir;
+}
+
+QString fileFor(const QString &mediaPath, const QString &kind,
+                const QString &suffix) {
+  MediaKey key = keyOf(mediaPath);
+  if (key.size < 0)
+    return QString();
+  QByteArray id = QString("%1|%2|%3")
+                      .arg(key.path)
+                      .arg(key.size)
+                      .arg(key.mtime)
+                      .toUtf8();
+  QByteArray hash = QCryptographicHash::hash(id, QCryptographicHash::Sha1);
+  return directory(kind) + "/" + QString::fromLatin1(hash.toHex()) + suffix;
+}
+
+void writeKey(QDataStream &out, const QString &mediaPath) {
+  MediaKey key = keyOf(mediaPath);
+  out << key.path << key.size << key.mtime;
+}
+
+bool checkKey(QDataStream &in, const QString &mediaPath) {
+  MediaKey key = keyOf(mediaPath);
+  QString path;
+  qint64 size = 0, mtime = 0;
+  in >> path >> size >> mtime;
+  return in.status() == QDataStream::Ok && key.size >= 0 && path == key.path &&
+         size == key.size && mtime == key.mtime;
+}
+
+void lowerThreadPriority() {
+  // Linux 的 nice 值按线程生效，只降低调用线程
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+              BACKGROUND_NICE);
+}
+
+} // namespace MediaCache
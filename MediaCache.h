@@ -0,0 +1,17 @@
+#pragma once
+#include <QDataStream>
+#include <QString>
+
+// 磁盘缓存的公共部分：缓存目录，以及以 路径 + 大小 + 修改时间 为键的文件命名和校验
+namespace MediaCache {
+// 返回 <缓存根目录>/<kind>，不存在时创建
+QString directory(const QString &kind);
+// 返回 mediaPath 在 kind 缓存中对应的文件；mediaPath 不是普通文件时返回空串
+QString fileFor(const QString &mediaPath, const QString &kind,
+                const QString &suffix = ".bin");
+// 写入/校验缓存文件头中的媒体文件键，防止哈希碰撞或文件被替换
+void writeKey(QDataStream &out, const QString &mediaPath);
+bool checkKey(QDataStream &in, const QString &mediaPath);
+// 降低调用线程的优先级（nice 值），后台建立缓存时让出 CPU 给播放
+void lowerThreadPriority();
+} // namespace MediaCache
@@ -0,0 +1,138 @@
+#include "MediaSource.h"
+#include "FileSource.h"
+#include "HttpSource.h"
+#include <QFileInfo>
+#include <QtDebug>
+#include <chrono>
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+static const int AVIO_BUFFER_SIZE = 64 * 1024;
+
+MediaSource::~MediaSource() {
+  if (m_avio) {
+    av_freep(&m_avio->buffer);
+    avio_context_free(&m_avio);
+  }
+}
+
+std::unique_ptr<MediaSource> MediaSource::create(const QString &path,
+                                                 const Options &opts) {
+  if (opts.mode != Direct && HttpSource::isHttpUrl(path)) {
+    std::unique_ptr<MediaSource> source(
+        new HttpSource(path, opts.readAheadBytes, opts.httpCacheBytes));
+    if (source->open())
+      return source;
+    return nullptr;
+  }
+
+  QFileInfo info(path);
+  if (opts.mode == Direct || !info.isFile())
+    return nullptr;
+
+  Mode mode = opts.mode;
+  if (mode == Auto)
+    mode = info.size() <= opts.memoryThreshold ? Memory : ReadAhead;
+
+  std::unique_ptr<MediaSource> source(
+      new FileSource(path, mode, opts.readAheadBytes));
+  if (source->open())
+    return source;
+
+  // 内存不足或映射失败时退回到预读模式
+  if (mode != ReadAhead) {
+    qWarning() << "Falling back to read-ahead for" << path;
+    source.reset(new FileSource(path, ReadAhead, opts.readAheadBytes));
+    if (source->open())
+      return source;
+  }
+  return nullptr;
+}
+
+AVIOContext *MediaSource::avioContext() {
+  if (!m_avio) {
+    unsigned char *buf = (unsigned char *)av_malloc(AVIO_BUFFER_SIZE);
+    if (!buf)
+      return nullptr;
+    m_avio = avio_alloc_context(buf, AVIO_BUFFER_SIZE, 0, this,
+                                &MediaSource::readPacket, nullptr,
+                                &MediaSource::seekPacket);
+    if (!m_avio)
+      av_free(buf);
+  }
+  return m_avio;
+}
+
+IoStats MediaSource::stats() const {
+  IoStats s;
+  s.bytesRead = m_bytesRead.load();
+  s.readCalls = m_readCalls.load();
+  s.totalReadUs = m_totalReadUs.load();
+  s.maxReadUs = m_maxReadUs.load();
+  s.stalls = m_stalls.load();
+  s.stallUs = m_stallUs.load();
+  s.cacheHits = m_cacheHits.load();
+  s.cacheMisses = m_cacheMisses.load();
+  return s;
+}
+
+void MediaSource::recordCacheLookup(bool hit) {
+  if (hit)
+    m_cacheHits++;
+  else
+    m_cacheMisses++;
+}
+
+int MediaSource::readPacket(void *opaque, uint8_t *buf, int size) {
+  MediaSource *self = static_cast<MediaSource *>(opaque);
+  auto begin = std::chrono::steady_clock::now();
+  int n = self->readAt(self->m_pos, buf, size);
+  qint64 us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  self->m_readCalls++;
+  self->m_totalReadUs += us;
+  if (us > self->m_maxReadUs.load())
+    self->m_maxReadUs.store(us);
+  if (us > 20000) {
+    self->m_stalls++;
+    self->m_stallUs += us;
+  }
+
+  if (n <= 0)
+    return n == 0 ? AVERROR_EOF : n;
+  self->m_pos += n;
+  self->m_bytesRead += n;
+  return n;
+}
+
+int64_t MediaSource::seekPacket(void *opaque, int64_t offset, int whence) {
+  MediaSource *self = static_cast<MediaSource *>(opaque);
+  int64_t size = self->size();
+  if (whence & AVSEEK_SIZE)
+    return size >= 0 ? size : AVERROR(ENOSYS);
+
+  int64_t pos;
+  switch (whence & ~AVSEEK_FORCE) {
+  case SEEK_SET:
+    pos = offset;
+    break;
+  case SEEK_CUR:
+    pos = self->m_pos + offset;
+    break;
+  case SEEK_END:
+    if (size < 0)
+      return AVERROR(ENOSYS);
+    pos = size + offset;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  if (pos < 0)
+    return AVERROR(EINVAL);
+  self->m_pos = pos;
+  return pos;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+// 输入层 I/O 统计（以 libavformat 发起的读取为单位）
+struct IoStats {
+  qint64 bytesRead = 0;
+  qint64 readCalls = 0;
+  qint64 totalReadUs = 0; // 累计读取耗时
+  qint64 maxReadUs = 0;   // 单次最大读取耗时
+  qint64 stalls = 0;      // 耗时超过 20ms 的读取次数
+  qint64 stallUs = 0;     // 这些读取的累计耗时
+  qint64 cacheHits = 0;   // 带缓存的输入源：直接命中缓存的读取次数
+  qint64 cacheMisses = 0; // 需要等待下载的读取次数
+};
+
+// 媒体输入源：通过自定义 AVIOContext 向 libavformat 提供数据
+class MediaSource {
+public:
+  enum Mode {
+    Auto,      // 小文件整体载入内存，否则后台预读
+    Direct,    // 不使用自定义 I/O，交给 libavformat 的 file 协议
+    ReadAhead, // 后台线程顺序预读到环形缓冲区
+    Mmap,      // 内存映射整个文件
+    Memory     // 打开时一次性读入内存
+  };
+
+  struct Options {
+    Mode mode = Auto;
+    size_t readAheadBytes = 8 * 1024 * 1024; // 预读窗口大小
+    qint64 memoryThreshold = 32 * 1024 * 1024; // Auto 模式下整体载入的上限
+    qint64 httpCacheBytes = 512LL * 1024 * 1024; // HTTP 块缓存的磁盘上限
+  };
+
+  virtual ~MediaSource();
+
+  // 为 path 创建输入源：http(s) URL 使用带缓存的 Range 请求，本地文件按 mode
+  // 读取；Direct 模式或无法处理的输入返回 nullptr
+  static std::unique_ptr<MediaSource> create(const QString &path,
+                                             const Options &opts);
+
+  virtual bool open() = 0;
+  virtual int64_t size() const = 0;
+  virtual QString describe() const = 0;
+
+  // 返回供 AVFormatContext::pb 使用的上下文，由本对象负责释放
+  AVIOContext *avioContext();
+  IoStats stats() const;
+
+protected:
+  // 从绝对位置 pos 读取最多 size 字节：返回读取字节数，0 表示文件结束，负数为错误
+  virtual int readAt(int64_t pos, uint8_t *buf, int size) = 0;
+  void recordCacheLookup(bool hit);
+
+private:
+  static int readPacket(void *opaque, uint8_t *buf, int size);
+  static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+
+  AVIOContext *m_avio = nullptr;
+  int64_t m_pos = 0;
+  std::atomic<qint64> m_bytesRead{0};
+  std::atomic<qint64> m_readCalls{0};
+  std::atomic<qint64> m_totalReadUs{0};
+  std::atomic<qint64> m_maxReadUs{0};
+  std::atomic<qint64> m_stalls{0};
+  std::atomic<qint64> m_stallUs{0};
+  std::atomic<qint64> m_cacheHits{0};
+  std::atomic<qint64> m_cacheMisses{0};
+};
@@ -8,15 +8,61 @@ SOURCES += main.cpp \
            FFMpegDecoder.cpp \
            LyricManager.cpp \
            SubtitleManager.cpp \
+           SubtitleCueMap.cpp \
            LyricRenderer.cpp \
-           SubtitleRenderer.cpp
+           SubtitleRenderer.cpp \
+           PacketQueue.cpp \
+           PacketRing.cpp \
+           FrameQueue.cpp \
+           FrameBufferPool.cpp \
+           FrameConverter.cpp \
+           DegradeController.cpp \
+           WorkerPool.cpp \
+           ConvertKernels.cpp \
+           MediaSource.cpp \
+           FileSource.cpp \
+           HttpSource.cpp \
+           MediaCache.cpp \
+           ProbeCache.cpp \
+           KeyframeIndex.cpp \
+           SideDecoder.cpp \
+           KeyframeDecoder.cpp \
+           ScrubPreview.cpp \
+           ThumbnailSheet.cpp \
+           GopCache.cpp \
+           GopDecoder.cpp \
+           FrameStepper.cpp \
+           Benchmark.cpp
 
 HEADERS += VideoPlayer.h \
            FFMpegDecoder.h \
            LyricManager.h \
            SubtitleManager.h \
+           SubtitleCueMap.h \
            LyricRenderer.h \
-           SubtitleRenderer.h
+           SubtitleRenderer.h \
+           PacketQueue.h \
+           PacketRing.h \
+           FrameQueue.h \
+           FrameBufferPool.h \
+           FrameConverter.h \
+           DegradeController.h \
+           WorkerPool.h \
+           ConvertKernels.h \
+           MediaSource.h \
+           FileSource.h \
+           HttpSource.h \
+           MediaCache.h \
+           ProbeCache.h \
+           KeyframeIndex.h \
+           SideDecoder.h \
+           KeyframeDecoder.h \
+           ScrubPreview.h \
+           ThumbnailSheet.h \
+           GopCache.h \
+           GopDecoder.h \
+           FrameStepper.h \
+           Benchmark.h
 
 QMAKE_CXXFLAGS += -Wno-deprecated-declarations
 
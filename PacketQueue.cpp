@@ -0,0 +1,210 @@
+#include "PacketQueue.h"
+#include <algorithm>
+#include <chrono>
+
+PacketQueue::PacketQueue(size_t maxBytes, int64_t maxDurationMs)
+    : m_maxBytes(maxBytes), m_maxDurationMs(maxDurationMs) {}
+
+PacketQueue::~PacketQueue() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+}
+
+void PacketQueue::setLimits(size_t maxBytes, int64_t maxDurationMs) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_maxBytes = maxBytes;
+  m_maxDurationMs = maxDurationMs;
+  m_cond.notify_all();
+}
+
+void PacketQueue::setTimeBase(AVRational tb) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (tb.num > 0 && tb.den > 0)
+    m_timeBase = tb;
+}
+
+bool PacketQueue::put(AVPacket *pkt) {
+  AVPacket *copy = av_packet_alloc();
+  if (!copy)
+    return false;
+  av_packet_move_ref(copy, pkt);
+  return push(copy);
+}
+
+bool PacketQueue::putEof() {
+  AVPacket *eof = av_packet_alloc();
+  if (!eof)
+    return false;
+  return push(eof);
+}
+
+bool PacketQueue::putLoopMarker() {
+  AVPacket *marker = av_packet_alloc();
+  if (!marker)
+    return false;
+  marker->flags |= AV_PKT_FLAG_DISCARD;
+  return push(marker);
+}
+
+bool PacketQueue::isLoopMarker(const AVPacket *pkt) {
+  return !pkt->data && (pkt->flags & AV_PKT_FLAG_DISCARD);
+}
+
+bool PacketQueue::push(AVPacket *pkt) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  // 背压：超过字节上限时等待消费者取走数据；serial 变化说明已被 flush，直接放行
+  int serial = m_serial;
+  m_cond.wait(lk, [&] {
+    return m_abort || m_putInterrupted || serial != m_serial ||
+           m_bytes < m_maxBytes || m_entries.empty();
+  });
+  if (m_abort) {
+    av_packet_free(&pkt);
+    return false;
+  }
+  // 有跳转在等待执行：这个 packet 属于旧位置，随后会被 flush 作废，直接丢弃
+  if (m_putInterrupted) {
+    av_packet_free(&pkt);
+    return true;
+  }
+  if (m_waitKeyframe && pkt->data) {
+    if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+      av_packet_free(&pkt);
+      return true;
+    }
+    m_waitKeyframe = false;
+  }
+  Entry e;
+  e.pkt = pkt;
+  e.serial = m_serial;
+  e.ms = AV_NOPTS_VALUE;
+  int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+  if (ts != AV_NOPTS_VALUE)
+    e.ms = av_rescale_q(ts, m_timeBase, {1, 1000});
+  m_entries.push_back(e);
+  m_bytes += pkt->size + sizeof(*pkt);
+  m_sumDurationMs += av_rescale_q(pkt->duration, m_timeBase, {1, 1000});
+  m_cond.notify_all();
+  return true;
+}
+
+int PacketQueue::get(AVPacket *pkt, int *serial, int timeoutMs) {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (!m_cond.wait_for(lk, std::chrono::milliseconds(timeoutMs),
+                       [&] { return m_abort || !m_entries.empty(); }))
+    return 0;
+  if (m_abort)
+    return -1;
+  Entry e = m_entries.front();
+  m_entries.pop_front();
+  m_bytes -= e.pkt->size + sizeof(*e.pkt);
+  m_sumDurationMs -= av_rescale_q(e.pkt->duration, m_timeBase, {1, 1000});
+  av_packet_move_ref(pkt, e.pkt);
+  av_packet_free(&e.pkt);
+  if (serial)
+    *serial = e.serial;
+  m_cond.notify_all();
+  return 1;
+}
+
+int PacketQueue::dropToDuration(int64_t keepMs, bool toKeyframe) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (durationLocked() <= keepMs)
+    return 0;
+  auto droppable = [](const Entry &e) { return e.pkt->data != nullptr; };
+  int dropped = 0;
+  while (!m_entries.empty() && droppable(m_entries.front()) &&
+         durationLocked() > keepMs) {
+    popFrontLocked();
+    dropped++;
+  }
+  if (toKeyframe) {
+    while (!m_entries.empty() && droppable(m_entries.front()) &&
+           !(m_entries.front().pkt->flags & AV_PKT_FLAG_KEY)) {
+      popFrontLocked();
+      dropped++;
+    }
+    m_waitKeyframe = m_entries.empty();
+  }
+  m_cond.notify_all();
+  return dropped;
+}
+
+void PacketQueue::flush() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+  m_serial++;
+  m_putInterrupted = false;
+  m_cond.notify_all();
+}
+
+void PacketQueue::interruptPut() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_putInterrupted = true;
+  m_cond.notify_all();
+}
+
+void PacketQueue::abort() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_abort = true;
+  m_cond.notify_all();
+}
+
+void PacketQueue::start() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  clearLocked();
+  m_abort = false;
+  m_putInterrupted = false;
+  m_serial++;
+}
+
+int PacketQueue::serial() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_serial;
+}
+
+size_t PacketQueue::bytes() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_bytes;
+}
+
+size_t PacketQueue::count() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_entries.size();
+}
+
+int64_t PacketQueue::durationMs() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return durationLocked();
+}
+
+bool PacketQueue::hasEnough() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_bytes >= m_maxBytes || durationLocked() >= m_maxDurationMs;
+}
+
+void PacketQueue::clearLocked() {
+  for (Entry &e : m_entries)
+    av_packet_free(&e.pkt);
+  m_entries.clear();
+  m_bytes = 0;
+  m_sumDurationMs = 0;
+  m_waitKeyframe = false;
+}
+
+void PacketQueue::popFrontLocked() {
+  Entry &e = m_entries.front();
+  m_bytes -= e.pkt->size + sizeof(*e.pkt);
+  m_sumDurationMs -= av_rescale_q(e.pkt->duration, m_timeBase, {1, 1000});
+  av_packet_free(&e.pkt);
+  m_entries.pop_front();
+}
+
+int64_t PacketQueue::durationLocked() const {
+  // 部分容器的 packet 不带 duration，此时用首尾时间戳跨度估算
+  int64_t span = 0;
+  if (m_entries.size() > 1 && m_entries.front().ms != AV_NOPTS_VALUE &&
+      m_entries.back().ms != AV_NOPTS_VALUE)
+    span = m_entries.back().ms - m_entries.front().ms;
+  return std::max(m_sumDurationMs, span);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// 线程安全的有界 AVPacket 队列
+// 由解复用线程写入、解码线程读取；按字节数和时长限制容量，
+// 超过字节上限时 put 阻塞（背压），seek 时通过 flush 递增 serial
+class PacketQueue {
+public:
+  explicit PacketQueue(size_t maxBytes = 8 * 1024 * 1024,
+                       int64_t maxDurationMs = 3000);
+  ~PacketQueue();
+
+  void setLimits(size_t maxBytes, int64_t maxDurationMs);
+  // 设置所属流的时间基，用于计算队列时长
+  void setTimeBase(AVRational tb);
+
+  // 放入 packet（转移引用），超过字节上限时阻塞；返回 false 表示已中止
+  bool put(AVPacket *pkt);
+  // 放入空 packet 作为流结束标记，解码线程据此冲刷解码器
+  bool putEof();
+  // 放入 A-B 循环的回绕标记（带 AV_PKT_FLAG_DISCARD 的空 packet）：
+  // 之前的 packet 播到 B 为止，之后的从 A 重新开始
+  bool putLoopMarker();
+  static bool isLoopMarker(const AVPacket *pkt);
+  // 取出 packet：成功返回 1，超时返回 0，中止返回 -1
+  int get(AVPacket *pkt, int *serial, int timeoutMs);
+
+  // 清空队列并递增 serial，旧 serial 的数据全部作废
+  void flush();
+  // 跳转请求到来时调用：唤醒阻塞在背压上的 put，直到下一次 flush 之前
+  // put 都直接丢弃 packet 而不等待，避免解复用线程卡在满队列上执行不到跳转
+  void interruptPut();
+  void abort();
+  void start();
+
+  int serial() const;
+  size_t bytes() const;
+  size_t count() const;
+  int64_t durationMs() const;
+  // 队列是否已缓存足够数据（解复用线程据此暂停读取）
+  bool hasEnough() const;
+  // 直播追帧：从队首丢弃 packet 直到时长不超过 keepMs；toKeyframe 时继续丢到
+  // 下一个关键帧，队列中没有关键帧则丢弃后续 packet 直到关键帧到来
+  // 返回丢弃的 packet 数，不会丢弃流结束标记
+  int dropToDuration(int64_t keepMs, bool toKeyframe);
+
+private:
+  struct Entry {
+    AVPacket *pkt;
+    int serial;
+    int64_t ms; // 换算后的时间戳，AV_NOPTS_VALUE 表示未知
+  };
+
+  void clearLocked();
+  int64_t durationLocked() const;
+  void popFrontLocked();
+  bool push(AVPacket *pkt);
+
+  std::deque<Entry> m_entries;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  size_t m_bytes = 0;
+  int64_t m_sumDurationMs = 0;
+  size_t m_maxBytes;
+  int64_t m_maxDurationMs;
+  AVRational m_timeBase = {1, 1000};
+  int m_serial = 0;
+  bool m_putInterrupted = false; // interruptPut 置位，flush 清除
+  bool m_abort = true;
+  bool m_waitKeyframe = false; // 追帧后在关键帧到来前丢弃新 packet
+};
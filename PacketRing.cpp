@@ -0,0 +1,108 @@
+#include "PacketRing.h"
+#include <algorithm>
+
+PacketRing::PacketRing() {}
+
+PacketRing::~PacketRing() { clear(); }
+
+void PacketRing::setOptions(const Options &options) {
+  m_options = options;
+  if (m_options.maxDurationMs <= 0)
+    clear();
+}
+
+bool PacketRing::push(const AVPacket *pkt, AVRational tb) {
+  if (m_options.maxDurationMs <= 0 || m_full)
+    return false;
+  if (m_options.keepHead &&
+      m_bytes + pkt->size + sizeof(*pkt) > m_options.maxBytes) {
+    m_full = true;
+    return false;
+  }
+  AVPacket *ref = av_packet_clone(pkt);
+  if (!ref)
+    return false;
+  Entry e;
+  e.pkt = ref;
+  e.ms = AV_NOPTS_VALUE;
+  int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+  if (ts != AV_NOPTS_VALUE && tb.num > 0 && tb.den > 0)
+    e.ms = av_rescale_q(ts, tb, {1, 1000});
+  m_entries.push_back(e);
+  m_bytes += ref->size + sizeof(*ref);
+  if (e.ms != AV_NOPTS_VALUE)
+    m_lastMs = m_lastMs == AV_NOPTS_VALUE ? e.ms : std::max(m_lastMs, e.ms);
+
+  while (!m_options.keepHead && m_entries.size() > 1 &&
+         (m_bytes > m_options.maxBytes ||
+          durationMs() > m_options.maxDurationMs))
+    popFront();
+  return true;
+}
+
+void PacketRing::popFront() {
+  Entry &e = m_entries.front();
+  m_bytes -= e.pkt->size + sizeof(*e.pkt);
+  av_packet_free(&e.pkt);
+  m_entries.pop_front();
+  m_firstSeq++;
+}
+
+void PacketRing::clear() {
+  while (!m_entries.empty())
+    popFront();
+  m_bytes = 0;
+  m_lastMs = AV_NOPTS_VALUE;
+  m_full = false;
+}
+
+bool PacketRing::locate(int64_t targetMs, int videoStream, int audioStream,
+                        Replay *out) const {
+  if (m_entries.empty() || m_lastMs == AV_NOPTS_VALUE || targetMs > m_lastMs ||
+      (videoStream < 0 && audioStream < 0))
+    return false;
+  // 从新往旧找每一路不晚于目标的最后一个起点
+  bool need_video = videoStream >= 0, need_audio = audioStream >= 0;
+  uint64_t video_from = 0, audio_from = 0;
+  for (size_t i = m_entries.size(); i-- > 0 && (need_video || need_audio);) {
+    const Entry &e = m_entries[i];
+    if (e.ms == AV_NOPTS_VALUE || e.ms > targetMs)
+      continue;
+    if (need_video && e.pkt->stream_index == videoStream &&
+        (e.pkt->flags & AV_PKT_FLAG_KEY)) {
+      video_from = m_firstSeq + i;
+      need_video = false;
+    } else if (need_audio && e.pkt->stream_index == audioStream) {
+      audio_from = m_firstSeq + i;
+      need_audio = false;
+    }
+  }
+  if (need_video || need_audio)
+    return false;
+  out->videoFrom = videoStream >= 0 ? video_from : endSeq();
+  out->audioFrom = audioStream >= 0 ? audio_from : endSeq();
+  out->seq = std::min(out->videoFrom, out->audioFrom);
+  return true;
+}
+
+bool PacketRing::packetAt(uint64_t seq, AVPacket *out) const {
+  if (seq < m_firstSeq || seq >= endSeq())
+    return false;
+  return av_packet_ref(out, m_entries[seq - m_firstSeq].pkt) >= 0;
+}
+
+uint64_t PacketRing::endSeq() const { return m_firstSeq + m_entries.size(); }
+
+bool PacketRing::full() const { return m_full; }
+
+size_t PacketRing::bytes() const { return m_bytes; }
+
+int64_t PacketRing::durationMs() const {
+  if (m_entries.empty() || m_lastMs == AV_NOPTS_VALUE)
+    return 0;
+  // 队首可能没有时间戳，取最旧的一个有时间戳的 packet
+  for (const Entry &e : m_entries)
+    if (e.ms != AV_NOPTS_VALUE)
+      return m_lastMs - e.ms;
+  return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+// 最近解复用的 packet 环形缓存：与读取队列共享 packet 数据（引用计数，不复制），
+// 按时长和字节数限制，超出时从最旧的一端丢弃。跳转目标落在缓存窗口内时，
+// 解复用线程直接从这里重放 packet，不调用 av_seek_frame，也不再读取存储
+// 只由解复用线程使用，不是线程安全的
+class PacketRing {
+public:
+  struct Options {
+    int64_t maxDurationMs = 30000; // 0 表示不缓存
+    size_t maxBytes = 32 * 1024 * 1024;
+    // 满了以后不再接收新的 packet，保留最早的部分，不按时长限制
+    // （A-B 循环从 A 点起缓存）
+    bool keepHead = false;
+  };
+  // 重放起点：按解复用顺序从 seq 开始，视频从 videoFrom（关键帧）起、
+  // 音频从 audioFrom 起送入队列
+  struct Replay {
+    uint64_t seq = 0;
+    uint64_t videoFrom = 0;
+    uint64_t audioFrom = 0;
+  };
+
+  PacketRing();
+  ~PacketRing();
+  PacketRing(const PacketRing &) = delete;
+  PacketRing &operator=(const PacketRing &) = delete;
+
+  void setOptions(const Options &options);
+  // 记录一个刚读到的 packet（增加引用），tb 为所属流的时间基
+  // 返回 false 表示没有缓存（未启用，或 keepHead 时已满）
+  bool push(const AVPacket *pkt, AVRational tb);
+  // 缓存内容与解复用位置不再连续（如跳转到窗口外、轨道变化）时清空
+  void clear();
+
+  // targetMs 能否从缓存恢复：需要的每一路（流索引为 -1 表示不需要）在缓存中
+  // 都有不晚于目标的起点，视频须从关键帧开始
+  bool locate(int64_t targetMs, int videoStream, int audioStream,
+              Replay *out) const;
+  // 取出 seq 处的 packet（增加引用），seq 不在缓存中时返回 false
+  bool packetAt(uint64_t seq, AVPacket *out) const;
+  // 下一个 push 的序号，重放到这里即追上解复用位置
+  uint64_t endSeq() const;
+
+  // keepHead 时是否已满，满了之后的 packet 都不再缓存，内容始终连续
+  bool full() const;
+  size_t bytes() const;
+  int64_t durationMs() const;
+
+private:
+  struct Entry {
+    AVPacket *pkt;
+    int64_t ms; // AV_NOPTS_VALUE 表示未知
+  };
+  void popFront();
+
+  Options m_options;
+  std::deque<Entry> m_entries;
+  uint64_t m_firstSeq = 0; // m_entries.front() 的序号
+  size_t m_bytes = 0;
+  int64_t m_lastMs = AV_NOPTS_VALUE; // 已缓存的最大时间
+  bool m_full = false;
+};
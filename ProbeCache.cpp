@@ -0,0 +1,221 @@
+#include "ProbeCache.h"
+#include "MediaCache.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QtDebug>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+static const quint32 PROBE_CACHE_MAGIC = 0x50524f42; // "PROB"
+static const quint32 PROBE_CACHE_VERSION = 1;
+
+namespace {
+struct CachedStream {
+  AVRational timeBase;
+  AVRational avgFrameRate;
+  AVRational rFrameRate;
+  qint64 startTime;
+  qint64 duration;
+  qint64 nbFrames;
+  AVCodecParameters *par;
+};
+
+void writeRational(QDataStream &out, AVRational r) {
+  out << qint32(r.num) << qint32(r.den);
+}
+
+AVRational readRational(QDataStream &in) {
+  qint32 num = 0, den = 1;
+  in >> num >> den;
+  return AVRational{num, den};
+}
+
+void writeParameters(QDataStream &out, const AVCodecParameters *p) {
+  out << qint32(p->codec_type) << qint32(p->codec_id) << quint32(p->codec_tag);
+  out << QByteArray(reinterpret_cast<const char *>(p->extradata),
+                    p->extradata ? p->extradata_size : 0);
+  out << qint32(p->format) << qint64(p->bit_rate)
+      << qint32(p->bits_per_coded_sample) << qint32(p->bits_per_raw_sample)
+      << qint32(p->profile) << qint32(p->level);
+  out << qint32(p->width) << qint32(p->height);
+  writeRational(out, p->sample_aspect_ratio);
+  out << qint32(p->field_order) << qint32(p->color_range)
+      << qint32(p->color_primaries) << qint32(p->color_trc)
+      << qint32(p->color_space) << qint32(p->chroma_location)
+      << qint32(p->video_delay);
+  out << quint64(p->channel_layout) << qint32(p->channels)
+      << qint32(p->sample_rate) << qint32(p->block_align)
+      << qint32(p->frame_size) << qint32(p->initial_padding)
+      << qint32(p->trailing_padding) << qint32(p->seek_preroll);
+}
+
+bool readParameters(QDataStream &in, AVCodecParameters *p) {
+  qint32 type, id, format, bpcs, bprs, profile, level, width, height;
+  qint32 field_order, range, primaries, trc, space, chroma, video_delay;
+  qint32 channels, sample_rate, block_align, frame_size, initial_padding,
+      trailing_padding, seek_preroll;
+  quint32 tag;
+  quint64 channel_layout;
+  qint64 bit_rate;
+  QByteArray extradata;
+  in >> type >> id >> tag >> extradata;
+  in >> format >> bit_rate >> bpcs >> bprs >> profile >> level;
+  in >> width >> height;
+  AVRational sar = readRational(in);
+  in >> field_order >> range >> primaries >> trc >> space >> chroma >>
+      video_delay;
+  in >> channel_layout >> channels >> sample_rate >> block_align >>
+      frame_size >> initial_padding >> trailing_padding >> seek_preroll;
+  if (in.status() != QDataStream::Ok)
+    return false;
+
+  p->codec_type = static_cast<AVMediaType>(type);
+  p->codec_id = static_cast<AVCodecID>(id);
+  p->codec_tag = tag;
+  av_freep(&p->extradata);
+  p->extradata_size = 0;
+  if (!extradata.isEmpty()) {
+    p->extradata = static_cast<uint8_t *>(
+        av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!p->extradata)
+      return false;
+    memcpy(p->extradata, extradata.constData(), extradata.size());
+    p->extradata_size = extradata.size();
+  }
+  p->format = format;
+  p->bit_rate = bit_rate;
+  p->bits_per_coded_sample = bpcs;
+  p->bits_per_raw_sample = bprs;
+  p->profile = profile;
+  p->level = level;
+  p->width = width;
+  p->height = height;
+  p->sample_aspect_ratio = sar;
+  p->field_order = static_cast<AVFieldOrder>(field_order);
+  p->color_range = static_cast<AVColorRange>(range);
+  p->color_primaries = static_cast<AVColorPrimaries>(primaries);
+  p->color_trc = static_cast<AVColorTransferCharacteristic>(trc);
+  p->color_space = static_cast<AVColorSpace>(space);
+  p->chroma_location = static_cast<AVChromaLocation>(chroma);
+  p->video_delay = video_delay;
+  p->channel_layout = channel_layout;
+  p->channels = channels;
+  p->sample_rate = sample_rate;
+  p->block_align = block_align;
+  p->frame_size = frame_size;
+  p->initial_padding = initial_padding;
+  p->trailing_padding = trailing_padding;
+  p->seek_preroll = seek_preroll;
+  return true;
+}
+} // namespace
+
+int ProbeCache::findStreamInfo(AVFormatContext *fmt, const QString &path,
+                               bool *hit) {
+  if (load(fmt, path)) {
+    if (hit)
+      *hit = true;
+    return 0;
+  }
+  if (hit)
+    *hit = false;
+  int ret = avformat_find_stream_info(fmt, nullptr);
+  if (ret >= 0)
+    store(fmt, path);
+  return ret;
+}
+
+bool ProbeCache::load(AVFormatContext *fmt, const QString &path) {
+  QString cacheFile = MediaCache::fileFor(path, "probe");
+  if (cacheFile.isEmpty())
+    return false;
+  QFile f(cacheFile);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0, version = 0;
+  in >> magic >> version;
+  if (magic != PROBE_CACHE_MAGIC || version != PROBE_CACHE_VERSION ||
+      !MediaCache::checkKey(in, path))
+    return false;
+
+  qint64 duration, start_time, bit_rate;
+  quint32 nb_streams;
+  in >> duration >> start_time >> bit_rate >> nb_streams;
+  // 流在读包时才出现的容器（如 MPEG-TS）打开后数量对不上，交给正常探测
+  if (in.status() != QDataStream::Ok || nb_streams != fmt->nb_streams)
+    return false;
+
+  std::vector<CachedStream> streams(nb_streams);
+  bool ok = true;
+  for (quint32 i = 0; i < nb_streams && ok; i++) {
+    CachedStream &cs = streams[i];
+    cs.par = avcodec_parameters_alloc();
+    cs.timeBase = readRational(in);
+    cs.avgFrameRate = readRational(in);
+    cs.rFrameRate = readRational(in);
+    in >> cs.startTime >> cs.duration >> cs.nbFrames;
+    ok = cs.par && readParameters(in, cs.par);
+
+    // 头部已能确定的信息必须与缓存一致
+    const AVStream *st = fmt->streams[i];
+    const AVCodecParameters *cur = st->codecpar;
+    if (ok && (av_cmp_q(st->time_base, cs.timeBase) != 0 ||
+               cur->codec_type != cs.par->codec_type ||
+               (cur->codec_id != AV_CODEC_ID_NONE &&
+                cur->codec_id != cs.par->codec_id)))
+      ok = false;
+  }
+
+  if (ok) {
+    for (quint32 i = 0; i < nb_streams; i++) {
+      AVStream *st = fmt->streams[i];
+      const CachedStream &cs = streams[i];
+      avcodec_parameters_copy(st->codecpar, cs.par);
+      st->avg_frame_rate = cs.avgFrameRate;
+      st->r_frame_rate = cs.rFrameRate;
+      st->start_time = cs.startTime;
+      st->duration = cs.duration;
+      st->nb_frames = cs.nbFrames;
+    }
+    fmt->duration = duration;
+    fmt->start_time = start_time;
+    fmt->bit_rate = bit_rate;
+  }
+  for (CachedStream &cs : streams)
+    avcodec_parameters_free(&cs.par);
+  return ok;
+}
+
+void ProbeCache::store(const AVFormatContext *fmt, const QString &path) {
+  QString cacheFile = MediaCache::fileFor(path, "probe");
+  if (cacheFile.isEmpty())
+    return;
+  QSaveFile f(cacheFile);
+  if (!f.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << PROBE_CACHE_MAGIC << PROBE_CACHE_VERSION;
+  MediaCache::writeKey(out, path);
+  out << qint64(fmt->duration) << qint64(fmt->start_time)
+      << qint64(fmt->bit_rate) << quint32(fmt->nb_streams);
+  for (unsigned i = 0; i < fmt->nb_streams; i++) {
+    const AVStream *st = fmt->streams[i];
+    writeRational(out, st->time_base);
+    writeRational(out, st->avg_frame_rate);
+    writeRational(out, st->r_frame_rate);
+    out << qint64(st->start_time) << qint64(st->duration)
+        << qint64(st->nb_frames);
+    writeParameters(out, st->codecpar);
+  }
+  if (!f.commit())
+    qWarning() << "Failed to write probe cache for" << path;
+}
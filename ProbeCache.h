@@ -0,0 +1,21 @@
+#pragma once
+#include <QString>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 持久化的流探测缓存
+// 以 路径 + 大小 + 修改时间 为键保存 avformat_find_stream_info 的结果（流布局、
+// 编解码参数、时长），再次打开同一文件时直接套用，跳过耗时的探测
+class ProbeCache {
+public:
+  // 先尝试缓存，未命中时调用 avformat_find_stream_info 并写入缓存
+  // 返回值含义同 avformat_find_stream_info；hit 返回是否命中缓存
+  static int findStreamInfo(AVFormatContext *fmt, const QString &path,
+                            bool *hit = nullptr);
+
+  // 将缓存的参数应用到刚打开的 fmt；流布局或时间基与缓存不符时返回 false
+  static bool load(AVFormatContext *fmt, const QString &path);
+  static void store(const AVFormatContext *fmt, const QString &path);
+};
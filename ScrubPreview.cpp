@@ -0,0 +1,120 @@
+#include "ScrubPreview.h"
+#include "KeyframeDecoder.h"
+#include <QtDebug>
+#include <algorithm>
+
+ScrubPreview::ScrubPreview(QObject *parent) : QObject(parent) {
+  m_thread = std::thread(&ScrubPreview::workerLoop, this);
+}
+
+ScrubPreview::~ScrubPreview() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void ScrubPreview::setSource(const QString &path) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_path = path;
+  m_request = -1;
+}
+
+void ScrubPreview::setOutputSize(const QSize &size) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_size = size;
+}
+
+void ScrubPreview::setOutputFormat(QImage::Format format) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_format = format;
+}
+
+void ScrubPreview::request(qint64 ms) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_path.isEmpty())
+      return;
+    m_request = std::max<qint64>(0, ms);
+  }
+  m_cond.notify_all();
+}
+
+void ScrubPreview::cancel() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_request = -1;
+  m_generation++;
+}
+
+void ScrubPreview::workerLoop() {
+  KeyframeDecoder decoder;
+  QString opened;
+  qint64 last_keyframe = -1, last_frame = -1;
+  int generation = 0;
+  int frames = 0, skipped = 0;
+  qint64 total_us = 0;
+
+  while (true) {
+    qint64 target;
+    QString path;
+    QSize size;
+    QImage::Format format;
+    int request_generation;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [&] { return m_stop || m_request >= 0; });
+      if (m_stop)
+        break;
+      target = m_request;
+      m_request = -1;
+      path = m_path;
+      size = m_size;
+      format = m_format;
+      request_generation = m_generation;
+    }
+
+    // 上一轮拖动显示过的帧已被播放画面盖掉，新一轮拖动要重新送出
+    if (request_generation != generation) {
+      generation = request_generation;
+      last_keyframe = last_frame = -1;
+    }
+
+    // 打开失败（如纯音频文件）时同一文件不再重试
+    if (path != opened) {
+      opened = path;
+      last_keyframe = last_frame = -1;
+      if (!decoder.open(path, size, format))
+        qDebug() << "Scrub preview unavailable for" << path;
+    }
+    if (!decoder.isOpen())
+      continue;
+    decoder.setOutput(size, format);
+
+    // 落在已显示的关键帧上：不读文件也不解码
+    qint64 keyframe = -1;
+    if (decoder.keyframeBefore(target, &keyframe) &&
+        keyframe == last_keyframe) {
+      skipped++;
+      continue;
+    }
+    QImage img;
+    qint64 frame_ms = 0;
+    if (!decoder.decodeAt(target, &img, &frame_ms))
+      continue;
+    frames++;
+    total_us += decoder.lastDecodeUs();
+    last_keyframe = keyframe;
+    if (frame_ms == last_frame)
+      continue;
+    last_frame = frame_ms;
+    emit previewReady(QSharedPointer<QImage>(new QImage(img)), frame_ms);
+  }
+
+  if (frames > 0)
+    qDebug() << "Scrub preview:" << frames << "keyframes decoded, avg"
+             << total_us / frames / 1000.0 << "ms," << skipped
+             << "requests on an already shown keyframe";
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 拖动进度时的实时预览：后台线程用独立的 KeyframeDecoder 解出拖动位置之前
+// 最近的关键帧。请求只保留最新一个，上一帧做完才取下一个，出帧速度自然
+// 与 CPU 能承受的速度一致；落在同一关键帧上的请求不重复解码
+class ScrubPreview : public QObject {
+  Q_OBJECT
+public:
+  explicit ScrubPreview(QObject *parent = nullptr);
+  ~ScrubPreview();
+
+  // 切换预览的文件，为空时不预览；输入在第一次请求时才打开
+  void setSource(const QString &path);
+  void setOutputSize(const QSize &size);
+  void setOutputFormat(QImage::Format format);
+
+  // 请求 ms 位置的预览，覆盖尚未处理的请求
+  void request(qint64 ms);
+  // 拖动结束，丢弃尚未处理的请求
+  void cancel();
+
+signals:
+  // ms 为预览帧（关键帧）的实际时间
+  void previewReady(const QSharedPointer<QImage> &img, qint64 ms);
+
+private:
+  void workerLoop();
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_stop = false;
+  QString m_path;
+  QSize m_size;
+  QImage::Format m_format = QImage::Format_RGB32;
+  qint64 m_request = -1; // 待处理的位置，-1 表示没有
+  int m_generation = 0;  // 每次拖动结束递增，新一轮拖动不跳过上一轮已显示的帧
+};
@@ -0,0 +1,136 @@
+#include "SideDecoder.h"
+#include "FFMpegDecoder.h"
+#include "ProbeCache.h"
+#include <algorithm>
+
+// 定位后最多跳过这么多个 packet 来找关键帧，关键帧标记不可靠的码流不至于读完整个文件
+static const int MAX_SKIPPED_PACKETS = 4096;
+
+SideDecoder::SideDecoder() {}
+
+SideDecoder::~SideDecoder() { close(); }
+
+bool SideDecoder::openInput(const QString &path, const QSize &box,
+                            QImage::Format format) {
+  close();
+  m_box = box;
+  m_format = format;
+  if (avformat_open_input(&m_fmt, path.toUtf8().constData(), nullptr,
+                          nullptr) < 0)
+    return false;
+  AVCodec *decoder = nullptr;
+  if (ProbeCache::findStreamInfo(m_fmt, path) >= 0)
+    m_stream =
+        av_find_best_stream(m_fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  if (m_stream < 0 || !decoder) {
+    close();
+    return false;
+  }
+  for (unsigned i = 0; i < m_fmt->nb_streams; i++)
+    m_fmt->streams[i]->discard =
+        static_cast<int>(i) == m_stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+  m_codec = avcodec_alloc_context3(decoder);
+  if (!m_codec ||
+      avcodec_parameters_to_context(m_codec,
+                                    m_fmt->streams[m_stream]->codecpar) < 0) {
+    close();
+    return false;
+  }
+  setupCodec(m_codec);
+  m_codec->lowres =
+      std::min(FFMpegDecoder::lowresFor(m_codec->width, m_codec->height, box, 3),
+               av_codec_get_max_lowres(decoder));
+  if (avcodec_open2(m_codec, decoder, nullptr) < 0) {
+    close();
+    return false;
+  }
+  m_pkt = av_packet_alloc();
+  m_frame = av_frame_alloc();
+
+  // 播放时建立的关键帧索引可以直接复用（只用于支持字节跳转的容器）
+  m_useIndex = KeyframeIndex::supportsByteSeek(m_fmt) && m_index.load(path) &&
+               m_index.streamIndex() == m_stream && !m_index.isEmpty();
+  return m_pkt && m_frame;
+}
+
+void SideDecoder::close() {
+  av_frame_free(&m_frame);
+  av_packet_free(&m_pkt);
+  avcodec_free_context(&m_codec);
+  avformat_close_input(&m_fmt);
+  m_stream = -1;
+  m_index = KeyframeIndex();
+  m_useIndex = false;
+  m_converter.reset();
+  m_srcWidth = m_srcHeight = 0;
+  m_srcFormat = -1;
+}
+
+bool SideDecoder::isOpen() const { return m_codec != nullptr; }
+
+qint64 SideDecoder::durationMs() const {
+  return m_fmt && m_fmt->duration > 0 ? m_fmt->duration / (AV_TIME_BASE / 1000)
+                                      : 0;
+}
+
+void SideDecoder::setOutput(const QSize &box, QImage::Format format) {
+  m_box = box;
+  m_format = format;
+}
+
+qint64 SideDecoder::lastDecodeUs() const { return m_lastDecodeUs; }
+
+bool SideDecoder::seekTo(qint64 ms) {
+  AVStream *st = m_fmt->streams[m_stream];
+  KeyframeIndex::Entry kf;
+  bool positioned = m_useIndex && m_index.lookup(ms, &kf) &&
+                    av_seek_frame(m_fmt, -1, kf.pos, AVSEEK_FLAG_BYTE) >= 0;
+  return positioned ||
+         av_seek_frame(m_fmt, m_stream,
+                       av_rescale_q(ms, {1, 1000}, st->time_base),
+                       AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+bool SideDecoder::readKeyframe() {
+  int skipped = 0;
+  while (skipped < MAX_SKIPPED_PACKETS && av_read_frame(m_fmt, m_pkt) >= 0) {
+    if (m_pkt->stream_index == m_stream && (m_pkt->flags & AV_PKT_FLAG_KEY))
+      return true;
+    av_packet_unref(m_pkt);
+    skipped++;
+  }
+  return false;
+}
+
+int64_t SideDecoder::frameTimestamp() const {
+  int64_t pts = m_frame->best_effort_timestamp;
+  return pts != AV_NOPTS_VALUE ? pts : m_frame->pts;
+}
+
+bool SideDecoder::convertFrame(const QSize &box, QImage *out) {
+  QSize fit(m_frame->width, m_frame->height);
+  if (!box.isEmpty() && !fit.isEmpty())
+    fit.scale(box, Qt::KeepAspectRatio);
+  fit = fit.expandedTo(QSize(1, 1));
+  if (!m_converter.isValid() || m_frame->width != m_srcWidth ||
+      m_frame->height != m_srcHeight || m_frame->format != m_srcFormat ||
+      fit != m_outSize || m_format != m_outFormat) {
+    m_srcWidth = m_frame->width;
+    m_srcHeight = m_frame->height;
+    m_srcFormat = m_frame->format;
+    m_outSize = fit;
+    m_outFormat = m_format;
+    if (!m_converter.configure(m_srcWidth, m_srcHeight,
+                               static_cast<AVPixelFormat>(m_srcFormat),
+                               fit.width(), fit.height(), m_format,
+                               m_format == QImage::Format_RGB16))
+      return false;
+  }
+  QImage img(m_outSize, m_outFormat);
+  if (img.isNull())
+    return false;
+  m_converter.convert(m_frame, img.bits(), img.bytesPerLine());
+  *out = img;
+  return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "FrameConverter.h"
+#include "KeyframeIndex.h"
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+// 独立于播放线程的视频解码器基类：直接用 libavformat 打开本地文件
+// （不经过 MediaSource，调用方不应传入网络地址）、只保留主视频流，
+// 负责按关键帧定位和把解出的帧缩放到输出尺寸；
+// KeyframeDecoder 和 GopDecoder 在此基础上决定解哪些帧。不是线程安全的
+class SideDecoder {
+public:
+  virtual ~SideDecoder();
+  SideDecoder(const SideDecoder &) = delete;
+  SideDecoder &operator=(const SideDecoder &) = delete;
+
+  void close();
+  bool isOpen() const;
+  qint64 durationMs() const;
+  // 修改输出区域和格式，下一次解码生效
+  void setOutput(const QSize &box, QImage::Format format);
+  // 最近一次解码的耗时（us）
+  qint64 lastDecodeUs() const;
+
+protected:
+  SideDecoder();
+
+  // 打开 path 的主视频流，画面按原比例适配到 box 后以 format 输出
+  // 源远大于 box 时按 lowres 解码（只在打开时决定）
+  bool openInput(const QString &path, const QSize &box, QImage::Format format);
+  // 打开解码器之前调整线程数、跳帧等参数
+  virtual void setupCodec(AVCodecContext *codec) = 0;
+
+  // 定位到 ms 之前最近的关键帧附近：优先用关键帧索引做字节跳转
+  bool seekTo(qint64 ms);
+  // 读到主视频流的下一个关键帧 packet 放在 m_pkt 中，跳过太多 packet 时放弃
+  bool readKeyframe();
+  // m_frame 的显示时间（流时间基），没有时为 AV_NOPTS_VALUE
+  int64_t frameTimestamp() const;
+  // 把 m_frame 按原比例适配到 box 后转换为 m_format
+  bool convertFrame(const QSize &box, QImage *out);
+
+  AVFormatContext *m_fmt = nullptr;
+  AVCodecContext *m_codec = nullptr;
+  AVPacket *m_pkt = nullptr;
+  AVFrame *m_frame = nullptr;
+  int m_stream = -1;
+  KeyframeIndex m_index;
+  bool m_useIndex = false;
+
+  QSize m_box;
+  QImage::Format m_format = QImage::Format_RGB32;
+  qint64 m_lastDecodeUs = 0;
+
+private:
+  FrameConverter m_converter;
+  int m_srcWidth = 0, m_srcHeight = 0, m_srcFormat = -1;
+  QSize m_outSize;
+  QImage::Format m_outFormat = QImage::Format_Invalid;
+};
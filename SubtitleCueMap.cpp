@@ -0,0 +1,166 @@
+#include "SubtitleCueMap.h"
+#include "KeyframeIndex.h"
+#include "MediaCache.h"
+#include "ProbeCache.h"
+#include <QtDebug>
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 关键帧在开始时间之前不超过该值时按关键帧跳转，多听到的一小段不影响跟读
+static const qint64 CUE_SNAP_MS = 300;
+
+SubtitleCueMap::SubtitleCueMap(QObject *parent) : QObject(parent) {}
+
+SubtitleCueMap::~SubtitleCueMap() { cancel(); }
+
+std::vector<qint64> SubtitleCueMap::videoKeyframes(const QString &path) {
+  std::vector<qint64> keyframes;
+  AVFormatContext *fmt = nullptr;
+  if (avformat_open_input(&fmt, path.toUtf8().constData(), nullptr, nullptr) <
+      0)
+    return keyframes;
+  if (ProbeCache::findStreamInfo(fmt, path) < 0) {
+    avformat_close_input(&fmt);
+    return keyframes;
+  }
+  int stream = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (stream < 0) {
+    avformat_close_input(&fmt);
+    return keyframes;
+  }
+  // 容器自带的索引（MP4、带 Cues 的 MKV 等）打开时已经读入，不必扫描文件
+  AVStream *st = fmt->streams[stream];
+  for (int i = 0; i < st->nb_index_entries; i++) {
+    const AVIndexEntry &e = st->index_entries[i];
+    if (e.flags & AVINDEX_KEYFRAME)
+      keyframes.push_back(av_rescale_q(e.timestamp, st->time_base, {1, 1000}));
+  }
+  // 解码器只为可按字节跳转的容器建立关键帧索引，其他容器没有索引可等
+  bool indexed = KeyframeIndex::supportsByteSeek(fmt);
+  avformat_close_input(&fmt);
+
+  // 没有索引的容器（MPEG-TS/PS 等）等解码器的关键帧索引就绪，不再自己扫描
+  // 一遍文件（解码器有缓存时直接读入，否则正在后台建立）
+  if (keyframes.empty() && indexed) {
+    std::shared_ptr<const KeyframeIndex> index;
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_indexCond.wait(lk, [this] { return m_abort || m_index; });
+      index = m_index;
+    }
+    if (m_abort || index->streamIndex() != stream)
+      return keyframes;
+    for (const KeyframeIndex::Entry &e : index->entries())
+      keyframes.push_back(e.ms);
+  }
+  std::sort(keyframes.begin(), keyframes.end());
+  return keyframes;
+}
+
+void SubtitleCueMap::cancel() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_abort = true;
+  }
+  m_indexCond.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  m_abort = false;
+}
+
+void SubtitleCueMap::clear() {
+  setCues(QString(), QVector<SubtitleCue>());
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_index.reset();
+}
+
+void SubtitleCueMap::setKeyframeIndex(
+    std::shared_ptr<const KeyframeIndex> index) {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_index = std::move(index);
+  }
+  m_indexCond.notify_all();
+}
+
+void SubtitleCueMap::setCues(const QString &videoPath,
+                             const QVector<SubtitleCue> &cues) {
+  cancel();
+  quint64 generation;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_cues = cues;
+    m_keyframes.clear();
+    generation = ++m_generation;
+  }
+  if (videoPath.isEmpty() || cues.isEmpty())
+    return;
+
+  std::vector<qint64> starts;
+  starts.reserve(cues.size());
+  for (const SubtitleCue &cue : cues)
+    starts.push_back(cue.startTime);
+  m_thread = std::thread([this, videoPath, starts, generation]() {
+    MediaCache::lowerThreadPriority();
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<qint64> keyframes = videoKeyframes(videoPath);
+    if (keyframes.empty() || m_abort)
+      return;
+    // 每条字幕开始时间之前（含）最近的关键帧，-1 表示之前没有关键帧
+    std::vector<qint64> mapped;
+    mapped.reserve(starts.size());
+    int snapped = 0;
+    for (qint64 start : starts) {
+      auto it = std::upper_bound(keyframes.begin(), keyframes.end(), start);
+      qint64 kf = it == keyframes.begin() ? -1 : *(it - 1);
+      mapped.push_back(kf);
+      if (kf >= 0 && start - kf <= CUE_SNAP_MS)
+        snapped++;
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (generation != m_generation)
+        return;
+      m_keyframes.swap(mapped);
+    }
+    qDebug() << "Subtitle cues mapped:" << starts.size() << "cues,"
+             << keyframes.size() << "keyframes," << snapped
+             << "cues start at a keyframe, took"
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count()
+             << "ms";
+    emit this->mapped(static_cast<int>(starts.size()), snapped);
+  });
+}
+
+bool SubtitleCueMap::isEmpty() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_cues.isEmpty();
+}
+
+bool SubtitleCueMap::target(qint64 pts, int direction, Target *out) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  // 当前句：开始时间不晚于 pts 的最后一条；按关键帧跳转会落在开始时间之前
+  // 一点，即将开始的条目也算作当前句，连续点按“下一句”不会停在原地
+  auto it = std::upper_bound(
+      m_cues.begin(), m_cues.end(), pts + CUE_SNAP_MS,
+      [](qint64 v, const SubtitleCue &cue) { return v < cue.startTime; });
+  int current = static_cast<int>(it - m_cues.begin()) - 1;
+  int index = direction < 0   ? current - 1
+              : direction > 0 ? current + 1
+                              : current;
+  if (index < 0 || index >= m_cues.size())
+    return false;
+  qint64 start = m_cues[index].startTime;
+  out->index = index;
+  out->ms = start;
+  out->keyframe = index < static_cast<int>(m_keyframes.size()) &&
+                  m_keyframes[index] >= 0 &&
+                  start - m_keyframes[index] <= CUE_SNAP_MS;
+  return true;
+}
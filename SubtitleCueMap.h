@@ -0,0 +1,60 @@
+#pragma once
+#include "SubtitleManager.h"
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class KeyframeIndex;
+
+// 按字幕条目导航：上一句、下一句、重复当前句。后台线程把每条字幕的开始时间
+// 对应到之前最近的视频关键帧（优先用容器自带的索引，没有时等待解码器的
+// KeyframeIndex 就绪，不另外扫描文件）。关键帧紧挨在开始时间之前的条目直接按关键帧跳转，
+// 和关键帧跳转一样快；其余条目精确跳转到开始时间。映射完成前一律精确跳转
+class SubtitleCueMap : public QObject {
+  Q_OBJECT
+public:
+  // 跳转目标：keyframe 为 true 时 ms 之前不远处就是关键帧，可以快速跳转
+  struct Target {
+    qint64 ms = -1;
+    bool keyframe = false;
+    int index = -1;
+  };
+
+  explicit SubtitleCueMap(QObject *parent = nullptr);
+  ~SubtitleCueMap();
+
+  // 切换字幕并取消进行中的映射；videoPath 为空（直播、网络地址）时不映射
+  void setCues(const QString &videoPath, const QVector<SubtitleCue> &cues);
+  void clear();
+  // 解码器的关键帧索引（就绪后由播放器传入，clear() 时清除）
+  void setKeyframeIndex(std::shared_ptr<const KeyframeIndex> index);
+  bool isEmpty() const;
+
+  // 相对 pts 所在的条目：direction < 0 上一句，0 当前句，> 0 下一句；
+  // 即将开始（不到 CUE_SNAP_MS）的条目算作当前句。没有对应条目时返回 false
+  bool target(qint64 pts, int direction, Target *out) const;
+
+signals:
+  // 映射完成，snapped 条条目可以按关键帧跳转
+  void mapped(int cues, int snapped);
+
+private:
+  void cancel();
+  // 视频流所有关键帧的显示时间（升序），没有视频流或映射取消时为空
+  std::vector<qint64> videoKeyframes(const QString &path);
+
+  mutable std::mutex m_mutex;
+  QVector<SubtitleCue> m_cues;
+  std::vector<qint64> m_keyframes; // 与 m_cues 对应，为空表示尚未映射
+  quint64 m_generation = 0;
+  std::thread m_thread;
+  std::atomic<bool> m_abort{false};
+  std::shared_ptr<const KeyframeIndex> m_index;
+  std::condition_variable m_indexCond;
+};
@@ -3,6 +3,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QTextStream>
+#include <algorithm>
 
 SubtitleManager::SubtitleManager() : currentSubtitleIndex(-1), hasAssSubtitle(false), assTrack(nullptr) {}
 
@@ -128,6 +129,33 @@ const QVector<SubtitleLine>& SubtitleManager::getSubtitles() const {
     return subtitles;
 }
 
+QVector<SubtitleCue> SubtitleManager::cues() const {
+    QVector<SubtitleCue> all;
+    if (hasAssSubtitle && assTrack) {
+        // libass 只把 Dialogue 行读入 events，Comment 行不在其中
+        for (int i = 0; i < assTrack->n_events; ++i) {
+            const ASS_Event &e = assTrack->events[i];
+            if (e.Duration > 0)
+                all.append({e.Start, e.Start + e.Duration});
+        }
+    } else {
+        for (const SubtitleLine &line : subtitles)
+            if (line.endTime > line.startTime)
+                all.append({line.startTime, line.endTime});
+    }
+    std::sort(all.begin(), all.end(), [](const SubtitleCue &a, const SubtitleCue &b) {
+        return a.startTime < b.startTime;
+    });
+    QVector<SubtitleCue> merged;
+    for (const SubtitleCue &cue : all) {
+        if (!merged.isEmpty() && merged.last().startTime == cue.startTime)
+            merged.last().endTime = qMax(merged.last().endTime, cue.endTime);
+        else
+            merged.append(cue);
+    }
+    return merged;
+}
+
 int SubtitleManager::getCurrentSubtitleIndex() const {
     return currentSubtitleIndex;
 }
@@ -11,6 +11,12 @@ struct SubtitleLine {
     QString style;
 };
 
+// 一条字幕的时间区间（SRT 的一条字幕或 ASS 的一个 Dialogue 事件）
+struct SubtitleCue {
+    qint64 startTime;
+    qint64 endTime;
+};
+
 class SubtitleManager {
 public:
     SubtitleManager();
@@ -20,6 +26,8 @@ public:
     bool findSimilarSubtitle(const QString &videoPath, QString &subtitlePath);
     int levenshteinDistance(const QString &s1, const QString &s2);
     const QVector<SubtitleLine>& getSubtitles() const;
+    // 所有字幕条目按开始时间排序，同一时刻开始的条目（如 ASS 的多层）合并为一条
+    QVector<SubtitleCue> cues() const;
     int getCurrentSubtitleIndex() const;
     bool hasAss() const;
     void reset();
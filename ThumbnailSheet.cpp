@@ -0,0 +1,261 @@
+#include "ThumbnailSheet.h"
+#include "KeyframeDecoder.h"
+#include "MediaCache.h"
+#include "WorkerPool.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtDebug>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const quint32 THUMBNAIL_MAGIC = 0x54484d42; // "THMB"
+static const quint32 THUMBNAIL_VERSION = 1;
+// 精灵图每行的缩略图数
+static const int SHEET_COLUMNS = 10;
+
+namespace {
+// 精灵图按紧凑的行（宽 × 2 字节）存储，与 QImage 的行对齐无关
+QByteArray packRows(const QImage &img) {
+  int rowBytes = img.width() * 2;
+  QByteArray raw(rowBytes * img.height(), Qt::Uninitialized);
+  for (int y = 0; y < img.height(); y++)
+    memcpy(raw.data() + y * rowBytes, img.constScanLine(y), rowBytes);
+  return raw;
+}
+} // namespace
+
+bool ThumbnailSheet::load(const QString &path, const Options &opts) {
+  QString cacheFile = MediaCache::fileFor(path, "thumbnails", ".sheet");
+  if (cacheFile.isEmpty())
+    return false;
+  QFile f(cacheFile);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0, version = 0;
+  in >> magic >> version;
+  if (magic != THUMBNAIL_MAGIC || version != THUMBNAIL_VERSION ||
+      !MediaCache::checkKey(in, path))
+    return false;
+  // 生成参数不同的缓存视为未命中
+  qint64 optInterval = 0, interval = 0;
+  qint32 boxW = 0, boxH = 0, maxThumbs = 0, count = 0, columns = 0, cellW = 0,
+         cellH = 0;
+  QByteArray packed;
+  in >> optInterval >> boxW >> boxH >> maxThumbs >> interval >> count >>
+      columns >> cellW >> cellH >> packed;
+  if (in.status() != QDataStream::Ok || optInterval != opts.intervalMs ||
+      boxW != opts.thumbSize.width() || boxH != opts.thumbSize.height() ||
+      maxThumbs != opts.maxThumbs || interval <= 0 || count <= 0 ||
+      columns <= 0 || cellW <= 0 || cellH <= 0)
+    return false;
+  int rows = (count + columns - 1) / columns;
+  QImage img(cellW * columns, cellH * rows, QImage::Format_RGB16);
+  QByteArray raw = qUncompress(packed);
+  int rowBytes = img.width() * 2;
+  if (img.isNull() || raw.size() != rowBytes * img.height())
+    return false;
+  for (int y = 0; y < img.height(); y++)
+    memcpy(img.scanLine(y), raw.constData() + y * rowBytes, rowBytes);
+
+  m_options = opts;
+  m_intervalMs = interval;
+  m_count = count;
+  m_columns = columns;
+  m_cellSize = QSize(cellW, cellH);
+  m_image = img;
+  return true;
+}
+
+bool ThumbnailSheet::save(const QString &path) const {
+  if (isEmpty())
+    return false;
+  QString cacheFile = MediaCache::fileFor(path, "thumbnails", ".sheet");
+  if (cacheFile.isEmpty())
+    return false;
+  QSaveFile f(cacheFile);
+  if (!f.open(QIODevice::WriteOnly))
+    return false;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << THUMBNAIL_MAGIC << THUMBNAIL_VERSION;
+  MediaCache::writeKey(out, path);
+  out << m_options.intervalMs << qint32(m_options.thumbSize.width())
+      << qint32(m_options.thumbSize.height()) << qint32(m_options.maxThumbs)
+      << m_intervalMs << qint32(m_count) << qint32(m_columns)
+      << qint32(m_cellSize.width()) << qint32(m_cellSize.height())
+      << qCompress(packRows(m_image));
+  return f.commit();
+}
+
+bool ThumbnailSheet::build(const QString &path, const Options &opts,
+                           const std::atomic<bool> &abort) {
+  // 直接解码到缩略图尺寸（源足够大时按 lowres 解码）
+  KeyframeDecoder decoder;
+  if (!decoder.open(path, opts.thumbSize, QImage::Format_RGB16))
+    return false;
+  qint64 duration = decoder.durationMs();
+  if (duration <= 0 || opts.intervalMs <= 0 || opts.maxThumbs <= 0)
+    return false;
+  qint64 interval = opts.intervalMs;
+  if ((duration + interval - 1) / interval > opts.maxThumbs)
+    interval = (duration / opts.maxThumbs / 1000 + 1) * 1000;
+  int count = static_cast<int>((duration + interval - 1) / interval);
+  int columns = std::min(count, SHEET_COLUMNS);
+  int rows = (count + columns - 1) / columns;
+
+  QImage sheet;
+  QSize cell;
+  QImage last;
+  qint64 last_keyframe = -1;
+  for (int i = 0; i < count && !abort; i++) {
+    qint64 t = i * interval;
+    QImage thumb;
+    qint64 keyframe = -1, frame_ms = 0;
+    // 关键帧间隔比缩略图间隔长时，相邻几格是同一个关键帧，不再重复解码
+    bool known = decoder.keyframeBefore(t, &keyframe);
+    if (known && keyframe == last_keyframe && !last.isNull())
+      thumb = last;
+    else if (!decoder.decodeAt(t, &thumb, &frame_ms))
+      continue;
+    last = thumb;
+    last_keyframe = known ? keyframe : -1;
+
+    if (sheet.isNull()) {
+      cell = thumb.size();
+      sheet = QImage(cell.width() * columns, cell.height() * rows,
+                     QImage::Format_RGB16);
+      if (sheet.isNull())
+        return false;
+      sheet.fill(Qt::black);
+    }
+    // 中途分辨率变化的片段缩放到统一的格子尺寸
+    if (thumb.size() != cell)
+      thumb = thumb.scaled(cell);
+    int x = (i % columns) * cell.width(), y = (i / columns) * cell.height();
+    for (int row = 0; row < cell.height(); row++)
+      memcpy(sheet.scanLine(y + row) + x * 2, thumb.constScanLine(row),
+             cell.width() * 2);
+  }
+  if (abort || sheet.isNull())
+    return false;
+
+  m_options = opts;
+  m_intervalMs = interval;
+  m_count = count;
+  m_columns = columns;
+  m_cellSize = cell;
+  m_image = sheet;
+  return true;
+}
+
+bool ThumbnailSheet::isEmpty() const { return m_count == 0; }
+
+int ThumbnailSheet::count() const { return m_count; }
+
+qint64 ThumbnailSheet::intervalMs() const { return m_intervalMs; }
+
+const QImage &ThumbnailSheet::image() const { return m_image; }
+
+bool ThumbnailSheet::cellFor(qint64 ms, QRect *rect) const {
+  if (isEmpty() || ms < 0)
+    return false;
+  int i = std::min<qint64>(ms / m_intervalMs, m_count - 1);
+  *rect = QRect((i % m_columns) * m_cellSize.width(),
+                (i / m_columns) * m_cellSize.height(), m_cellSize.width(),
+                m_cellSize.height());
+  return true;
+}
+
+int ThumbnailSheet::buildBatch(const QStringList &paths, int threads) {
+  QStringList files;
+  for (const QString &p : paths) {
+    QFileInfo info(p);
+    if (info.isDir()) {
+      for (const QFileInfo &entry :
+           QDir(p).entryInfoList(QDir::Files, QDir::Name))
+        files << entry.absoluteFilePath();
+    } else {
+      files << p;
+    }
+  }
+  if (files.isEmpty()) {
+    qDebug() << "No input files";
+    return 1;
+  }
+
+  std::atomic<int> built{0}, cached{0}, failed{0};
+  std::atomic<bool> abort{false};
+  auto begin = std::chrono::steady_clock::now();
+  WorkerPool pool(threads > 0 ? threads : WorkerPool::defaultThreadCount(16));
+  pool.run(files.size(), [&](int i) {
+    const QString &file = files.at(i);
+    ThumbnailSheet sheet;
+    if (sheet.load(file, Options())) {
+      cached++;
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!sheet.build(file, Options(), abort) || !sheet.save(file)) {
+      qDebug() << "Thumbnails failed:" << file;
+      failed++;
+      return;
+    }
+    built++;
+    qDebug() << "Thumbnails:" << file << sheet.count() << "x"
+             << sheet.intervalMs() / 1000 << "s in"
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count()
+             << "ms";
+  });
+  qDebug() << "Thumbnail batch:" << built.load() << "built," << cached.load()
+           << "already cached," << failed.load() << "failed, threads"
+           << pool.threadCount() << "total"
+           << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count()
+           << "ms";
+  return failed > 0 ? 1 : 0;
+}
+
+ThumbnailLoader::ThumbnailLoader(QObject *parent) : QObject(parent) {
+  qRegisterMetaType<QSharedPointer<ThumbnailSheet>>(
+      "QSharedPointer<ThumbnailSheet>");
+}
+
+ThumbnailLoader::~ThumbnailLoader() { cancel(); }
+
+void ThumbnailLoader::cancel() {
+  m_abort = true;
+  if (m_thread.joinable())
+    m_thread.join();
+  m_abort = false;
+}
+
+void ThumbnailLoader::load(const QString &path) {
+  cancel();
+  if (path.isEmpty())
+    return;
+  m_thread = std::thread([this, path]() {
+    QSharedPointer<ThumbnailSheet> sheet(new ThumbnailSheet);
+    if (!sheet->load(path, ThumbnailSheet::Options())) {
+      MediaCache::lowerThreadPriority();
+      auto begin = std::chrono::steady_clock::now();
+      if (!sheet->build(path, ThumbnailSheet::Options(), m_abort))
+        return;
+      sheet->save(path);
+      qDebug() << "Thumbnails built:" << sheet->count() << "in"
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - begin)
+                      .count()
+               << "ms";
+    }
+    emit sheetReady(path, sheet);
+  });
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <QImage>
+#include <QObject>
+#include <QRect>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <thread>
+
+// 进度预览缩略图：按固定间隔各取一个关键帧，缩小后按行排进一张 RGB16 精灵图
+// 以 路径 + 大小 + 修改时间 为键压缩保存在磁盘缓存中
+class ThumbnailSheet {
+public:
+  struct Options {
+    qint64 intervalMs = 10000;  // 缩略图间隔；太长的文件自动加大
+    QSize thumbSize{128, 72};   // 每张缩略图的最大尺寸（按原比例适配）
+    int maxThumbs = 200;        // 张数上限，限制内存和生成时间
+  };
+
+  bool load(const QString &path, const Options &opts);
+  bool save(const QString &path) const;
+  // 用只解关键帧的解码器生成；abort 置位时中止并返回 false
+  bool build(const QString &path, const Options &opts,
+             const std::atomic<bool> &abort);
+
+  bool isEmpty() const;
+  int count() const;
+  qint64 intervalMs() const;
+  const QImage &image() const;
+  // ms 处缩略图在 image() 中的区域
+  bool cellFor(qint64 ms, QRect *rect) const;
+
+  // 批量生成（命令行）：paths 为文件或目录（目录取其中的文件，不递归），
+  // 用 threads 个线程并行处理，已有缓存的文件跳过；全部成功时返回 0
+  static int buildBatch(const QStringList &paths, int threads);
+
+private:
+  Options m_options;
+  qint64 m_intervalMs = 0;
+  int m_count = 0;
+  int m_columns = 0;
+  QSize m_cellSize;
+  QImage m_image;
+};
+
+// 后台加载缩略图：先读缓存，未命中时在低优先级线程中生成并写入缓存
+class ThumbnailLoader : public QObject {
+  Q_OBJECT
+public:
+  explicit ThumbnailLoader(QObject *parent = nullptr);
+  ~ThumbnailLoader();
+
+  // 取消进行中的任务，开始加载 path（为空时只取消）
+  void load(const QString &path);
+
+signals:
+  void sheetReady(const QString &path, QSharedPointer<ThumbnailSheet> sheet);
+
+private:
+  void cancel();
+
+  std::thread m_thread;
+  std::atomic<bool> m_abort{false};
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<ThumbnailSheet>)
@@ -11,6 +11,7 @@
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QGuiApplication>
 #include <QMediaMetaData>
 #include <QMenu>
 #include <QMouseEvent>
@@ -18,6 +19,7 @@
 #include <QPainterPath>
 #include <QProcess>
 #include <QPushButton>
+#include <QScreen>
 #include <QSharedPointer>
 #include <QTextStream>
 #include <QTimer>
@@ -31,6 +33,15 @@
 #include <taglib/unsynchronizedlyricsframe.h>
 #include <taglib/xiphcomment.h>
 
+// 拖动跳转距离不超过该值时精确跳转，更远时落在关键帧上
+static const qint64 ACCURATE_SEEK_MAX_JUMP_MS = 60 * 1000;
+// 长按进入 2 倍速后，每继续按住这么久倍速翻一倍（直到 16 倍速快进）
+static const int LONG_PRESS_ESCALATE_MS = 1500;
+// 快退/快进按钮的跳转距离，小于解码器默认的跳转缓冲时长，往回跳直接从内存重放
+static const qint64 SKIP_STEP_MS = 10 * 1000;
+// A-B 循环的最短长度
+static const qint64 MIN_LOOP_MS = 500;
+
 VideoPlayer::VideoPlayer(QWidget *parent)
     : QWidget(parent), lastScrollUpdateTime(0), updatePending(false),
       lastUpdateTime(0) {
@@ -52,12 +63,57 @@ VideoPlayer::VideoPlayer(QWidget *parent)
 
   // Decoder
   decoder = new FFMpegDecoder(this);
+  // 输出格式与屏幕一致，绘制时不再逐帧转换格式
+  QScreen *screen = QGuiApplication::primaryScreen();
+  QImage::Format displayFormat =
+      FFMpegDecoder::preferredFormat(screen ? screen->depth() : 32);
+  decoder->setOutputFormat(displayFormat,
+                           displayFormat == QImage::Format_RGB16);
+  scrubPreview = new ScrubPreview(this);
+  scrubPreview->setOutputFormat(displayFormat);
+  connect(scrubPreview, &ScrubPreview::previewReady, this,
+          &VideoPlayer::onScrubPreview);
+  thumbnailLoader = new ThumbnailLoader(this);
+  connect(thumbnailLoader, &ThumbnailLoader::sheetReady, this,
+          [this](const QString &path, QSharedPointer<ThumbnailSheet> sheet) {
+            if (path == thumbnailPath)
+              thumbnails = sheet;
+          });
+  frameStepper = new FrameStepper(this);
+  connect(frameStepper, &FrameStepper::frameReady, this,
+          &VideoPlayer::onSteppedFrame);
+  // 倒放按时钟取帧：缓存命中时立即显示，跟不上时跳过中间的帧
+  reverseTimer = new QTimer(this);
+  reverseTimer->setInterval(10);
+  connect(reverseTimer, &QTimer::timeout, this, [this]() {
+    qint64 target = std::max<qint64>(
+        0, reverseAnchorMs - reverseClock.elapsed() * reverseSpeed);
+    QImage img;
+    qint64 ms = 0;
+    if (frameStepper->frameAt(target, &img, &ms) && ms != currentPts)
+      showSteppedFrame(img, ms);
+    if (target == 0)
+      setReverseSpeed(0);
+  });
   connect(decoder, &FFMpegDecoder::frameReady, this, &VideoPlayer::onFrame);
   connect(decoder, &FFMpegDecoder::audioReady, this, &VideoPlayer::onAudioData);
   connect(decoder, &FFMpegDecoder::durationChanged, this,
           [&](qint64 d) { duration = d; });
   connect(decoder, &FFMpegDecoder::positionChanged, this,
           &VideoPlayer::onPositionChanged);
+  connect(decoder, &FFMpegDecoder::mediaInfoReady, this,
+          &VideoPlayer::onMediaInfo);
+  connect(decoder, &FFMpegDecoder::playbackReady, this,
+          &VideoPlayer::onPlaybackReady);
+  connect(decoder, &FFMpegDecoder::seekCompleted, this,
+          &VideoPlayer::onSeekCompleted);
+  connect(decoder, &FFMpegDecoder::loopChanged, this,
+          &VideoPlayer::onLoopChanged);
+  // 首帧迟迟未就绪（如解码失败）时也要加载歌词和字幕
+  sidecarTimer = new QTimer(this);
+  sidecarTimer->setSingleShot(true);
+  connect(sidecarTimer, &QTimer::timeout, this,
+          &VideoPlayer::loadPendingSidecars);
   // 新增：错误提示
   errorShowTimer = new QTimer(this);
   errorShowTimer->setSingleShot(true);
@@ -84,7 +140,7 @@ VideoPlayer::VideoPlayer(QWidget *parent)
   speedPressTimer = new QTimer(this);
   speedPressTimer->setSingleShot(true);
   connect(speedPressTimer, &QTimer::timeout, this, [this]() {
-    if (pressed && !isSeeking) {
+    if (pressed && !isSeeking && !isSpeedPressed) {
       // 修改：保存当前的速度，而不是写死1.0f
       normalPlaybackSpeed = decoder->playbackSpeed(); 
       isSpeedPressed = true;
@@ -93,7 +149,22 @@ VideoPlayer::VideoPlayer(QWidget *parent)
       // 显示 2 倍速提示，使用土司消息
       toastMessage = "▶▶ 2 倍速播放中";
       toastTimer->stop(); // 停止计时器，确保消息持续显示
+      // 继续按住则逐级加速
+      speedPressTimer->start(LONG_PRESS_ESCALATE_MS);
 
+      scheduleUpdate();
+    } else if (pressed && !isSeeking) {
+      // 继续按住：4、8、16 倍速，进入只显示关键帧的快进模式
+      float before = decoder->playbackSpeed();
+      decoder->setPlaybackSpeed(before * 2);
+      float speed = decoder->playbackSpeed();
+      if (speed <= before)
+        return; // 已是最高倍速（纯音频最高 4 倍）
+      toastMessage = decoder->isTrickPlay()
+                         ? QString("▶▶ %1 倍速快进（关键帧）").arg(speed)
+                         : QString("▶▶ %1 倍速播放中").arg(speed);
+      toastTimer->stop();
+      speedPressTimer->start(LONG_PRESS_ESCALATE_MS);
       scheduleUpdate();
     }
   });
@@ -111,6 +182,7 @@ VideoPlayer::VideoPlayer(QWidget *parent)
     // 修改：当overlay隐藏时，同时隐藏按钮
     trackButton->setVisible(false);
     speedButton->setVisible(false);
+    stepBar->setVisible(false);
     scheduleUpdate();
   });
   showOverlayBar = false;
@@ -194,6 +266,10 @@ VideoPlayer::VideoPlayer(QWidget *parent)
   subtitleManager = new SubtitleManager();
   lyricRenderer = new LyricRenderer(lyricManager);
   subtitleRenderer = new SubtitleRenderer(subtitleManager);
+  cueMap = new SubtitleCueMap(this);
+  // 没有容器索引的文件用解码器的关键帧索引映射字幕，不再各自扫描一遍
+  connect(decoder, &FFMpegDecoder::keyframeIndexReady, this,
+          [this]() { cueMap->setKeyframeIndex(decoder->keyframeIndex()); });
 
   // 轨道切换按钮和菜单
   trackButton = new QPushButton("轨道", this);
@@ -271,9 +347,67 @@ VideoPlayer::VideoPlayer(QWidget *parent)
   });
   // --- 倍速控制按钮初始化结束 ---
 
+  // 快退/快进、逐帧步进和倒放按钮（步进和倒放会暂停播放）
+  stepBar = new QWidget(this);
+  stepBar->setGeometry(80, 40, 410, 64);
+  QPushButton *skipBackButton = new QPushButton("-10s", stepBar);
+  QPushButton *stepBackButton = new QPushButton("◀|", stepBar);
+  QPushButton *stepForwardButton = new QPushButton("|▶", stepBar);
+  QPushButton *skipForwardButton = new QPushButton("+10s", stepBar);
+  reverseButton = new QPushButton("倒放", stepBar);
+  loopButton = new QPushButton("A-B", stepBar);
+  skipBackButton->setGeometry(0, 0, 60, 28);
+  stepBackButton->setGeometry(70, 0, 60, 28);
+  stepForwardButton->setGeometry(140, 0, 60, 28);
+  skipForwardButton->setGeometry(210, 0, 60, 28);
+  reverseButton->setGeometry(280, 0, 60, 28);
+  loopButton->setGeometry(350, 0, 60, 28);
+  for (QPushButton *button : {skipBackButton, stepBackButton, stepForwardButton,
+                              skipForwardButton, reverseButton, loopButton})
+    button->setStyleSheet(
+        "background:rgba(30,30,30,180);color:white;border-radius:8px;");
+  // 第二行：字幕条目跳转
+  cueBar = new QWidget(stepBar);
+  cueBar->setGeometry(0, 36, 200, 28);
+  QPushButton *prevCueButton = new QPushButton("上一句", cueBar);
+  QPushButton *repeatCueButton = new QPushButton("重复", cueBar);
+  QPushButton *nextCueButton = new QPushButton("下一句", cueBar);
+  prevCueButton->setGeometry(0, 0, 60, 28);
+  repeatCueButton->setGeometry(70, 0, 60, 28);
+  nextCueButton->setGeometry(140, 0, 60, 28);
+  for (QPushButton *button : {prevCueButton, repeatCueButton, nextCueButton})
+    button->setStyleSheet(
+        "background:rgba(30,30,30,180);color:white;border-radius:8px;");
+  cueBar->setVisible(false);
+  stepBar->raise();
+  connect(prevCueButton, &QPushButton::clicked, this,
+          [this]() { jumpToCue(-1); });
+  connect(repeatCueButton, &QPushButton::clicked, this,
+          [this]() { jumpToCue(0); });
+  connect(nextCueButton, &QPushButton::clicked, this,
+          [this]() { jumpToCue(1); });
+  connect(skipBackButton, &QPushButton::clicked, this,
+          [this]() { skipBy(-SKIP_STEP_MS); });
+  connect(skipForwardButton, &QPushButton::clicked, this,
+          [this]() { skipBy(SKIP_STEP_MS); });
+  connect(loopButton, &QPushButton::clicked, this, &VideoPlayer::toggleLoop);
+  connect(stepBackButton, &QPushButton::clicked, this,
+          [this]() { stepFrame(-1); });
+  connect(stepForwardButton, &QPushButton::clicked, this,
+          [this]() { stepFrame(1); });
+  connect(reverseButton, &QPushButton::clicked, this, [this]() {
+    // 不倒放 → 1 倍速 → 2 倍速 → 停止
+    int next = reverseSpeed == 0 ? 1 : reverseSpeed == 1 ? 2 : 0;
+    setReverseSpeed(next);
+    showToastMessage(reverseSpeed > 0 ? tr("倒放: %1x").arg(reverseSpeed)
+                                      : tr("停止倒放"),
+                     2000);
+  });
+
   // 初始隐藏所有按钮
   trackButton->setVisible(false);
   speedButton->setVisible(false);
+  stepBar->setVisible(false);
 }
 
 VideoPlayer::~VideoPlayer() {
@@ -309,14 +443,104 @@ VideoPlayer::~VideoPlayer() {
   delete subtitleManager;
 }
 
+void VideoPlayer::setDecoderThreading(const DecoderThreading &threading) {
+  decoder->setDecoderThreading(threading);
+}
+
+void VideoPlayer::setDisplayFormat(QImage::Format format, bool dither) {
+  decoder->setOutputFormat(format, dither);
+  scrubPreview->setOutputFormat(format);
+}
+
+void VideoPlayer::setDegradeOptions(const DegradeOptions &options) {
+  decoder->setDegradeOptions(options);
+}
+
+void VideoPlayer::setAutoLowres(bool enabled) {
+  decoder->setAutoLowres(enabled);
+}
+
+void VideoPlayer::setSeekBuffer(const PacketRing::Options &options) {
+  decoder->setSeekBuffer(options);
+}
+
+void VideoPlayer::setLoopOptions(const LoopOptions &options) {
+  decoder->setLoopOptions(options);
+}
+
 void VideoPlayer::play(const QString &path) {
-  // 启动音频输出
-  QProcess::execute("ubus", QStringList()
-                                << "call" << "eq_drc_process.output.rpc"
-                                << "control" << R"({"action":"Open"})");
+  // 先显示窗口并启动解码；歌词、字幕等非必要工作等首帧就绪后再做
+  currentFrame.reset();
+  scaledFrame = QImage();
+  videoInfoLabel.clear();
+  lyricManager->reset();
+  subtitleManager->reset();
+  cueMap->clear();
+  cueBar->setVisible(false);
+
+  // 新增：保存文件名
+  currentFileName = QFileInfo(path).fileName();
+  // 解码器重新启动时循环随之取消
+  loopA = loopB = -1;
+  loopButton->setText("A-B");
+
+  // 重置滚动
+  scrollOffset = 0;
+  scrollTimer->stop();
+  show();
+  showOverlayBar = true;
+  overlayBarTimer->start(5 * 1000);
+  // 修改：显示按钮
+  trackButton->setVisible(true);
+  speedButton->setVisible(true);
+  stepBar->setVisible(true);
+  scheduleUpdate();
+  scrollTimer->start();
+
+  // 启动音频输出（异步执行，不阻塞界面线程）
+  QProcess::startDetached("ubus", QStringList()
+                                      << "call" << "eq_drc_process.output.rpc"
+                                      << "control" << R"({"action":"Open"})");
+
+  // 媒体信息由解码器打开输入后通过 mediaInfoReady 提供
+  decoder->setOutputSize(size());
+  decoder->start(path);
+  // 直播没有可以拖动的进度；拖动预览和逐帧步进自己打开输入，不经过
+  // MediaSource，只用于本地文件（网络地址会绕过 HTTP 块缓存重复下载）
+  QString sidePath =
+      !FFMpegDecoder::isLiveInput(path) && QFileInfo(path).isFile() ? path
+                                                                    : QString();
+  scrubPreview->setSource(sidePath);
+  scrubPreview->setOutputSize(size());
+  showingScrubPreview = false;
+  thumbnails.reset();
+  thumbnailPath.clear();
+  thumbnailLoader->load(QString());
+  reverseTimer->stop();
+  reverseSpeed = 0;
+  reverseButton->setText(tr("倒放"));
+  stepping = false;
+  frameStepper->setSource(sidePath);
+  frameStepper->setOutputSize(size());
+
+  pendingSidecarPath = path;
+  sidecarTimer->start(2000);
+}
+
+void VideoPlayer::loadPendingSidecars() {
+  if (pendingSidecarPath.isEmpty())
+    return;
+  QString path = pendingSidecarPath;
+  pendingSidecarPath.clear();
+  sidecarTimer->stop();
 
   lyricManager->loadLyrics(path);
   subtitleManager->reset();
+  // 缩略图只为本地文件生成（缓存以文件大小和修改时间为键）
+  if (QFileInfo(path).isFile()) {
+    thumbnailPath = path;
+    thumbnailLoader->load(path);
+  }
 
   // 新增：加载字幕（支持模糊匹配）
   QString basePath =
@@ -335,71 +559,98 @@ void VideoPlayer::play(const QString &path) {
       subtitleManager->loadSrtSubtitle(subtitlePath);
     }
   }
+  lyricManager->updateLyricsIndex(currentPts);
+  subtitleManager->updateSubtitleIndex(currentPts);
+  // 关键帧映射在后台进行，只对本地文件做；直播不支持跳转
+  if (!FFMpegDecoder::isLiveInput(path)) {
+    // 解码器的关键帧索引可能在字幕加载之前就已就绪
+    cueMap->setKeyframeIndex(decoder->keyframeIndex());
+    cueMap->setCues(QFileInfo(path).isFile() ? path : QString(),
+                    subtitleManager->cues());
+  }
+  cueBar->setVisible(!cueMap->isEmpty());
+  scheduleUpdate();
+}
 
+void VideoPlayer::onMediaInfo(const MediaInfo &info) {
   // 读取视频/音频信息
   videoInfoLabel.clear();
-  AVFormatContext *fmt_ctx = nullptr;
-  if (avformat_open_input(&fmt_ctx, path.toUtf8().constData(), nullptr,
-                          nullptr) == 0) {
-    if (avformat_find_stream_info(fmt_ctx, nullptr) >= 0) {
-      int vid_idx = -1, aid_idx = -1;
-      for (unsigned i = 0; i < fmt_ctx->nb_streams; i++) {
-        AVCodecParameters *p = fmt_ctx->streams[i]->codecpar;
-        if (p->codec_type == AVMEDIA_TYPE_VIDEO && vid_idx < 0)
-          vid_idx = i;
-        if (p->codec_type == AVMEDIA_TYPE_AUDIO && aid_idx < 0)
-          aid_idx = i;
-      }
-      if (vid_idx >= 0) {
-        AVCodecParameters *vpar = fmt_ctx->streams[vid_idx]->codecpar;
-        videoInfoLabel +=
-            QString("视频: %1x%2  ").arg(vpar->width).arg(vpar->height);
-      }
-      if (aid_idx >= 0) {
-        AVCodecParameters *apar = fmt_ctx->streams[aid_idx]->codecpar;
-        videoInfoLabel += QString("音频: %1Hz %2ch  ")
-                              .arg(apar->sample_rate)
-                              .arg(apar->channels);
-      }
-      if (fmt_ctx->duration > 0) {
-        int sec = fmt_ctx->duration / AV_TIME_BASE;
-        int min = sec / 60;
-        sec = sec % 60;
-        videoInfoLabel += QString("时长: %1:%2  ")
-                              .arg(min, 2, 10, QChar('0'))
-                              .arg(sec, 2, 10, QChar('0'));
-      }
-    }
-    avformat_close_input(&fmt_ctx);
+  if (info.width > 0 && info.height > 0) {
+    videoInfoLabel += QString("视频: %1x%2  ").arg(info.width).arg(info.height);
+  }
+  if (info.sampleRate > 0) {
+    videoInfoLabel += QString("音频: %1Hz %2ch  ")
+                          .arg(info.sampleRate)
+                          .arg(info.channels);
   }
+  if (info.durationMs > 0) {
+    int sec = info.durationMs / 1000;
+    int min = sec / 60;
+    sec = sec % 60;
+    videoInfoLabel += QString("时长: %1:%2  ")
+                          .arg(min, 2, 10, QChar('0'))
+                          .arg(sec, 2, 10, QChar('0'));
+  }
+  scheduleUpdate();
+}
 
-  // 新增：保存文件名
-  currentFileName = QFileInfo(path).fileName();
+void VideoPlayer::onPlaybackReady(const StartupStats &) {
+  // 首帧画面和首段音频都已输出，此时再加载歌词和字幕
+  loadPendingSidecars();
+}
 
-  // 重置滚动
-  scrollOffset = 0;
-  scrollTimer->stop();
-  decoder->start(path);
-  show();
-  showOverlayBar = true;
-  overlayBarTimer->start(5 * 1000);
-  // 修改：显示按钮
-  trackButton->setVisible(true);
-  speedButton->setVisible(true);
+void VideoPlayer::onSeekCompleted(qint64 id, qint64, qint64, qint64 latencyMs) {
+  // 之前的跳转已被新请求取代时不统计；首帧已经随 frameReady 先到达，
+  // 下一次绘制就是它
+  if (id != pendingSeekId)
+    return;
+  seekDecodeLatency = latencyMs;
+  scheduleUpdate();
+}
+
+void VideoPlayer::onScrubPreview(const QSharedPointer<QImage> &frame,
+                                 qint64) {
+  // 松手后迟到的预览不再显示，等跳转后的画面
+  if (!isSeeking)
+    return;
+  showingScrubPreview = true;
+  currentFrame = frame;
+  scaledFrame = QImage();
+  scheduleUpdate();
+}
+
+void VideoPlayer::onSteppedFrame(const QSharedPointer<QImage> &frame,
+                                 qint64 ms) {
+  // 已退出步进或开始拖动后，迟到的步进画面不再显示
+  if (!stepping || isSeeking)
+    return;
+  showSteppedFrame(*frame, ms);
+}
+
+void VideoPlayer::showSteppedFrame(const QImage &frame, qint64 ms) {
+  currentFrame = QSharedPointer<QImage>(new QImage(frame));
+  scaledFrame = QImage();
+  currentPts = ms;
+  lyricManager->updateLyricsIndex(ms);
+  subtitleManager->updateSubtitleIndex(ms);
   scheduleUpdate();
-  scrollTimer->start();
 }
 
 void VideoPlayer::onFrame(const QSharedPointer<QImage> &frame) {
+  // 拖动中已显示预览时，播放线程的画面还是原位置，不要覆盖预览；
+  // 步进时播放线程停在进入步进的位置，同样不覆盖
+  if ((isSeeking && showingScrubPreview) || stepping)
+    return;
   currentFrame = frame;
+  scaledFrame = QImage();
   scheduleUpdate();
 }
 
 void VideoPlayer::onAudioData(const QByteArray &data) { audioIO->write(data); }
 
 void VideoPlayer::onPositionChanged(qint64 pts) {
-  // 拖动 seeking 时不更新进度条进度
-  if (isSeeking) {
+  // 拖动 seeking 或逐帧步进时不更新进度条进度
+  if (isSeeking || stepping) {
     return;
   }
 
@@ -460,17 +711,36 @@ void VideoPlayer::mouseReleaseEvent(QMouseEvent *) {
 
   if (isSeeking) {
     isSeeking = false;
+    scrubPreview->cancel();
+    showingScrubPreview = false;
     // seek 前检查 duration 是否有效
     if (duration > 0 && currentPts >= 0 && currentPts <= duration) {
-      decoder->seek(currentPts);
+      // 小范围微调要落在手指停下的位置；大跳转对几秒内的偏差不敏感，
+      // 直接落在关键帧上起播更快
+      FFMpegDecoder::SeekMode mode =
+          std::abs(currentPts - seekStartPts) <= ACCURATE_SEEK_MAX_JUMP_MS
+              ? FFMpegDecoder::AccurateSeek
+              : FFMpegDecoder::FastSeek;
+      pendingSeekId = decoder->seek(currentPts, mode);
+      seekDecodeLatency = -1;
+      seekTimer.start();
     }
     showOverlayBar = true;
     overlayBarTimer->start(5 * 1000);
     // 修改：显示按钮
     trackButton->setVisible(true);
     speedButton->setVisible(true);
+    stepBar->setVisible(true);
+    scheduleUpdate();
+  } else if (reverseSpeed > 0) {
+    // 倒放中点击：停在当前帧
+    setReverseSpeed(0);
+    overlayBarTimer->stop();
+    showOverlayBar = true;
     scheduleUpdate();
   } else {
+    // 步进后恢复播放：播放线程先跳到步进停下的那一帧
+    leaveStepMode(true);
     decoder->togglePause();
     // 判断当前是否为暂停状态
     if (decoder->isPaused()) {
@@ -485,6 +755,7 @@ void VideoPlayer::mouseReleaseEvent(QMouseEvent *) {
     // 修改：显示按钮
     trackButton->setVisible(true);
     speedButton->setVisible(true);
+    stepBar->setVisible(true);
     scheduleUpdate();
   }
 }
@@ -497,14 +768,21 @@ void VideoPlayer::mouseMoveEvent(QMouseEvent *e) {
     return;
 
   int dx = e->pos().x() - pressPos.x();
+  if (!isSeeking) {
+    // 从步进位置拖动：松手时的跳转会同步播放线程的位置
+    leaveStepMode(false);
+    seekStartPts = currentPts;
+  }
   isSeeking = true;
   seekByDelta(dx);
+  scrubPreview->request(currentPts);
 
   overlayBarTimer->stop();
   showOverlayBar = true;
   // 修改：显示按钮
   trackButton->setVisible(true);
   speedButton->setVisible(true);
+  stepBar->setVisible(true);
   scheduleUpdate();
 }
 
@@ -520,9 +798,151 @@ void VideoPlayer::seekByDelta(int dx) {
   currentPts = target;
 }
 
+void VideoPlayer::skipBy(qint64 deltaMs) {
+  if (decoder->isLive())
+    return;
+  leaveStepMode(false);
+  qint64 target = qBound<qint64>(0, currentPts + deltaMs,
+                                 duration > 0 ? duration : currentPts + deltaMs);
+  pendingSeekId = decoder->seek(target, FFMpegDecoder::AccurateSeek);
+  seekDecodeLatency = -1;
+  seekTimer.start();
+  currentPts = target;
+  showToastMessage(deltaMs < 0 ? tr("快退 %1 秒").arg(-deltaMs / 1000)
+                               : tr("快进 %1 秒").arg(deltaMs / 1000));
+  scheduleUpdate();
+}
+
+void VideoPlayer::jumpToCue(int direction) {
+  if (decoder->isLive())
+    return;
+  SubtitleCueMap::Target target;
+  if (!cueMap->target(currentPts, direction, &target)) {
+    showToastMessage(direction < 0   ? tr("已是第一句")
+                     : direction > 0 ? tr("已是最后一句")
+                                     : tr("当前没有字幕"));
+    return;
+  }
+  leaveStepMode(false);
+  // 开始时间紧挨在关键帧之后的条目按关键帧跳转，其余精确跳转到开始时间；
+  // 重复、上一句通常落在解码器的跳转缓冲内，不必读文件
+  pendingSeekId = decoder->seek(target.ms, target.keyframe
+                                               ? FFMpegDecoder::FastSeek
+                                               : FFMpegDecoder::AccurateSeek);
+  seekDecodeLatency = -1;
+  seekTimer.start();
+  currentPts = target.ms;
+  subtitleManager->updateSubtitleIndex(currentPts);
+  scheduleUpdate();
+}
+
+void VideoPlayer::toggleLoop() {
+  if (decoder->isLive())
+    return;
+  leaveStepMode(false);
+  if (loopB >= 0) {
+    decoder->clearLoop();
+    return;
+  }
+  if (loopA < 0) {
+    loopA = currentPts;
+    loopButton->setText("A-");
+    showToastMessage(tr("循环起点 A: %1 秒").arg(loopA / 1000.0, 0, 'f', 1));
+    return;
+  }
+  if (currentPts <= loopA + MIN_LOOP_MS) {
+    showToastMessage(tr("B 点需在 A 点之后"));
+    return;
+  }
+  // 解码器从 A 起播，回到这里的 loopChanged 更新按钮
+  decoder->setLoop(loopA, currentPts);
+  currentPts = loopA;
+  pendingSeekId = 0;
+  scheduleUpdate();
+}
+
+void VideoPlayer::onLoopChanged(qint64 aMs, qint64 bMs) {
+  bool wasLooping = loopB >= 0;
+  loopA = aMs;
+  loopB = bMs;
+  loopButton->setText(bMs >= 0 ? "A↔B" : "A-B");
+  if (bMs >= 0)
+    showToastMessage(tr("A-B 循环: %1 - %2 秒")
+                         .arg(aMs / 1000.0, 0, 'f', 1)
+                         .arg(bMs / 1000.0, 0, 'f', 1));
+  else if (wasLooping)
+    showToastMessage(tr("取消循环"));
+  scheduleUpdate();
+}
+
+void VideoPlayer::stepFrame(int direction) {
+  if (decoder->isLive())
+    return;
+  setReverseSpeed(0);
+  if (!decoder->isPaused())
+    decoder->togglePause();
+  stepping = true;
+  // 暂停时一直显示 overlay
+  overlayBarTimer->stop();
+  showOverlayBar = true;
+  QImage img;
+  qint64 ms = 0;
+  // 未命中时 GOP 解码完成后由 onSteppedFrame 显示
+  if (frameStepper->step(currentPts, direction, &img, &ms))
+    showSteppedFrame(img, ms);
+  scheduleUpdate();
+}
+
+void VideoPlayer::setReverseSpeed(int speed) {
+  if (speed <= 0) {
+    if (reverseSpeed > 0) {
+      reverseTimer->stop();
+      reverseSpeed = 0;
+      reverseButton->setText(tr("倒放"));
+      GopCache::Stats stats = frameStepper->cacheStats();
+      qint64 lookups = stats.hits + stats.misses;
+      qDebug() << "Reverse playback stopped at" << currentPts
+               << "ms, GOP cache hit rate"
+               << (lookups > 0 ? 100.0 * stats.hits / lookups : 0.0) << "%,"
+               << stats.gops << "GOPs" << stats.bytes / 1024 << "KB";
+    }
+    return;
+  }
+  if (decoder->isLive())
+    return;
+  if (!decoder->isPaused())
+    decoder->togglePause();
+  stepping = true;
+  overlayBarTimer->stop();
+  showOverlayBar = true;
+  reverseSpeed = speed;
+  reverseButton->setText(tr("倒放 %1x").arg(speed));
+  reverseAnchorMs = currentPts;
+  reverseClock.start();
+  reverseTimer->start();
+  scheduleUpdate();
+}
+
+void VideoPlayer::leaveStepMode(bool syncPosition) {
+  if (!stepping)
+    return;
+  setReverseSpeed(0);
+  stepping = false;
+  frameStepper->cancel();
+  if (syncPosition) {
+    pendingSeekId = decoder->seek(currentPts, FFMpegDecoder::AccurateSeek);
+    seekDecodeLatency = -1;
+    seekTimer.start();
+  }
+}
+
 void VideoPlayer::resizeEvent(QResizeEvent *) {
   // 新增：在窗口尺寸变化时，重新定位倍速按钮
   speedButton->setGeometry(width() - 70, 40, 60, 28);
+  // 之后的帧按新尺寸输出；新帧到来前由 paintEvent 缩放当前帧
+  decoder->setOutputSize(size());
+  scrubPreview->setOutputSize(size());
+  frameStepper->setOutputSize(size());
 }
 
 void VideoPlayer::paintEvent(QPaintEvent *) {
@@ -534,7 +954,24 @@ void VideoPlayer::paintEvent(QPaintEvent *) {
     imgSize.scale(widgetSize, Qt::KeepAspectRatio);
     QRect targetRect(QPoint(0, 0), imgSize);
     targetRect.moveCenter(rect().center());
-    p.drawImage(targetRect, *currentFrame);
+    if (imgSize == currentFrame->size()) {
+      // 解码器已按显示尺寸输出，直接绘制
+      p.drawImage(targetRect.topLeft(), *currentFrame);
+    } else {
+      // 尺寸刚变化、新尺寸的帧还没到：缩放一次并缓存，叠加层重绘时复用
+      if (scaledFrameKey != currentFrame->cacheKey() ||
+          scaledFrame.size() != imgSize) {
+        scaledFrame = currentFrame->scaled(imgSize);
+        scaledFrameKey = currentFrame->cacheKey();
+      }
+      p.drawImage(targetRect.topLeft(), scaledFrame);
+    }
+  }
+  if (seekDecodeLatency >= 0) {
+    qDebug() << "Seek" << pendingSeekId << "to photon:" << seekTimer.elapsed()
+             << "ms (decoder" << seekDecodeLatency << "ms)";
+    seekDecodeLatency = -1;
+    pendingSeekId = 0;
   }
   // 绘制顶部土司消息
   drawToastMessage(p);
@@ -656,6 +1093,29 @@ void VideoPlayer::drawProgressBar(QPainter &p) {
   p.setPen(QPen(Qt::white, 1));
   p.setBrush(Qt::NoBrush);
   p.drawRoundedRect(bar, radius, radius);
+
+  // A-B 循环区间（只设了 A 时画一条竖线）
+  if (loopA >= 0 && duration > 0) {
+    int ax = bar.left() + int(bar.width() * double(loopA) / duration);
+    int bx = loopB >= 0 ? bar.left() + int(bar.width() * double(loopB) / duration)
+                        : ax + 2;
+    p.fillRect(QRect(ax, bar.top() - 3, std::max(2, bx - ax), 3),
+               QColor(255, 200, 0, 220));
+  }
+
+  // 拖动时在进度位置上方显示该处的缩略图
+  QRect cell;
+  if (isSeeking && thumbnails && thumbnails->cellFor(currentPts, &cell)) {
+    QRect thumb(QPoint(0, 0), cell.size());
+    thumb.moveCenter(QPoint(bar.left() + playedWidth, 0));
+    thumb.moveBottom(bar.top() - 12);
+    if (thumb.left() < barMargin)
+      thumb.moveLeft(barMargin);
+    if (thumb.right() > bar.right())
+      thumb.moveLeft(bar.right() - thumb.width());
+    p.drawImage(thumb, thumbnails->image(), cell);
+    p.drawRect(thumb.adjusted(-1, -1, 0, 0));
+  }
 }
 
 void VideoPlayer::drawSubtitlesAndLyrics(QPainter &p) {
@@ -695,6 +1155,7 @@ void VideoPlayer::showOverlayBarForSeconds(int seconds) {
   // 修改：显示按钮
   trackButton->setVisible(true);
   speedButton->setVisible(true);
+  stepBar->setVisible(true);
   overlayBarTimer->start(seconds * 1000);
 }
 void VideoPlayer::scheduleUpdate() {
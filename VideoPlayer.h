@@ -12,7 +12,11 @@
 #include <ass/ass.h>
 
 #include "FFMpegDecoder.h"
+#include "FrameStepper.h"
 #include "LyricRenderer.h"
+#include "ScrubPreview.h"
+#include "SubtitleCueMap.h"
+#include "ThumbnailSheet.h"
 #include "SubtitleRenderer.h"
 
 class VideoPlayer : public QWidget {
@@ -21,6 +25,18 @@ public:
   explicit VideoPlayer(QWidget *parent = nullptr);
   ~VideoPlayer();
   void play(const QString &path);
+  // 解码线程配置，在 play() 之前设置
+  void setDecoderThreading(const DecoderThreading &threading);
+  // 覆盖按屏幕色深选择的输出像素格式
+  void setDisplayFormat(QImage::Format format, bool dither);
+  // 解码降级配置（温度文件、是否启用），在 play() 之前设置
+  void setDegradeOptions(const DegradeOptions &options);
+  // 源远大于窗口时降低解码分辨率（默认开启），在 play() 之前设置
+  void setAutoLowres(bool enabled);
+  // 跳转缓冲的时长和内存上限，在 play() 之前设置
+  void setSeekBuffer(const PacketRing::Options &options);
+  // A-B 循环的内存预算，在 play() 之前设置
+  void setLoopOptions(const LoopOptions &options);
 
 protected:
   // 手势/点击处理（双击关闭窗口）
@@ -37,12 +53,45 @@ private slots:
   void onFrame(const QSharedPointer<QImage> &frame);
   void onAudioData(const QByteArray &data);
   void onPositionChanged(qint64 pts);
+  void onMediaInfo(const MediaInfo &info);
+  void onPlaybackReady(const StartupStats &stats);
+  void onSeekCompleted(qint64 id, qint64 targetMs, qint64 landedMs,
+                       qint64 latencyMs);
+  void onScrubPreview(const QSharedPointer<QImage> &frame, qint64 ms);
+  void onSteppedFrame(const QSharedPointer<QImage> &frame, qint64 ms);
+  void onLoopChanged(qint64 aMs, qint64 bMs);
   void updateOverlay();
 
 private:
   QAudioOutput *audioOutput;
   QIODevice *audioIO;
   FFMpegDecoder *decoder;
+  // 拖动进度时的关键帧预览；显示预览期间忽略播放线程送来的旧位置画面
+  ScrubPreview *scrubPreview = nullptr;
+  bool showingScrubPreview = false;
+  // 进度条上方的缩略图，首帧就绪后在后台加载或生成
+  ThumbnailLoader *thumbnailLoader = nullptr;
+  QSharedPointer<ThumbnailSheet> thumbnails;
+  QString thumbnailPath;
+  // 逐帧步进和倒放：播放暂停，画面取自 FrameStepper 的 GOP 缓存；
+  // 恢复播放时先精确跳转到步进停下的位置
+  FrameStepper *frameStepper = nullptr;
+  bool stepping = false;
+  int reverseSpeed = 0; // 倒放倍速，0 表示不倒放
+  QTimer *reverseTimer = nullptr;
+  QElapsedTimer reverseClock;
+  qint64 reverseAnchorMs = 0; // 倒放开始（或改变倍速）时的位置
+  QWidget *stepBar = nullptr;
+  QPushButton *reverseButton = nullptr;
+  // A-B 循环：第一次点按记下 A，第二次以当前位置为 B 开始循环，再点取消
+  QPushButton *loopButton = nullptr;
+  qint64 loopA = -1;
+  qint64 loopB = -1; // 循环中为 B，否则为 -1
+  void toggleLoop();
+  // 按字幕条目跳转：上一句、重复当前句、下一句，有字幕时才显示
+  SubtitleCueMap *cueMap = nullptr;
+  QWidget *cueBar = nullptr;
+  void jumpToCue(int direction);
   QTimer *overlayTimer;
   QTimer *frameRateTimer; // 帧率控制定时器
 
@@ -55,6 +104,11 @@ private:
   bool pressed = false;
   QPoint pressPos;
   bool isSeeking = false;
+  qint64 seekStartPts = 0; // 拖动开始时的位置，松手时按跳转距离选择跳转方式
+  // 最近一次跳转：松手到新画面实际绘制的耗时（seek-to-photon）
+  qint64 pendingSeekId = 0;
+  qint64 seekDecodeLatency = -1; // 解码器报告的首帧输出耗时，-1 表示尚未落地
+  QElapsedTimer seekTimer;
   qint64 duration = 0;
   qint64 currentPts = 0;
 
@@ -71,6 +125,9 @@ private:
   ASS_Renderer *assRenderer = nullptr;
 
   QSharedPointer<QImage> currentFrame;
+  // currentFrame 与显示尺寸不符时的缩放结果，按 cacheKey 复用
+  QImage scaledFrame;
+  qint64 scaledFrameKey = 0;
   QString videoInfoLabel;
 
   // 进度条和媒体信息显示控制
@@ -88,7 +145,19 @@ private:
   // 统一 overlay 字号
   int overlayFontSize = 10;
 
+  // 首帧就绪后再加载的歌词、字幕（非必要工作，不阻塞启动）
+  QString pendingSidecarPath;
+  QTimer *sidecarTimer = nullptr;
+  void loadPendingSidecars();
+
   void seekByDelta(int dx);
+  // 快退/快进按钮：短距离跳转通常落在解码器的跳转缓冲内，不必读文件
+  void skipBy(qint64 deltaMs);
+  void stepFrame(int direction);
+  void setReverseSpeed(int speed);
+  // 退出步进模式；syncPosition 时播放线程精确跳转到步进停下的位置
+  void leaveStepMode(bool syncPosition);
+  void showSteppedFrame(const QImage &frame, qint64 ms);
   void showOverlay(bool visible);
   void drawOverlayBar(QPainter &p);
   void drawProgressBar(QPainter &p);
@@ -0,0 +1,68 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads) {
+  for (int i = 1; i < threads; i++)
+    m_threads.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  for (std::thread &t : m_threads)
+    t.join();
+}
+
+int WorkerPool::threadCount() const {
+  return static_cast<int>(m_threads.size()) + 1;
+}
+
+int WorkerPool::defaultThreadCount(int maxThreads) {
+  int cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, std::min(cores > 0 ? cores : 1, maxThreads));
+}
+
+void WorkerPool::run(int count, const std::function<void(int)> &task) {
+  if (count <= 0)
+    return;
+  if (m_threads.empty() || count == 1) {
+    for (int i = 0; i < count; i++)
+      task(i);
+    return;
+  }
+  std::lock_guard<std::mutex> runLock(m_runMutex);
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_task = &task;
+  m_next = 0;
+  m_count = count;
+  m_pending = count;
+  m_cond.notify_all();
+  drainLocked(lk);
+  m_doneCond.wait(lk, [&] { return m_pending == 0; });
+  m_task = nullptr;
+}
+
+void WorkerPool::drainLocked(std::unique_lock<std::mutex> &lk) {
+  while (m_task && m_next < m_count) {
+    int index = m_next++;
+    const std::function<void(int)> *task = m_task;
+    lk.unlock();
+    (*task)(index);
+    lk.lock();
+    if (--m_pending == 0)
+      m_doneCond.notify_all();
+  }
+}
+
+void WorkerPool::workerLoop() {
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (true) {
+    m_cond.wait(lk, [&] { return m_stop || (m_task && m_next < m_count); });
+    if (m_stop)
+      break;
+    drainLocked(lk);
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻工作线程池：把一批相互独立的任务分给工作线程和调用线程并行执行
+// 线程在构造时创建、析构时退出，逐帧调用 run 不会反复创建线程
+class WorkerPool {
+public:
+  // threads 为并行度（含调用线程），额外创建 threads - 1 个工作线程
+  explicit WorkerPool(int threads);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  int threadCount() const;
+
+  // 执行 task(0) ~ task(count - 1)，全部完成后返回；多个调用方依次执行
+  void run(int count, const std::function<void(int)> &task);
+
+  // 自动并行度：CPU 核数，不超过 maxThreads
+  static int defaultThreadCount(int maxThreads);
+
+private:
+  void workerLoop();
+  // 领取并执行任务直到本批任务分完；调用时持有锁
+  void drainLocked(std::unique_lock<std::mutex> &lk);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_runMutex; // 同一时间只执行一批任务
+  std::mutex m_mutex;
+  std::condition_variable m_cond;     // 有新任务或退出
+  std::condition_variable m_doneCond; // 本批任务全部完成
+  const std::function<void(int)> *m_task = nullptr;
+  int m_next = 0;
+  int m_count = 0;
+  int m_pending = 0;
+  bool m_stop = false;
+};
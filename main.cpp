@@ -1,6 +1,9 @@
 #include <QApplication>
 #include <QDebug>
 #include <QFileInfo>
+#include "Benchmark.h"
+#include "FFMpegDecoder.h"
+#include "ThumbnailSheet.h"
 #include "VideoPlayer.h"
 #include "qapplication.h"
 
@@ -13,35 +16,161 @@ int main(int argc, char *argv[])
     QStringList args = app.arguments();
     // 支持短参数补全
     bool showHelp = false;
+    QString benchSeekPath;
+    QString benchInputPath;
+    QString benchDecodePath;
+    QString benchPaintPath;
+    QString benchConvertPath;
+    QString benchSlicesPath;
+    QString benchLowresPath;
+    QString benchStepPath;
+    bool autoLowres = true;
+    bool buildThumbnails = false;
+    int thumbnailThreads = 0;
+    QStringList inputs;
+    QString displayFormat;
+    DecoderThreading threading;
+    DegradeOptions degrade;
+    PacketRing::Options seekBuffer;
+    LoopOptions loopOptions;
     QString path;
     for (int i = 1; i < args.size(); ++i) {
         QString arg = args.at(i);
         if (arg == "--help" || arg == "-h") {
             showHelp = true;
-        } else if (!arg.startsWith("-") && path.isEmpty()) {
-            path = arg;
+        } else if (arg == "--bench-seek" && i + 1 < args.size()) {
+            benchSeekPath = args.at(++i);
+        } else if (arg == "--bench-input" && i + 1 < args.size()) {
+            benchInputPath = args.at(++i);
+        } else if (arg == "--bench-decode" && i + 1 < args.size()) {
+            benchDecodePath = args.at(++i);
+        } else if (arg == "--bench-paint" && i + 1 < args.size()) {
+            benchPaintPath = args.at(++i);
+        } else if (arg == "--bench-convert" && i + 1 < args.size()) {
+            benchConvertPath = args.at(++i);
+        } else if (arg == "--bench-slices" && i + 1 < args.size()) {
+            benchSlicesPath = args.at(++i);
+        } else if (arg == "--bench-lowres" && i + 1 < args.size()) {
+            benchLowresPath = args.at(++i);
+        } else if (arg == "--bench-step" && i + 1 < args.size()) {
+            benchStepPath = args.at(++i);
+        } else if (arg == "--thumbnails") {
+            buildThumbnails = true;
+        } else if (arg == "--thumb-threads" && i + 1 < args.size()) {
+            thumbnailThreads = args.at(++i).toInt();
+        } else if (arg == "--no-lowres") {
+            autoLowres = false;
+        } else if (arg == "--display-format" && i + 1 < args.size()) {
+            displayFormat = args.at(++i);
+        } else if (arg == "--decode-threads" && i + 1 < args.size()) {
+            threading.threadCount = args.at(++i).toInt();
+        } else if (arg == "--convert-threads" && i + 1 < args.size()) {
+            threading.convertThreads = args.at(++i).toInt();
+        } else if (arg == "--low-delay") {
+            threading.lowDelay = true;
+        } else if (arg == "--seek-buffer-seconds" && i + 1 < args.size()) {
+            seekBuffer.maxDurationMs = args.at(++i).toLongLong() * 1000;
+        } else if (arg == "--seek-buffer-mb" && i + 1 < args.size()) {
+            seekBuffer.maxBytes = args.at(++i).toULongLong() * 1024 * 1024;
+        } else if (arg == "--loop-cache-mb" && i + 1 < args.size()) {
+            loopOptions.frameBytes = args.at(++i).toULongLong() * 1024 * 1024;
+        } else if (arg == "--no-degrade") {
+            degrade.enabled = false;
+        } else if (arg == "--thermal-zone" && i + 1 < args.size()) {
+            degrade.thermalPath = args.at(++i);
+        } else if (arg == "-" || !arg.startsWith("-")) {
+            if (path.isEmpty())
+                path = arg;
+            inputs << arg;
         }
     }
 
     if (showHelp) {
         // qDebug() << "用法: NewPlayer <视频文件路径>";
-        qDebug() << "Usage: NewPlayer <video file path>";
+        qDebug() << "Usage: NewPlayer <video file path | http(s) URL | live input>";
+        qDebug() << "Live inputs: - (stdin), pipe:N, named pipe, udp://host:port, rtp://host:port";
         // qDebug() << "参数:";
         qDebug() << "Options:";
         // qDebug() << "  --help, -h          显示帮助信息";
         qDebug() << "  --help, -h          Show help information";
+        qDebug() << "  --bench-seek <file> Compare fast (timestamp, keyframe index) and accurate seek latency";
+        qDebug() << "  --bench-input <file|url> Measure input throughput, stall time and cache hit rate";
+        qDebug() << "  --bench-decode <file> Measure video decode fps per thread configuration";
+        qDebug() << "  --bench-paint <file> Measure conversion and paint cost per display format";
+        qDebug() << "  --bench-convert <file> Check SIMD frame conversion against swscale and compare speed";
+        qDebug() << "  --bench-slices <file> Measure frame conversion latency per slice thread count";
+        qDebug() << "  --bench-lowres <file> Compare decode cost and memory of full and reduced-resolution decoding";
+        qDebug() << "  --bench-step <file> Measure frame step latency and GOP cache use for stepping and reverse playback";
+        qDebug() << "  --thumbnails <file|dir>... Build the progress thumbnail cache for the given files in parallel";
+        qDebug() << "  --thumb-threads <n> Threads for --thumbnails (0 = number of CPUs)";
+        qDebug() << "  --display-format <rgb32|argb32pm|rgb16|rgb16-dither|rgb888> Override the format chosen from screen depth";
+        qDebug() << "  --decode-threads <n> Video decoder threads (0 = auto)";
+        qDebug() << "  --convert-threads <n> Colour conversion slice threads (0 = auto)";
+        qDebug() << "  --low-delay         Slice threading only, for fast seeking";
+        qDebug() << "  --no-lowres         Always decode at full resolution";
+        qDebug() << "  --seek-buffer-seconds <n> Keep the last n seconds of demuxed packets for seeks without I/O (0 = off, default 30)";
+        qDebug() << "  --seek-buffer-mb <n> Memory limit of the seek buffer in MB (default 32)";
+        qDebug() << "  --loop-cache-mb <n> Decoded-frame budget in MB for caching a whole A-B loop (default 96)";
+        qDebug() << "  --no-degrade        Never lower decode quality when the decoder falls behind";
+        qDebug() << "  --thermal-zone <path> Temperature file (millidegrees C) that also forces degradation, e.g. /sys/class/thermal/thermal_zone0/temp";
         return 0;
     }
 
+    if (!benchSeekPath.isEmpty()) {
+        return Benchmark::seekLatency(benchSeekPath);
+    }
+    if (!benchInputPath.isEmpty()) {
+        return Benchmark::inputThroughput(benchInputPath);
+    }
+    if (!benchDecodePath.isEmpty()) {
+        return Benchmark::decodeFps(benchDecodePath);
+    }
+    if (!benchPaintPath.isEmpty()) {
+        return Benchmark::paintCost(benchPaintPath);
+    }
+    if (!benchConvertPath.isEmpty()) {
+        return Benchmark::convertThroughput(benchConvertPath);
+    }
+    if (!benchSlicesPath.isEmpty()) {
+        return Benchmark::convertSlices(benchSlicesPath);
+    }
+    if (!benchLowresPath.isEmpty()) {
+        return Benchmark::lowresCost(benchLowresPath);
+    }
+    if (!benchStepPath.isEmpty()) {
+        return Benchmark::frameStep(benchStepPath);
+    }
+    if (buildThumbnails) {
+        return ThumbnailSheet::buildBatch(inputs, thumbnailThreads);
+    }
+
     if (!path.isEmpty()) {
-        // 检查路径是否为有效文件
+        // 检查路径是否为有效文件（网络地址交给解码器打开）
         QFileInfo fileInfo(path);
-        if (!fileInfo.exists() || !fileInfo.isFile()) {
+        bool isUrl = path.contains("://");
+        bool isLive = FFMpegDecoder::isLiveInput(path);
+        if (!isUrl && !isLive && (!fileInfo.exists() || !fileInfo.isFile())) {
             qDebug() << "Invalid video file path:" << path;
             return 1;
         }
         // 带参数启动，直接全屏播放
         VideoPlayer *player = new VideoPlayer;
+        player->setDecoderThreading(threading);
+        player->setDegradeOptions(degrade);
+        player->setAutoLowres(autoLowres);
+        player->setSeekBuffer(seekBuffer);
+        player->setLoopOptions(loopOptions);
+        if (displayFormat == "rgb32") {
+            player->setDisplayFormat(QImage::Format_RGB32, false);
+        } else if (displayFormat == "argb32pm") {
+            player->setDisplayFormat(QImage::Format_ARGB32_Premultiplied, false);
+        } else if (displayFormat == "rgb16") {
+            player->setDisplayFormat(QImage::Format_RGB16, false);
+        } else if (displayFormat == "rgb16-dither") {
+            player->setDisplayFormat(QImage::Format_RGB16, true);
+        } else if (displayFormat == "rgb888") {
+            player->setDisplayFormat(QImage::Format_RGB888, false);
+        }
         player->setWindowState(Qt::WindowFullScreen);
         player->play(path);
         return app.exec();